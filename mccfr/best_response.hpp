@@ -0,0 +1,167 @@
+/*
+ * best_response.hpp — exact best response and exploitability for cfr.hpp games
+ *
+ * Needs the full chance enumeration (chance_outcomes), so Kuhn and Leduc
+ * only. Two passes per best-responding player:
+ *
+ *   collect   walk the whole tree under the average strategy and file every
+ *             history of the br player under its infoset, weighted by the
+ *             opponent's reach times the chance probability
+ *   value     walk again; at a br infoset pick the action maximising the
+ *             weighted sum over all of its histories (memoised per key, so
+ *             each infoset is resolved once, deepest first by recursion)
+ *
+ * exploitability = (br value of P1 + br value of P2) / 2, in chips per hand,
+ * 0 at a Nash equilibrium.
+ */
+#ifndef BEST_RESPONSE_HPP
+#define BEST_RESPONSE_HPP
+
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "cfr.hpp"
+
+namespace cfr {
+
+template <class Game>
+class BestResponse {
+public:
+	typedef typename Game::State State;
+	static const int N = Game::ACTION_SLOTS;
+
+	explicit BestResponse(const Table<N>& table) : table(table) {}
+
+	//expected value for br_player when it best responds to the average strategy
+	double value(int br_player) {
+		histories.clear();
+		best_action.clear();
+		collect(Game::root(), br_player, 1.0);
+		return walk(Game::root(), br_player);
+	}
+
+	double exploitability() {
+		return 0.5 * (value(0) + value(1));
+	}
+
+private:
+	void average_strategy(const State& s, const int* legal, int num_legal, float* out) const {
+		const InfoSet<N>* node = table.find(Game::infoset_key(s));
+		if (node) {
+			get_average_strategy(node, legal, num_legal, out);
+			return;
+		}
+		//never visited by the solver, it played uniform there
+		for (int i = 0; i < num_legal; i++)
+			out[legal[i]] = 1.0f / (float)num_legal;
+	}
+
+	void collect(const State& s, int br_player, double weight) {
+		if (Game::is_terminal(s))
+			return;
+
+		if (Game::is_chance(s)) {
+			State next[Game::CHANCE_SLOTS];
+			float probs[Game::CHANCE_SLOTS];
+			int n = Game::chance_outcomes(s, next, probs);
+			for (int i = 0; i < n; i++)
+				collect(next[i], br_player, weight * probs[i]);
+			return;
+		}
+
+		int legal[N];
+		int num_legal = Game::legal_actions(s, legal);
+
+		if (Game::player(s) == br_player) {
+			histories[Game::infoset_key(s)].push_back(std::make_pair(s, weight));
+			for (int i = 0; i < num_legal; i++)
+				collect(Game::apply(s, legal[i]), br_player, weight);
+			return;
+		}
+
+		float strategy[N] = {0};
+		average_strategy(s, legal, num_legal, strategy);
+		for (int i = 0; i < num_legal; i++) {
+			int a = legal[i];
+			if (strategy[a] > 0.0f)
+				collect(Game::apply(s, a), br_player, weight * strategy[a]);
+		}
+	}
+
+	int choose(const State& s, int br_player) {
+		uint64_t key = Game::infoset_key(s);
+		auto it = best_action.find(key);
+		if (it != best_action.end())
+			return it->second;
+
+		int legal[N];
+		int num_legal = Game::legal_actions(s, legal);
+
+		const std::vector<std::pair<State, double> >& members = histories[key];
+		int best = legal[0];
+		double best_value = 0.0;
+
+		for (int i = 0; i < num_legal; i++) {
+			int a = legal[i];
+			double v = 0.0;
+			for (size_t h = 0; h < members.size(); h++)
+				if (members[h].second > 0.0)
+					v += members[h].second * walk(Game::apply(members[h].first, a), br_player);
+
+			if (i == 0 || v > best_value) {
+				best = a;
+				best_value = v;
+			}
+		}
+
+		best_action[key] = best;
+		return best;
+	}
+
+	double walk(const State& s, int br_player) {
+		if (Game::is_terminal(s))
+			return Game::payoff(s, br_player);
+
+		if (Game::is_chance(s)) {
+			State next[Game::CHANCE_SLOTS];
+			float probs[Game::CHANCE_SLOTS];
+			int n = Game::chance_outcomes(s, next, probs);
+
+			double value = 0.0;
+			for (int i = 0; i < n; i++)
+				value += probs[i] * walk(next[i], br_player);
+			return value;
+		}
+
+		if (Game::player(s) == br_player)
+			return walk(Game::apply(s, choose(s, br_player)), br_player);
+
+		int legal[N];
+		int num_legal = Game::legal_actions(s, legal);
+
+		float strategy[N] = {0};
+		average_strategy(s, legal, num_legal, strategy);
+
+		double value = 0.0;
+		for (int i = 0; i < num_legal; i++) {
+			int a = legal[i];
+			if (strategy[a] > 0.0f)
+				value += strategy[a] * walk(Game::apply(s, a), br_player);
+		}
+		return value;
+	}
+
+	const Table<N>& table;
+	std::unordered_map<uint64_t, std::vector<std::pair<State, double> > > histories;
+	std::unordered_map<uint64_t, int> best_action;
+};
+
+template <class Game>
+inline double exploitability(const Table<Game::ACTION_SLOTS>& table) {
+	return BestResponse<Game>(table).exploitability();
+}
+
+} // namespace cfr
+
+#endif // BEST_RESPONSE_HPP
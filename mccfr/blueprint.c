@@ -0,0 +1,452 @@
+/*
+ * blueprint.c — ranges and depth-limit leaf values from an nlh.cpp blueprint
+ *
+ * Lines are replayed through the same rules as training (nlh.h), the board
+ * comes from the line instead of deal_runout. Anything the blueprint never
+ * visited plays uniform, same as an untouched infoset would have.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "nlh.h"
+#include "blueprint.h"
+
+#define EMPTY_MAGIC 0xBEEFBEEF
+
+_Static_assert(MAX_ACTIONS == 8, "BlueprintRecord assumes 8 action slots");
+
+struct Blueprint {
+	BlueprintRecord *entries;
+	size_t size;
+};
+
+static uint64_t combo_masks[NUM_COMBOS];
+
+static void init_combo_masks() {
+	int combo = 0;
+	for (int c1 = 0; c1 < 51; c1++) {
+		for (int c2 = c1 + 1; c2 < 52; c2++) {
+			int r1 = c1 % 13; int s1 = c1 / 13;
+			int r2 = c2 % 13; int s2 = c2 / 13;
+			combo_masks[combo++] = (1ULL << (r1 + (s1 * 16))) | (1ULL << (r2 + (s2 * 16)));
+		}
+	}
+}
+
+//pulled from murmurhash, same as the training table
+static uint64_t hash_id(uint64_t key, size_t size) {
+	key ^= key >> 33;
+	key *= 0xff51afd7ed558ccdLLU;
+	key ^= key >> 33;
+	return key % size;
+}
+
+static const BlueprintRecord* find_record(const Blueprint *bp, uint64_t key) {
+	uint64_t id = hash_id(key, bp->size);
+	while (bp->entries[id].key != EMPTY_MAGIC) {
+		if (bp->entries[id].key == key)
+			return &bp->entries[id];
+		id = (id + 1) % bp->size;
+	}
+	return NULL;
+}
+
+/*
+ * file: uint32 magic, uint64 count, then count BlueprintRecords
+ */
+Blueprint* blueprint_load(const char *path) {
+	FILE *f = fopen(path, "rb");
+	if (!f)
+		return NULL;
+
+	uint32_t magic = 0;
+	uint64_t count = 0;
+	if (fread(&magic, sizeof(magic), 1, f) != 1 || magic != BLUEPRINT_MAGIC ||
+	    fread(&count, sizeof(count), 1, f) != 1) {
+		fclose(f);
+		return NULL;
+	}
+
+	Blueprint *bp = (Blueprint*) malloc(sizeof(Blueprint));
+	if (!bp)
+		abort();
+
+	//half full at most so probes stay short
+	bp->size = (size_t)count * 2 + 1;
+	bp->entries = (BlueprintRecord*) malloc(bp->size * sizeof(BlueprintRecord));
+	if (!bp->entries)
+		abort();
+	for (size_t i = 0; i < bp->size; i++)
+		bp->entries[i].key = EMPTY_MAGIC;
+
+	for (uint64_t i = 0; i < count; i++) {
+		BlueprintRecord rec;
+		if (fread(&rec, sizeof(rec), 1, f) != 1) {
+			fclose(f);
+			blueprint_free(bp);
+			return NULL;
+		}
+
+		uint64_t id = hash_id(rec.key, bp->size);
+		while (bp->entries[id].key != EMPTY_MAGIC && bp->entries[id].key != rec.key)
+			id = (id + 1) % bp->size;
+		bp->entries[id] = rec;
+	}
+
+	fclose(f);
+	init_combo_masks();
+	return bp;
+}
+
+void blueprint_free(Blueprint *bp) {
+	if (!bp)
+		return;
+	free(bp->entries);
+	free(bp);
+}
+
+/*
+ * average strategy, the lazily deferred weight is pushed through the
+ * current strategy the same way flush_average does in training
+ */
+static void average_strategy(const Blueprint *bp, GameState *state, const int *legal_actions, int num_legal_actions, float *out) {
+	const BlueprintRecord *rec = find_record(bp, get_infoset_key(state));
+	float sum = 0.0f;
+
+	if (rec) {
+		float positive_sum = 0.0f;
+		for (int i = 0; i < num_legal_actions; i++) {
+			float r = rec->regret_sum[legal_actions[i]];
+			positive_sum += r > 0.0f ? r : 0.0f;
+		}
+
+		for (int i = 0; i < num_legal_actions; i++) {
+			int action = legal_actions[i];
+			float r = rec->regret_sum[action];
+			float current = (positive_sum > 0.0f) ?
+				(r > 0.0f ? r : 0.0f) / positive_sum :
+				1.0f / num_legal_actions;
+
+			out[action] = rec->strategy_sum[action] + rec->avg_pending * current;
+			sum += out[action];
+		}
+	}
+
+	for (int i = 0; i < num_legal_actions; i++) {
+		int action = legal_actions[i];
+		out[action] = (sum > 0.0f) ? out[action] / sum : 1.0f / num_legal_actions;
+	}
+}
+
+static uint64_t board_mask(const BlueprintLine *line) {
+	uint64_t mask = 0;
+	for (int i = 0; i < line->num_board; i++)
+		mask |= 1ULL << line->board[i];
+	return mask;
+}
+
+/*
+ * walk the line from the preflop root, states[i] is the state before
+ * action i and states[num_actions] the end. deck_params holds the runout
+ * to reveal, cards outside known_board are hidden again (streets the
+ * line closes without knowing the next card)
+ */
+static int replay(const BlueprintLine *line, uint64_t deck_params, uint64_t known_board, GameState *states) {
+	GameState state = {0};
+	state.p1_stack = INITIAL_STACK - SB_CENTS;
+	state.p2_stack = INITIAL_STACK - BB_CENTS;
+	state.pot = SB_CENTS + BB_CENTS;
+	state.active_player = P1;
+	state.deck_params = deck_params;
+
+	for (int i = 0; i < line->num_actions; i++) {
+		states[i] = state;
+		if (is_terminal(&state))
+			return 0;
+
+		int legal_actions[MAX_ACTIONS];
+		int num_legal_actions = get_legal_actions(&state, legal_actions);
+		int legal = 0;
+		for (int a = 0; a < num_legal_actions; a++)
+			legal |= legal_actions[a] == line->actions[i];
+		if (!legal)
+			return 0;
+
+		state = apply_action(state, line->actions[i]);
+		state.board &= known_board;
+	}
+
+	states[line->num_actions] = state;
+	return 1;
+}
+
+static uint64_t line_deck(const BlueprintLine *line) {
+	uint64_t deck_params = 0;
+	for (int i = 0; i < line->num_board; i++)
+		deck_params |= (uint64_t)line->board[i] << (i * 6);
+	return deck_params;
+}
+
+int blueprint_spot(const BlueprintLine *line, BlueprintSpot *out) {
+	GameState states[BLUEPRINT_MAX_LINE + 1];
+	if (!replay(line, line_deck(line), board_mask(line), states))
+		return 0;
+
+	GameState *state = &states[line->num_actions];
+	int32_t stack_diff = (state->active_player == P1) ?
+		(int32_t)state->p1_stack - (int32_t)state->p2_stack :
+		(int32_t)state->p2_stack - (int32_t)state->p1_stack;
+
+	out->board = state->board;
+	out->pot = (int)state->pot;
+	out->p1_stack = (int)state->p1_stack;
+	out->p2_stack = (int)state->p2_stack;
+	out->street = state->street;
+	out->active_player = state->active_player;
+	out->actions_st = state->actions_st;
+	out->to_call = stack_diff > 0 ? stack_diff : 0;
+	out->terminal = is_terminal(state);
+	return 1;
+}
+
+/*
+ * nearest blueprint action, returns the id appended or -1
+ */
+int blueprint_line_push(BlueprintLine *line, int kind, float pot_fraction) {
+	if (line->num_actions >= BLUEPRINT_MAX_LINE)
+		return -1;
+
+	BlueprintSpot spot;
+	if (!blueprint_spot(line, &spot) || spot.terminal)
+		return -1;
+
+	GameState states[BLUEPRINT_MAX_LINE + 1];
+	replay(line, line_deck(line), board_mask(line), states);
+
+	int legal_actions[MAX_ACTIONS];
+	int num_legal_actions = get_legal_actions(&states[line->num_actions], legal_actions);
+	int facing = spot.to_call > 0;
+
+	//facing: 0 fold, 1 call, 2.. raises. otherwise: 0 check, 1.. bets
+	int action = (kind == BP_PASSIVE && facing) ? 1 : 0;
+
+	if (kind == BP_AGGRESSIVE) {
+		const int *pcts = facing ? RAISE_PCT : BET_PCT;
+		int first = facing ? 2 : 1;
+		float best_dist = 1e30f;
+
+		action = facing ? 1 : 0; //capped, fall back to passive
+		for (int i = 0; i < num_legal_actions; i++) {
+			int id = legal_actions[i];
+			if (id < first)
+				continue;
+
+			float dist = pcts[id - first] / 100.0f - pot_fraction;
+			if (dist < 0.0f)
+				dist = -dist;
+			if (dist < best_dist) {
+				best_dist = dist;
+				action = id;
+			}
+		}
+	}
+
+	line->actions[line->num_actions++] = (uint8_t)action;
+	return action;
+}
+
+void blueprint_ranges(const Blueprint *bp, const BlueprintLine *line, float *p1_reach, float *p2_reach) {
+	GameState states[BLUEPRINT_MAX_LINE + 1];
+
+	for (int c = 0; c < NUM_COMBOS; c++) {
+		p1_reach[c] = 0.0f;
+		p2_reach[c] = 0.0f;
+	}
+
+	if (!replay(line, line_deck(line), board_mask(line), states))
+		return;
+
+	uint64_t dead = board_mask(line);
+
+	for (int c = 0; c < NUM_COMBOS; c++) {
+		uint64_t hand = combo_masks[c];
+		if (hand & dead)
+			continue;
+
+		float reach[2] = { 1.0f, 1.0f };
+		for (int i = 0; i < line->num_actions; i++) {
+			GameState state = states[i];
+			int player = state.active_player;
+			if (reach[player] == 0.0f)
+				continue;
+
+			if (player == P1)
+				state.p1_hand = hand;
+			else
+				state.p2_hand = hand;
+
+			int legal_actions[MAX_ACTIONS];
+			int num_legal_actions = get_legal_actions(&state, legal_actions);
+			float strategy[MAX_ACTIONS] = {0};
+			average_strategy(bp, &state, legal_actions, num_legal_actions, strategy);
+			reach[player] *= strategy[line->actions[i]];
+		}
+
+		p1_reach[c] = reach[P1];
+		p2_reach[c] = reach[P2];
+	}
+}
+
+static int sample_combo(const float *cdf, float total, uint64_t blocked) {
+	//rejection on card overlap, the blocked mass is small
+	for (int tries = 0; tries < 64 && total > 0.0f; tries++) {
+		float r = gto_rng_uniform() * total;
+		int lo = 0, hi = NUM_COMBOS - 1;
+		while (lo < hi) {
+			int mid = (lo + hi) / 2;
+			if (cdf[mid] > r)
+				hi = mid;
+			else
+				lo = mid + 1;
+		}
+		if ((combo_masks[lo] & blocked) == 0)
+			return lo;
+	}
+
+	//range is empty or fully blocked, any live hand will do
+	while (true) {
+		int c = (int)(gto_rng_uniform() * NUM_COMBOS);
+		if (c < NUM_COMBOS && (combo_masks[c] & blocked) == 0)
+			return c;
+	}
+}
+
+/*
+ * play the blueprint out from state, returns what player won from the
+ * opponent's chips put in since the subgame root (root_stack), minus its own
+ * on a loss: the same convention as the vector solver's terminals
+ */
+static float rollout(const Blueprint *bp, GameState state, int player, const uint32_t *root_stack) {
+	while (!is_terminal(&state)) {
+		int legal_actions[MAX_ACTIONS];
+		int num_legal_actions = get_legal_actions(&state, legal_actions);
+		float strategy[MAX_ACTIONS] = {0};
+		average_strategy(bp, &state, legal_actions, num_legal_actions, strategy);
+
+		float r = gto_rng_uniform();
+		float cumulative = 0.0f;
+		int action = legal_actions[num_legal_actions - 1];
+		for (int i = 0; i < num_legal_actions; i++) {
+			cumulative += strategy[legal_actions[i]];
+			if (r < cumulative) {
+				action = legal_actions[i];
+				break;
+			}
+		}
+		state = apply_action(state, action);
+	}
+
+	float p1_in = (float)(root_stack[P1] - state.p1_stack);
+	float p2_in = (float)(root_stack[P2] - state.p2_stack);
+	float mine = (player == P1) ? p1_in : p2_in;
+	float theirs = (player == P1) ? p2_in : p1_in;
+
+	if (state.last_action == 0 && state.p1_stack != state.p2_stack) {
+		int winner = 1 - state.active_player;
+		return (player == winner) ? theirs : -mine;
+	}
+
+	if (state.showdown == SHOWDOWN_CHOP)
+		return 0.5f * (theirs - mine);
+	return (state.showdown == player) ? theirs : -mine;
+}
+
+/*
+ * per hand value at the end of the line (a depth limit) when both sides
+ * continue with the blueprint. Opponent hands come from the blueprint range
+ * at the end of the line, missing board cards are sampled per rollout.
+ * root_actions marks where the subgame starts in the line, a NULL output
+ * skips that player. The range buffers are per call, nothing is kept
+ * between calls. Outputs stay 0 if the line doesn't replay or the buffers
+ * can't be allocated
+ */
+void blueprint_leaf_values(const Blueprint *bp, const BlueprintLine *line, int root_actions, int samples,
+		float *p1_values, float *p2_values) {
+	GameState states[BLUEPRINT_MAX_LINE + 1];
+
+	for (int c = 0; c < NUM_COMBOS; c++) {
+		if (p1_values)
+			p1_values[c] = 0.0f;
+		if (p2_values)
+			p2_values[c] = 0.0f;
+	}
+
+	uint64_t known_board = board_mask(line);
+	if (samples < 1 || root_actions > line->num_actions ||
+	    !replay(line, line_deck(line), known_board, states))
+		return;
+
+	uint32_t root_stack[2] = { states[root_actions].p1_stack, states[root_actions].p2_stack };
+	GameState leaf = states[line->num_actions];
+	float *buffers = (float*) malloc(3 * NUM_COMBOS * sizeof(float));
+	if (!buffers)
+		return;
+	float *reach[2] = { buffers, buffers + NUM_COMBOS };
+	float *cdf = buffers + 2 * NUM_COMBOS;
+	blueprint_ranges(bp, line, reach[P1], reach[P2]);
+
+	//cards showing at the leaf, the rest of the runout stays in deck_params
+	int visible = 0;
+	if (leaf.street >= STREET_FLOP)
+		visible = (leaf.street > STREET_RIVER) ? RUNOUT_CARDS : leaf.street + 2;
+
+	for (int player = P1; player <= P2; player++) {
+		int opp = 1 - player;
+		float *out = (player == P1) ? p1_values : p2_values;
+		if (!out)
+			continue;
+
+		float total = 0.0f;
+		for (int c = 0; c < NUM_COMBOS; c++) {
+			total += reach[opp][c];
+			cdf[c] = total;
+		}
+
+		for (int c = 0; c < NUM_COMBOS; c++) {
+			uint64_t hand = combo_masks[c];
+			if (hand & known_board)
+				continue;
+
+			float sum = 0.0f;
+			for (int s = 0; s < samples; s++) {
+				uint64_t opp_hand = combo_masks[sample_combo(cdf, total, hand | known_board)];
+				uint64_t dead = hand | opp_hand | known_board;
+
+				//fill in the rest of the runout
+				GameState state = leaf;
+				uint64_t runout = known_board;
+				for (int i = line->num_board; i < RUNOUT_CARDS; i++) {
+					uint64_t card = draw_random_card(dead);
+					dead |= card;
+					runout |= card;
+					state.deck_params |= (uint64_t)__builtin_ctzll(card) << (i * 6);
+					if (i < visible)
+						state.board |= card;
+				}
+
+				state.p1_hand = (player == P1) ? hand : opp_hand;
+				state.p2_hand = (player == P1) ? opp_hand : hand;
+
+				int p1_score = evaluate(state.p1_hand, runout);
+				int p2_score = evaluate(state.p2_hand, runout);
+				state.showdown = (p1_score > p2_score) ? SHOWDOWN_P1 :
+					(p1_score < p2_score) ? SHOWDOWN_P2 : SHOWDOWN_CHOP;
+
+				sum += rollout(bp, state, player, root_stack);
+			}
+			out[c] = sum / samples;
+		}
+	}
+	free(buffers);
+}
@@ -0,0 +1,72 @@
+/*
+ * blueprint.h — read side of the nlh.cpp MCCFR blueprint
+ *
+ * nlh.cpp dumps its infoset table with save_blueprint(); this loads it and
+ * answers the two questions a real-time re-solve needs at a postflop spot:
+ * which hands reach it (blueprint_ranges) and what each hand is worth at
+ * the depth limit if play continues with the blueprint
+ * (blueprint_leaf_values).
+ *
+ * Deliberately free of nlh.h so the vector solver (src_old, which has its
+ * own GameState) can include it.
+ *
+ * Cards are mask bit positions, rank + suit * 16. Hand vectors are 1326
+ * long, in the combo order of src_old/indexer.c (c1 < c2, card index
+ * suit * 13 + rank).
+ */
+#ifndef BLUEPRINT_H
+#define BLUEPRINT_H
+
+#include <stdint.h>
+
+#define BLUEPRINT_MAGIC    0x54464250   // "TFBP"
+#define BLUEPRINT_MAX_LINE 21           // 3 bits per action in a 64-bit history
+#define NUM_COMBOS         1326
+
+/* On-disk record, one per infoset, raw accumulators straight from nlh.cpp */
+typedef struct {
+	uint64_t key;
+	float regret_sum[8];
+	float strategy_sum[8];
+	float avg_pending;
+} BlueprintRecord;
+
+/* Betting line from the preflop root in blueprint action ids, plus the board in deal order */
+typedef struct {
+	uint8_t actions[BLUEPRINT_MAX_LINE];
+	int num_actions;
+	int board[5];
+	int num_board;
+} BlueprintLine;
+
+/* Public state at the end of a line, chips are the blueprint's cents */
+typedef struct {
+	uint64_t board;
+	int pot;
+	int p1_stack;
+	int p2_stack;
+	int street;          // 0 pre, 1 flop, 2 turn, 3 river, 4 hand over
+	int active_player;
+	int actions_st;
+	int to_call;
+	int terminal;
+} BlueprintSpot;
+
+/* Translating another abstraction's actions onto the blueprint's */
+#define BP_FOLD        0
+#define BP_PASSIVE     1    // check or call
+#define BP_AGGRESSIVE  2    // bet or raise, sized by pot_fraction
+
+typedef struct Blueprint Blueprint;
+
+Blueprint* blueprint_load(const char* path);
+void blueprint_free(Blueprint* bp);
+
+int blueprint_spot(const BlueprintLine* line, BlueprintSpot* out);
+int blueprint_line_push(BlueprintLine* line, int kind, float pot_fraction);
+
+void blueprint_ranges(const Blueprint* bp, const BlueprintLine* line, float* p1_reach, float* p2_reach);
+void blueprint_leaf_values(const Blueprint* bp, const BlueprintLine* line, int root_actions, int samples,
+		float* p1_values, float* p2_values);
+
+#endif // BLUEPRINT_H
@@ -0,0 +1,557 @@
+/*
+ * cfr.hpp — templated CFR core shared by the Kuhn, Leduc and NLHE solvers
+ *
+ * A game plugs in through a traits type with static members only, so every
+ * variant gets instantiated per game with no virtual calls:
+ *
+ *   using State;                                  // copied by value, keep it small
+ *   static const int ACTION_SLOTS;                // width of an infoset
+ *   static const int CHANCE_SLOTS;                // widest chance node (vanilla only)
+ *   static State root();                          // undealt start of the hand
+ *   static bool is_terminal(const State&);
+ *   static bool is_chance(const State&);
+ *   static State sample_chance(const State&, Rng&);
+ *   static int chance_outcomes(const State&, State* out, float* probs);   // vanilla only
+ *   static int player(const State&);
+ *   static int legal_actions(const State&, int* out);
+ *   static State apply(const State&, int action);
+ *   static float payoff(const State&, int player);                         // zero sum
+ *   static uint64_t infoset_key(const State&);
+ *
+ * Sampling variants:
+ *   vanilla   every chance outcome and every action, reach weighted
+ *   chance    one chance outcome per iteration, every action
+ *   external  traverser walks every action, opponent and chance are sampled
+ *   outcome   one trajectory, epsilon-greedy for the traverser
+ *
+ * Every variant takes the Solver's weighting and average options, the
+ * defaults are plain CFR with eager averaging.
+ */
+#ifndef CFR_HPP
+#define CFR_HPP
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <math.h>
+#include <vector>
+
+namespace cfr {
+
+#define CFR_EMPTY_MAGIC 0xBEEFBEEF
+
+/*
+ * xorshift64, same generator as nlh-ex.c
+ */
+struct Rng {
+	uint64_t state;
+
+	explicit Rng(uint64_t seed = 88172645463325252ULL) : state(seed ? seed : 1) {}
+
+	uint64_t next() {
+		uint64_t x = state;
+		x ^= x << 13;
+		x ^= x >> 7;
+		x ^= x << 17;
+		state = x;
+		return x;
+	}
+
+	//[0, 1)
+	float uniform() {
+		return (float)(next() >> 40) / (float)(1 << 24);
+	}
+
+	//[0, n)
+	int below(int n) {
+		return (int)(((next() >> 32) * (uint64_t)n) >> 32);
+	}
+};
+
+template <int N>
+struct InfoSet {
+	float regret_sum[N];
+	float strategy_sum[N];
+	float avg_pending;      //average weight not yet pushed through the current strategy (Solver::lazy_average)
+};
+
+/*
+ * Open addressing with linear probing, same layout as the C solvers
+ */
+template <int N>
+class Table {
+public:
+	struct Entry {
+		uint64_t key;
+		InfoSet<N> infoSet;
+	};
+
+	explicit Table(size_t size) : entries(size) {
+		clear();
+	}
+
+	void clear() {
+		for (size_t i = 0; i < entries.size(); i++)
+			entries[i].key = CFR_EMPTY_MAGIC;
+		used = 0;
+	}
+
+	InfoSet<N>* get_or_create(uint64_t key) {
+		size_t id = hash_id(key);
+		while (entries[id].key != CFR_EMPTY_MAGIC) {
+			if (entries[id].key == key)
+				return &entries[id].infoSet;
+			id = (id + 1) % entries.size();
+		}
+
+		if (++used >= entries.size())
+			abort(); //table full
+
+		entries[id].key = key;
+		for (int i = 0; i < N; i++) {
+			entries[id].infoSet.regret_sum[i] = 0;
+			entries[id].infoSet.strategy_sum[i] = 0;
+		}
+		entries[id].infoSet.avg_pending = 0;
+		return &entries[id].infoSet;
+	}
+
+	const InfoSet<N>* find(uint64_t key) const {
+		size_t id = hash_id(key);
+		while (entries[id].key != CFR_EMPTY_MAGIC) {
+			if (entries[id].key == key)
+				return &entries[id].infoSet;
+			id = (id + 1) % entries.size();
+		}
+		return nullptr;
+	}
+
+	size_t size() const { return used; }
+
+	std::vector<Entry> entries;
+
+private:
+	//pulled from murmurhash
+	size_t hash_id(uint64_t key) const {
+		key ^= key >> 33;
+		key *= 0xff51afd7ed558ccdLLU;
+		key ^= key >> 33;
+		return key % entries.size();
+	}
+
+	size_t used = 0;
+};
+
+/*
+ * regret matching over the legal actions, illegal slots are left at 0
+ */
+template <int N>
+inline void get_strategy(const InfoSet<N>* node, const int* legal, int num_legal, float* out) {
+	float sum = 0.0f;
+	for (int i = 0; i < num_legal; i++) {
+		float r = node->regret_sum[legal[i]];
+		out[legal[i]] = r > 0.0f ? r : 0.0f;
+		sum += out[legal[i]];
+	}
+
+	for (int i = 0; i < num_legal; i++) {
+		if (sum > 0.0f)
+			out[legal[i]] /= sum;
+		else
+			out[legal[i]] = 1.0f / (float)num_legal;
+	}
+}
+
+/*
+ * pending weight goes through the current strategy, the same average as
+ * if it had been accumulated eagerly
+ */
+template <int N>
+inline void get_average_strategy(const InfoSet<N>* node, const int* legal, int num_legal, float* out) {
+	float current[N] = {0};
+	if (node->avg_pending != 0.0f)
+		get_strategy(node, legal, num_legal, current);
+
+	float sum = 0.0f;
+	for (int i = 0; i < num_legal; i++) {
+		out[legal[i]] = node->strategy_sum[legal[i]] + node->avg_pending * current[legal[i]];
+		sum += out[legal[i]];
+	}
+
+	for (int i = 0; i < num_legal; i++) {
+		if (sum > 0.0f)
+			out[legal[i]] /= sum;
+		else
+			out[legal[i]] = 1.0f / (float)num_legal;
+	}
+}
+
+inline int sample_index(const float* probs, const int* legal, int num_legal, float r) {
+	float cumulative = 0.0f;
+	for (int i = 0; i < num_legal; i++) {
+		cumulative += probs[legal[i]];
+		if (r < cumulative)
+			return i;
+	}
+	return num_legal - 1;
+}
+
+template <class Game>
+class Solver {
+public:
+	typedef typename Game::State State;
+	static const int N = Game::ACTION_SLOTS;
+
+	explicit Solver(size_t table_size, uint64_t seed = 88172645463325252ULL)
+		: table(table_size), rng(seed) {}
+
+	/*
+	 * one iteration = one traversal per player, returns P1's value
+	 */
+	float iterate_vanilla() {
+		float v = vanilla(Game::root(), 0, 1.0f, 1.0f);
+		vanilla(Game::root(), 1, 1.0f, 1.0f);
+		end_iteration();
+		return v;
+	}
+
+	float iterate_chance() {
+		State s = Game::root();
+		float v = chance(s, 0, 1.0f, 1.0f);
+		chance(s, 1, 1.0f, 1.0f);
+		end_iteration();
+		return v;
+	}
+
+	float iterate_external() {
+		float v = external(Game::root(), 0);
+		external(Game::root(), 1);
+		end_iteration();
+		return v;
+	}
+
+	//u / q times the trajectory's reach is an unbiased estimate of P1's value
+	float iterate_outcome() {
+		float tail;
+		float v = outcome(Game::root(), 0, 1.0f, 1.0f, 1.0f, &tail) * tail;
+		outcome(Game::root(), 1, 1.0f, 1.0f, 1.0f, &tail);
+		end_iteration();
+		return v;
+	}
+
+	/*
+	 * CFR_PLAIN   plain regrets, unit average weight
+	 * CFR_PLUS    regrets floored at 0 on every update, average weighted by iteration
+	 * CFR_LINEAR  Linear CFR, plain regrets and unit average weight; every
+	 *             rescale_interval iterations the whole table is scaled by
+	 *             t/(t+1), t = intervals done, which weights interval t by t
+	 * CFR_DCFR    same pass with the DCFR discounts, positive regrets by
+	 *             t^a/(t^a+1), negative by t^b/(t^b+1), average by (t/(t+1))^g
+	 */
+	enum Weighting { CFR_PLAIN, CFR_PLUS, CFR_LINEAR, CFR_DCFR };
+
+	/*
+	 * one pass of the CFR_LINEAR / CFR_DCFR discount, interval = passes so far.
+	 * Factors are computed once, the pass is a single streaming sweep over
+	 * the table (split across threads when built with -fopenmp)
+	 */
+	void rescale(int interval) {
+		double t = (double)interval;
+		float pos_scale, neg_scale, avg_scale;
+		if (weighting == CFR_DCFR) {
+			pos_scale = (float)(pow(t, dcfr_alpha) / (pow(t, dcfr_alpha) + 1.0));
+			neg_scale = (float)(pow(t, dcfr_beta) / (pow(t, dcfr_beta) + 1.0));
+			avg_scale = (float)pow(t / (t + 1.0), dcfr_gamma);
+		}
+		else {
+			pos_scale = (float)(t / (t + 1.0));
+			neg_scale = pos_scale;
+			avg_scale = pos_scale;
+		}
+
+		long size = (long)table.entries.size();
+#ifdef _OPENMP
+		#pragma omp parallel for schedule(static)
+#endif
+		for (long i = 0; i < size; i++) {
+			if (table.entries[i].key == CFR_EMPTY_MAGIC)
+				continue;
+
+			InfoSet<N>* node = &table.entries[i].infoSet;
+			for (int a = 0; a < N; a++) {
+				float r = node->regret_sum[a];
+				node->regret_sum[a] = r * (r > 0.0f ? pos_scale : neg_scale);
+				node->strategy_sum[a] *= avg_scale;
+			}
+			//pending weight is strategy_sum that hasn't been written yet
+			node->avg_pending *= avg_scale;
+		}
+	}
+
+	Table<N> table;
+	Rng rng;
+	uint64_t iterations = 0;
+	uint64_t nodes_touched = 0; //decision nodes visited, the cost measure across variants
+	uint64_t traversals = 0;    //terminal histories reached, one per sampled trajectory
+	float epsilon = 0.6f; //outcome sampling exploration
+	Weighting weighting = CFR_PLAIN;
+	int rescale_interval = 1000;   //CFR_LINEAR / CFR_DCFR
+	double dcfr_alpha = 1.5;
+	double dcfr_beta = 0.0;
+	double dcfr_gamma = 2.0;
+
+	/*
+	 * Average strategy accumulation
+	 *
+	 * lazy_average: visits only add their weight to avg_pending. The strategy
+	 * can only change when the node's regrets move, so the pending weight is
+	 * pushed through it right before that (get_average_strategy does the same
+	 * for readers), which gives the same average with one write per visit.
+	 * average_stride: only accumulate on every Nth iteration, weight scaled by N.
+	 * average_filter: only accumulate at states it returns true for, e.g.
+	 * the first street when later ones get re-solved anyway.
+	 */
+	bool lazy_average = false;
+	int average_stride = 1;
+	bool (*average_filter)(const State&) = nullptr;
+
+private:
+	void end_iteration() {
+		iterations++;
+		if ((weighting == CFR_LINEAR || weighting == CFR_DCFR) && iterations % rescale_interval == 0)
+			rescale((int)(iterations / rescale_interval));
+	}
+
+	//weight of this iteration's average at s, 0 to skip it
+	float average_weight(const State& s) const {
+		uint64_t t = iterations + 1;
+		if (t % average_stride != 0 || (average_filter && !average_filter(s)))
+			return 0.0f;
+		float w = (float)average_stride;
+		return (weighting == CFR_PLUS) ? w * (float)t : w;
+	}
+
+	void accumulate_average(InfoSet<N>* node, const float* strategy, const int* legal, int num_legal, float weight) {
+		if (weight == 0.0f)
+			return;
+		if (lazy_average) {
+			node->avg_pending += weight;
+			return;
+		}
+		for (int i = 0; i < num_legal; i++)
+			node->strategy_sum[legal[i]] += weight * strategy[legal[i]];
+	}
+
+	//the regrets are about to move, settle the deferred average first
+	void settle_average(InfoSet<N>* node, const float* strategy, const int* legal, int num_legal) {
+		if (node->avg_pending == 0.0f)
+			return;
+		for (int i = 0; i < num_legal; i++)
+			node->strategy_sum[legal[i]] += node->avg_pending * strategy[legal[i]];
+		node->avg_pending = 0.0f;
+	}
+
+	void add_regret(InfoSet<N>* node, int a, float regret) {
+		float r = node->regret_sum[a] + regret;
+		node->regret_sum[a] = (weighting == CFR_PLUS && r < 0.0f) ? 0.0f : r;
+	}
+
+	float vanilla(const State& s, int traverser, float my_reach, float opp_reach) {
+		if (Game::is_terminal(s)) {
+			traversals++;
+			return Game::payoff(s, traverser);
+		}
+
+		if (Game::is_chance(s)) {
+			State next[Game::CHANCE_SLOTS];
+			float probs[Game::CHANCE_SLOTS];
+			int n = Game::chance_outcomes(s, next, probs);
+
+			float value = 0.0f;
+			for (int i = 0; i < n; i++)
+				value += probs[i] * vanilla(next[i], traverser, my_reach, opp_reach * probs[i]);
+			return value;
+		}
+
+		int legal[N];
+		int num_legal = Game::legal_actions(s, legal);
+		InfoSet<N>* node = table.get_or_create(Game::infoset_key(s));
+		nodes_touched++;
+
+		float strategy[N] = {0};
+		get_strategy(node, legal, num_legal, strategy);
+
+		float utils[N] = {0};
+		float value = 0.0f;
+
+		if (Game::player(s) == traverser) {
+			for (int i = 0; i < num_legal; i++) {
+				int a = legal[i];
+				utils[a] = vanilla(Game::apply(s, a), traverser, my_reach * strategy[a], opp_reach);
+				value += strategy[a] * utils[a];
+			}
+			accumulate_average(node, strategy, legal, num_legal, my_reach * average_weight(s));
+			settle_average(node, strategy, legal, num_legal);
+			for (int i = 0; i < num_legal; i++) {
+				int a = legal[i];
+				add_regret(node, a, opp_reach * (utils[a] - value));
+			}
+		}
+		else {
+			for (int i = 0; i < num_legal; i++) {
+				int a = legal[i];
+				value += strategy[a] * vanilla(Game::apply(s, a), traverser, my_reach, opp_reach * strategy[a]);
+			}
+		}
+
+		return value;
+	}
+
+	float chance(const State& s, int traverser, float my_reach, float opp_reach) {
+		if (Game::is_terminal(s)) {
+			traversals++;
+			return Game::payoff(s, traverser);
+		}
+
+		//sampled with its true probability, so the reach stays unweighted
+		if (Game::is_chance(s))
+			return chance(Game::sample_chance(s, rng), traverser, my_reach, opp_reach);
+
+		int legal[N];
+		int num_legal = Game::legal_actions(s, legal);
+		InfoSet<N>* node = table.get_or_create(Game::infoset_key(s));
+		nodes_touched++;
+
+		float strategy[N] = {0};
+		get_strategy(node, legal, num_legal, strategy);
+
+		float utils[N] = {0};
+		float value = 0.0f;
+
+		if (Game::player(s) == traverser) {
+			for (int i = 0; i < num_legal; i++) {
+				int a = legal[i];
+				utils[a] = chance(Game::apply(s, a), traverser, my_reach * strategy[a], opp_reach);
+				value += strategy[a] * utils[a];
+			}
+			accumulate_average(node, strategy, legal, num_legal, my_reach * average_weight(s));
+			settle_average(node, strategy, legal, num_legal);
+			for (int i = 0; i < num_legal; i++) {
+				int a = legal[i];
+				add_regret(node, a, opp_reach * (utils[a] - value));
+			}
+		}
+		else {
+			for (int i = 0; i < num_legal; i++) {
+				int a = legal[i];
+				value += strategy[a] * chance(Game::apply(s, a), traverser, my_reach, opp_reach * strategy[a]);
+			}
+		}
+
+		return value;
+	}
+
+	float external(const State& s, int traverser) {
+		if (Game::is_terminal(s)) {
+			traversals++;
+			return Game::payoff(s, traverser);
+		}
+
+		if (Game::is_chance(s))
+			return external(Game::sample_chance(s, rng), traverser);
+
+		int legal[N];
+		int num_legal = Game::legal_actions(s, legal);
+		InfoSet<N>* node = table.get_or_create(Game::infoset_key(s));
+		nodes_touched++;
+
+		float strategy[N] = {0};
+		get_strategy(node, legal, num_legal, strategy);
+
+		if (Game::player(s) == traverser) {
+			float utils[N] = {0};
+			float value = 0.0f;
+
+			for (int i = 0; i < num_legal; i++) {
+				int a = legal[i];
+				utils[a] = external(Game::apply(s, a), traverser);
+				value += strategy[a] * utils[a];
+			}
+			settle_average(node, strategy, legal, num_legal);
+			for (int i = 0; i < num_legal; i++) {
+				int a = legal[i];
+				add_regret(node, a, utils[a] - value);
+			}
+			return value;
+		}
+
+		//opponent: sample one action, simple averaging
+		accumulate_average(node, strategy, legal, num_legal, average_weight(s));
+
+		int a = legal[sample_index(strategy, legal, num_legal, rng.uniform())];
+		return external(Game::apply(s, a), traverser);
+	}
+
+	/*
+	 * returns the traverser's utility divided by the sample probability,
+	 * *tail is the reach of the sampled suffix under the current strategy
+	 */
+	float outcome(const State& s, int traverser, float my_reach, float opp_reach, float sample_prob, float* tail) {
+		if (Game::is_terminal(s)) {
+			traversals++;
+			*tail = 1.0f;
+			return Game::payoff(s, traverser) / sample_prob;
+		}
+
+		if (Game::is_chance(s))
+			return outcome(Game::sample_chance(s, rng), traverser, my_reach, opp_reach, sample_prob, tail);
+
+		int legal[N];
+		int num_legal = Game::legal_actions(s, legal);
+		InfoSet<N>* node = table.get_or_create(Game::infoset_key(s));
+		nodes_touched++;
+
+		float strategy[N] = {0};
+		get_strategy(node, legal, num_legal, strategy);
+
+		bool is_traverser = Game::player(s) == traverser;
+		float explore[N] = {0};
+		for (int i = 0; i < num_legal; i++) {
+			int a = legal[i];
+			explore[a] = is_traverser ?
+				epsilon / (float)num_legal + (1.0f - epsilon) * strategy[a] :
+				strategy[a];
+		}
+
+		int a = legal[sample_index(explore, legal, num_legal, rng.uniform())];
+		float value;
+
+		if (is_traverser) {
+			value = outcome(Game::apply(s, a), traverser, my_reach * strategy[a], opp_reach,
+					sample_prob * explore[a], tail);
+
+			float w = value * opp_reach;
+			settle_average(node, strategy, legal, num_legal);
+			for (int i = 0; i < num_legal; i++) {
+				int b = legal[i];
+				if (b == a)
+					add_regret(node, b, w * (*tail) * (1.0f - strategy[a]));
+				else
+					add_regret(node, b, -w * (*tail) * strategy[a]);
+			}
+		}
+		else {
+			value = outcome(Game::apply(s, a), traverser, my_reach, opp_reach * strategy[a],
+					sample_prob * explore[a], tail);
+
+			//stochastically weighted averaging
+			accumulate_average(node, strategy, legal, num_legal, (opp_reach / sample_prob) * average_weight(s));
+		}
+
+		*tail *= strategy[a];
+		return value;
+	}
+};
+
+} // namespace cfr
+
+#endif // CFR_HPP
@@ -0,0 +1,136 @@
+/*
+ * cfr_games.cpp — runs every CFR variant from cfr.hpp on the small games
+ *
+ * Kuhn and Leduc are cheap enough to double as correctness and speed checks
+ * for the engine that runs NLHE: Kuhn's game value is -1/18 for P1.
+ *
+ * "cfr_games --curve [scale]" prints exploitability against solver time,
+ * terminal histories reached and decision nodes touched for every variant
+ * instead, one whitespace separated row per checkpoint, ready for gnuplot.
+ *
+ * Build:
+ *   g++ -O3 -march=native -std=c++17 -o cfr_games mccfr/cfr_games.cpp
+ * With the NLHE traits, which need the hand evaluator (ranks.c / ranks.h,
+ * not part of this tree):
+ *   g++ -O3 -march=native -std=c++17 -DWITH_NLH -I <ranks dir> -o cfr_games mccfr/cfr_games.cpp <ranks dir>/ranks.c
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "cfr.hpp"
+#include "best_response.hpp"
+#include "kuhn_game.hpp"
+#include "leduc_game.hpp"
+#ifdef WITH_NLH
+#include "nlh_game.hpp"
+#endif
+
+static double now_seconds() {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+//only the variants a game is actually run with get instantiated
+template <class Game>
+static void run(const char* name, const char* variant, float (cfr::Solver<Game>::*iterate)(), int iterations) {
+	cfr::Solver<Game> solver(1000003);
+	double value_sum = 0.0;
+
+	double start = now_seconds();
+	for (int i = 0; i < iterations; i++)
+		value_sum += (solver.*iterate)();
+	double elapsed = now_seconds() - start;
+
+	printf("  %-6s %-9s %9d iters %8.3fs %9.1f ns/iter %6zu infosets  mean P1 value %+.4f\n",
+		name, variant, iterations, elapsed,
+		elapsed * 1e9 / iterations, solver.table.size(), value_sum / iterations);
+}
+
+/*
+ * exploitability checkpoints at doubling iteration counts, one row each:
+ * game variant iterations traversals nodes seconds exploitability
+ * traversals counts the terminal histories each variant actually reached
+ * (every one for vanilla, one per sampled trajectory for outcome), nodes
+ * the decision nodes. seconds is solver time only, the best response
+ * isn't counted, the rescale passes of CFR_LINEAR / CFR_DCFR are
+ */
+template <class Game>
+static void curve(const char* name, const char* variant, float (cfr::Solver<Game>::*iterate)(), int iterations,
+		typename cfr::Solver<Game>::Weighting weighting = cfr::Solver<Game>::CFR_PLAIN, int rescale_interval = 1000) {
+	cfr::Solver<Game> solver(4099); //rescale passes sweep the whole table, keep it small game sized
+	solver.weighting = weighting;
+	solver.rescale_interval = rescale_interval;
+	double elapsed = 0.0;
+	int done = 0;
+
+	for (int checkpoint = 64; done < iterations; checkpoint *= 2) {
+		if (checkpoint > iterations)
+			checkpoint = iterations;
+
+		double start = now_seconds();
+		for (; done < checkpoint; done++)
+			(solver.*iterate)();
+		elapsed += now_seconds() - start;
+
+		printf("%s %s %d %llu %llu %.6f %.6f\n", name, variant, done,
+			(unsigned long long)solver.traversals, (unsigned long long)solver.nodes_touched, elapsed,
+			cfr::exploitability<Game>(solver.table));
+	}
+}
+
+int main(int argc, char** argv) {
+	bool curves = argc > 1 && strcmp(argv[1], "--curve") == 0;
+	if (curves) {
+		argc--;
+		argv++;
+	}
+
+	int scale = (argc > 1) ? atoi(argv[1]) : 1;
+	if (scale < 1)
+		scale = 1;
+
+	typedef cfr::Solver<KuhnGame> Kuhn;
+	typedef cfr::Solver<LeducGame> Leduc;
+
+	if (curves) {
+		printf("# game variant iterations traversals nodes seconds exploitability\n");
+		curve<KuhnGame>("kuhn", "vanilla", &Kuhn::iterate_vanilla, 20000 * scale);
+		curve<KuhnGame>("kuhn", "chance", &Kuhn::iterate_chance, 200000 * scale);
+		curve<KuhnGame>("kuhn", "external", &Kuhn::iterate_external, 200000 * scale);
+		curve<KuhnGame>("kuhn", "outcome", &Kuhn::iterate_outcome, 1000000 * scale);
+
+		curve<LeducGame>("leduc", "vanilla", &Leduc::iterate_vanilla, 1000 * scale);
+		curve<LeducGame>("leduc", "chance", &Leduc::iterate_chance, 20000 * scale);
+		curve<LeducGame>("leduc", "external", &Leduc::iterate_external, 50000 * scale);
+		curve<LeducGame>("leduc", "outcome", &Leduc::iterate_outcome, 500000 * scale);
+
+		//iteration weightings on the NLH training variant
+		curve<LeducGame>("leduc", "ext-cfr+", &Leduc::iterate_external, 50000 * scale, Leduc::CFR_PLUS);
+		curve<LeducGame>("leduc", "ext-linear", &Leduc::iterate_external, 50000 * scale, Leduc::CFR_LINEAR, 100);
+		curve<LeducGame>("leduc", "ext-dcfr", &Leduc::iterate_external, 50000 * scale, Leduc::CFR_DCFR, 100);
+		return 0;
+	}
+
+	printf("=== CFR core: small game checks ===\n");
+	printf("Kuhn game value for P1 is -0.0556\n\n");
+
+	run<KuhnGame>("kuhn", "vanilla", &Kuhn::iterate_vanilla, 20000 * scale);
+	run<KuhnGame>("kuhn", "chance", &Kuhn::iterate_chance, 200000 * scale);
+	run<KuhnGame>("kuhn", "external", &Kuhn::iterate_external, 200000 * scale);
+	run<KuhnGame>("kuhn", "outcome", &Kuhn::iterate_outcome, 1000000 * scale);
+
+	run<LeducGame>("leduc", "vanilla", &Leduc::iterate_vanilla, 1000 * scale);
+	run<LeducGame>("leduc", "chance", &Leduc::iterate_chance, 20000 * scale);
+	run<LeducGame>("leduc", "external", &Leduc::iterate_external, 50000 * scale);
+	run<LeducGame>("leduc", "outcome", &Leduc::iterate_outcome, 500000 * scale);
+
+#ifdef WITH_NLH
+	init_rank_map();
+	init_flush_map();
+	run<NlhGame>("nlh", "external", &cfr::Solver<NlhGame>::iterate_external, 100 * scale);
+#endif
+	return 0;
+}
@@ -0,0 +1,110 @@
+/*
+ * kuhn_game.hpp — Kuhn poker traits for cfr.hpp, same rules as kuhn.c
+ *
+ * 3 cards (J Q K), ante 1, one bet of 1. Actions are PASS (check/fold)
+ * and BET (bet/call).
+ */
+#ifndef KUHN_GAME_HPP
+#define KUHN_GAME_HPP
+
+#include "cfr.hpp"
+
+struct KuhnGame {
+	enum { PASS = 0, BET = 1 };
+
+	struct State {
+		uint8_t cards[2];
+		uint8_t dealt;
+		uint8_t num_actions;
+		uint8_t history; //bit i = action i
+	};
+
+	static const int ACTION_SLOTS = 2;
+	static const int CHANCE_SLOTS = 6;
+
+	static State root() {
+		State s = {{0, 0}, 0, 0, 0};
+		return s;
+	}
+
+	static bool is_chance(const State& s) {
+		return !s.dealt;
+	}
+
+	static State deal(const State& s, int p1_card, int p2_card) {
+		State next = s;
+		next.cards[0] = (uint8_t)p1_card;
+		next.cards[1] = (uint8_t)p2_card;
+		next.dealt = 1;
+		return next;
+	}
+
+	static State sample_chance(const State& s, cfr::Rng& rng) {
+		int p1_card = rng.below(3);
+		int p2_card = rng.below(2);
+		if (p2_card >= p1_card)
+			p2_card++;
+		return deal(s, p1_card, p2_card);
+	}
+
+	static int chance_outcomes(const State& s, State* out, float* probs) {
+		int n = 0;
+		for (int p1_card = 0; p1_card < 3; p1_card++) {
+			for (int p2_card = 0; p2_card < 3; p2_card++) {
+				if (p1_card == p2_card)
+					continue;
+				out[n] = deal(s, p1_card, p2_card);
+				probs[n++] = 1.0f / 6.0f;
+			}
+		}
+		return n;
+	}
+
+	//pp, bp, bb, pbp, pbb
+	static bool is_terminal(const State& s) {
+		if (s.num_actions < 2)
+			return false;
+		if (s.num_actions == 3)
+			return true;
+		return s.history != 0x2; //pb is the only open 2 action line
+	}
+
+	static int player(const State& s) {
+		return s.num_actions % 2;
+	}
+
+	static int legal_actions(const State&, int* out) {
+		out[0] = PASS;
+		out[1] = BET;
+		return 2;
+	}
+
+	static State apply(const State& s, int action) {
+		State next = s;
+		next.history |= (uint8_t)(action << s.num_actions);
+		next.num_actions++;
+		return next;
+	}
+
+	static float payoff(const State& s, int p) {
+		float showdown = (s.cards[p] > s.cards[1 - p]) ? 1.0f : -1.0f;
+		int last = (s.history >> (s.num_actions - 1)) & 1;
+		int prev = (s.history >> (s.num_actions - 2)) & 1;
+
+		if (last == PASS && prev == BET) {
+			//bet then fold, the bettor wins the ante
+			int winner = (s.num_actions - 2) % 2;
+			return (p == winner) ? 1.0f : -1.0f;
+		}
+		if (last == BET)
+			return showdown * 2.0f;
+		return showdown;
+	}
+
+	static uint64_t infoset_key(const State& s) {
+		int p = player(s);
+		return (uint64_t)s.cards[p] | ((uint64_t)s.num_actions << 4) | ((uint64_t)s.history << 8);
+	}
+};
+
+#endif // KUHN_GAME_HPP
@@ -0,0 +1,196 @@
+/*
+ * leduc_game.hpp — Leduc hold'em traits for cfr.hpp
+ *
+ * 6 cards (J Q K, two suits), ante 1, fixed bets of 2 preflop and 4 on the
+ * flop, two raises per street, one board card. Same layout as leduc2.c:
+ * card / 2 is the rank.
+ */
+#ifndef LEDUC_GAME_HPP
+#define LEDUC_GAME_HPP
+
+#include "cfr.hpp"
+
+struct LeducGame {
+	enum { FOLD = 0, CALL = 1, RAISE = 2 };
+	enum { NO_CARD = 0xFF };
+
+	struct State {
+		uint32_t history;        //2 bits per action
+		uint8_t cards[2];
+		uint8_t board;
+		uint8_t dealt;
+		uint8_t street;
+		uint8_t active_player;
+		uint8_t actions_st;
+		uint8_t raises_st;
+		uint8_t num_actions;
+		uint8_t contrib[2];
+		int8_t folded;           //-1 or the player who folded
+		uint8_t finished;
+	};
+
+	static const int ACTION_SLOTS = 3;
+	static const int CHANCE_SLOTS = 30;
+
+	static int rank(int card) {
+		return card / 2;
+	}
+
+	static State root() {
+		State s = {};
+		s.board = NO_CARD;
+		s.contrib[0] = 1;
+		s.contrib[1] = 1;
+		s.folded = -1;
+		return s;
+	}
+
+	static bool is_chance(const State& s) {
+		return !s.dealt || (s.street == 1 && s.board == NO_CARD);
+	}
+
+	static State deal_hole(const State& s, int p1_card, int p2_card) {
+		State next = s;
+		next.cards[0] = (uint8_t)p1_card;
+		next.cards[1] = (uint8_t)p2_card;
+		next.dealt = 1;
+		return next;
+	}
+
+	static State deal_board(const State& s, int card) {
+		State next = s;
+		next.board = (uint8_t)card;
+		return next;
+	}
+
+	static State sample_chance(const State& s, cfr::Rng& rng) {
+		if (!s.dealt) {
+			int p1_card = rng.below(6);
+			int p2_card = rng.below(5);
+			if (p2_card >= p1_card)
+				p2_card++;
+			return deal_hole(s, p1_card, p2_card);
+		}
+
+		int card;
+		do
+			card = rng.below(6);
+		while (card == s.cards[0] || card == s.cards[1]);
+		return deal_board(s, card);
+	}
+
+	static int chance_outcomes(const State& s, State* out, float* probs) {
+		int n = 0;
+		if (!s.dealt) {
+			for (int p1_card = 0; p1_card < 6; p1_card++) {
+				for (int p2_card = 0; p2_card < 6; p2_card++) {
+					if (p1_card == p2_card)
+						continue;
+					out[n] = deal_hole(s, p1_card, p2_card);
+					probs[n++] = 1.0f / 30.0f;
+				}
+			}
+			return n;
+		}
+
+		for (int card = 0; card < 6; card++) {
+			if (card == s.cards[0] || card == s.cards[1])
+				continue;
+			out[n] = deal_board(s, card);
+			probs[n++] = 1.0f / 4.0f;
+		}
+		return n;
+	}
+
+	static bool is_terminal(const State& s) {
+		return s.finished;
+	}
+
+	static int player(const State& s) {
+		return s.active_player;
+	}
+
+	static bool facing_bet(const State& s) {
+		return s.contrib[s.active_player] < s.contrib[1 - s.active_player];
+	}
+
+	static int legal_actions(const State& s, int* out) {
+		int n = 0;
+		if (facing_bet(s))
+			out[n++] = FOLD;
+		out[n++] = CALL;
+		if (s.raises_st < 2)
+			out[n++] = RAISE;
+		return n;
+	}
+
+	static State apply(const State& s, int action) {
+		State next = s;
+		int p = s.active_player;
+		int bet = (s.street == 0) ? 2 : 4;
+
+		next.history |= (uint32_t)action << (2 * s.num_actions);
+		next.num_actions++;
+		next.actions_st++;
+
+		if (action == FOLD) {
+			next.folded = (int8_t)p;
+			next.finished = 1;
+			return next;
+		}
+
+		if (action == RAISE) {
+			next.contrib[p] = (uint8_t)(s.contrib[1 - p] + bet);
+			next.raises_st++;
+			next.active_player = (uint8_t)(1 - p);
+			return next;
+		}
+
+		//check or call
+		bool closes = facing_bet(s) || next.actions_st >= 2;
+		next.contrib[p] = s.contrib[1 - p];
+
+		if (!closes) {
+			next.active_player = (uint8_t)(1 - p);
+			return next;
+		}
+
+		if (s.street == 1) {
+			next.finished = 1;
+			return next;
+		}
+
+		next.street = 1;
+		next.actions_st = 0;
+		next.raises_st = 0;
+		next.active_player = 0;
+		return next;
+	}
+
+	static float payoff(const State& s, int p) {
+		if (s.folded >= 0)
+			return (s.folded == p) ? -(float)s.contrib[p] : (float)s.contrib[1 - p];
+
+		int board_rank = rank(s.board);
+		int mine = rank(s.cards[p]);
+		int theirs = rank(s.cards[1 - p]);
+		bool my_pair = (mine == board_rank);
+		bool their_pair = (theirs == board_rank);
+
+		if (my_pair != their_pair)
+			return my_pair ? (float)s.contrib[1 - p] : -(float)s.contrib[p];
+		if (mine != theirs)
+			return (mine > theirs) ? (float)s.contrib[1 - p] : -(float)s.contrib[p];
+		return 0.0f; //chop
+	}
+
+	static uint64_t infoset_key(const State& s) {
+		uint64_t board = (s.board == NO_CARD) ? 3 : (uint64_t)rank(s.board);
+		return (uint64_t)rank(s.cards[s.active_player])
+			| (board << 2)
+			| ((uint64_t)s.num_actions << 4)
+			| ((uint64_t)s.history << 8);
+	}
+};
+
+#endif // LEDUC_GAME_HPP
@@ -0,0 +1,195 @@
+/*
+ * nlh.cpp — NLHE blueprint training on the templated CFR core
+ *
+ * External sampling MCCFR through cfr::Solver<NlhGame> (nlh_game.hpp), the
+ * rules are in nlh.h. The table is dumped with save_blueprint() for the
+ * real-time re-solver (blueprint.h).
+ *
+ * Build (ranks.c / ranks.h provide evaluate(), init_*_map() and gto_rng_*(),
+ * they aren't part of this tree):
+ *   g++ -O3 -march=native -std=c++17 -fopenmp -I <ranks dir> -o nlh mccfr/nlh.cpp <ranks dir>/ranks.c
+ */
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "cfr.hpp"
+#include "nlh_game.hpp"
+
+extern "C" {
+#include "blueprint.h"
+}
+
+#define TABLE_SIZE         2000003
+#define TABLE_HEADROOM     100000   // more than one iteration ever adds
+
+/*
+ * Average strategy accumulation, see Solver::lazy_average and friends
+ *
+ * AVG_LAZY: opponent visits only bump avg_pending (one float) instead of
+ * writing every strategy_sum slot.
+ * AVG_STRIDE: only accumulate on every Nth iteration, weight scaled by N.
+ * AVG_FIRST_STREET_ONLY: only accumulate for preflop infosets, later
+ * streets get re-solved anyways.
+ */
+#ifndef AVG_LAZY
+#define AVG_LAZY 1
+#endif
+#ifndef AVG_STRIDE
+#define AVG_STRIDE 1
+#endif
+#ifndef AVG_FIRST_STREET_ONLY
+#define AVG_FIRST_STREET_ONLY 0
+#endif
+
+/*
+ * Iteration weighting, see Solver::Weighting
+ *
+ * WEIGHT_CFRP:   CFR+, regrets floored at 0, average weighted by iter
+ * WEIGHT_LINEAR: Linear CFR, table rescaled every RESCALE_INTERVAL iterations
+ * WEIGHT_DCFR:   DCFR, the same rescale with the DCFR_* discounts
+ */
+#define WEIGHT_CFRP    0
+#define WEIGHT_LINEAR  1
+#define WEIGHT_DCFR    2
+
+#ifndef WEIGHTING
+#define WEIGHTING WEIGHT_CFRP
+#endif
+#ifndef RESCALE_INTERVAL
+#define RESCALE_INTERVAL 1000
+#endif
+#define DCFR_ALPHA 1.5
+#define DCFR_BETA  0.0
+#define DCFR_GAMMA 2.0
+
+#ifndef NUM_ITERATIONS
+#define NUM_ITERATIONS 100000
+#endif
+
+typedef cfr::Solver<NlhGame> NlhSolver;
+typedef cfr::Table<MAX_ACTIONS> NlhTable;
+
+static bool first_street(const GameState& s) {
+	return s.street == 0;
+}
+
+/*
+ * dump every infoset for real-time re-solving (blueprint.c), raw
+ * accumulators so the reader can settle avg_pending itself
+ */
+static int save_blueprint(const NlhTable& table, const char* path) {
+	FILE* f = fopen(path, "wb");
+	if (!f)
+		return 0;
+
+	uint32_t magic = BLUEPRINT_MAGIC;
+	uint64_t count = table.size();
+
+	fwrite(&magic, sizeof(magic), 1, f);
+	fwrite(&count, sizeof(count), 1, f);
+
+	for (size_t i = 0; i < table.entries.size(); i++) {
+		if (table.entries[i].key == CFR_EMPTY_MAGIC)
+			continue;
+
+		const cfr::InfoSet<MAX_ACTIONS>* node = &table.entries[i].infoSet;
+		BlueprintRecord rec;
+		rec.key = table.entries[i].key;
+		memcpy(rec.regret_sum, node->regret_sum, sizeof(rec.regret_sum));
+		memcpy(rec.strategy_sum, node->strategy_sum, sizeof(rec.strategy_sum));
+		rec.avg_pending = node->avg_pending;
+		fwrite(&rec, sizeof(rec), 1, f);
+	}
+
+	return fclose(f) == 0;
+}
+
+static void print_node_strategy(const NlhTable& table, GameState state) {
+	const cfr::InfoSet<MAX_ACTIONS>* node = table.find(get_infoset_key(&state));
+	if (!node) {
+		printf("State not found in memory. It was never explored.\n");
+		return;
+	}
+
+	int legal_actions[MAX_ACTIONS];
+	int num_legal_actions = get_legal_actions(&state, legal_actions);
+
+	//settles any lazily deferred average weight
+	float avg[MAX_ACTIONS] = {0};
+	cfr::get_average_strategy(node, legal_actions, num_legal_actions, avg);
+
+	int32_t stack_diff = (state.active_player == P1) ?
+		(int32_t)state.p1_stack - (int32_t)state.p2_stack :
+		(int32_t)state.p2_stack - (int32_t)state.p1_stack;
+	uint32_t to_call = (stack_diff > 0) ? stack_diff : 0;
+
+	printf("\n--- Strategy for Player %d ---\n", state.active_player + 1);
+	for (int i = 0; i < num_legal_actions; i++) {
+		int a = legal_actions[i];
+
+		if (to_call > 0) {
+			if (a == 0) printf("  Fold: ");
+			else if (a == 1) printf("  Call: ");
+			else printf("  Raise %d%%: ", RAISE_PCT[a - 2]);
+		} else {
+			if (a == 0) printf("  Check: ");
+			else printf("  Bet %d%%: ", BET_PCT[a - 1]);
+		}
+
+		printf("%.2f%%\n", avg[a] * 100.0f);
+	}
+	printf("----------------------------\n");
+}
+
+int main() {
+	printf("Initializing tables...\n");
+	init_rank_map();
+	init_flush_map();
+
+	NlhSolver solver(TABLE_SIZE, (uint64_t)time(NULL));
+#if WEIGHTING == WEIGHT_DCFR
+	solver.weighting = NlhSolver::CFR_DCFR;
+#elif WEIGHTING == WEIGHT_LINEAR
+	solver.weighting = NlhSolver::CFR_LINEAR;
+#else
+	solver.weighting = NlhSolver::CFR_PLUS;
+#endif
+	solver.rescale_interval = RESCALE_INTERVAL;
+	solver.dcfr_alpha = DCFR_ALPHA;
+	solver.dcfr_beta = DCFR_BETA;
+	solver.dcfr_gamma = DCFR_GAMMA;
+	solver.lazy_average = AVG_LAZY;
+	solver.average_stride = AVG_STRIDE;
+	if (AVG_FIRST_STREET_ONLY)
+		solver.average_filter = first_street;
+
+	printf("Starting MCCFR traversal...\n");
+	for (int iter = 1; iter <= NUM_ITERATIONS; iter++) {
+		//keys carry the exact board, so the table fills long before the
+		//iterations run out; keep what's there rather than abort on a full table
+		if (solver.table.size() > TABLE_SIZE - TABLE_HEADROOM) {
+			printf("Table full after %d iterations, stopping\n", iter - 1);
+			break;
+		}
+
+		solver.iterate_external();
+
+		if (iter % 10000 == 0)
+			printf("Completed iteration %d, %zu infosets\n", iter, solver.table.size());
+	}
+
+	printf("Solving complete!\n");
+
+	if (!save_blueprint(solver.table, "blueprint.bin"))
+		printf("Couldn't write blueprint.bin\n");
+
+	//SB's first decision with pocket aces, As (bit 12) and Ah (bit 12 + 16)
+	GameState query_state = NlhGame::root();
+	query_state.p1_hand = (1ULL << 12) | (1ULL << (12 + 16));
+	print_node_strategy(solver.table, query_state);
+
+	return 0;
+}
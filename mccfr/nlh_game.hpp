@@ -0,0 +1,92 @@
+/*
+ * nlh_game.hpp — NLHE traits for cfr.hpp, wraps the rules in nlh.h
+ *
+ * The only chance node is the deal at the root: hole cards plus the whole
+ * runout (deal_runout), which advance_street reveals street by street.
+ * There's no chance_outcomes(), so only the sampling variants instantiate.
+ */
+#ifndef NLH_GAME_HPP
+#define NLH_GAME_HPP
+
+#include "cfr.hpp"
+
+extern "C" {
+#include "nlh.h"
+}
+
+struct NlhGame {
+	typedef GameState State;
+
+	static const int ACTION_SLOTS = MAX_ACTIONS;
+	static const int CHANCE_SLOTS = 1;
+
+	static State root() {
+		State s = {};
+		s.p1_stack = INITIAL_STACK - SB_CENTS;
+		s.p2_stack = INITIAL_STACK - BB_CENTS;
+		s.pot = SB_CENTS + BB_CENTS;
+		s.active_player = P1;
+		s.street = 0;
+		return s;
+	}
+
+	static bool is_chance(const State& s) {
+		return s.p1_hand == 0;
+	}
+
+	//a card outside dead_cards from rng, as a mask like draw_random_card
+	static uint64_t draw_card(uint64_t dead_cards, cfr::Rng& rng) {
+		for (;;) {
+			int card_idx = rng.below(52);
+			uint64_t mask = 1ULL << (card_idx % 13 + (card_idx / 13) * 16);
+			if ((dead_cards & mask) == 0)
+				return mask;
+		}
+	}
+
+	static State sample_chance(const State& s, cfr::Rng& rng) {
+		State next = s;
+		uint64_t dead_cards = next.board | next.p1_hand | next.p2_hand;
+		for (int i = 0; i < 4; i++) {
+			uint64_t card = draw_card(dead_cards, rng);
+			dead_cards |= card;
+			if (i < 2)
+				next.p1_hand |= card;
+			else
+				next.p2_hand |= card;
+		}
+
+		uint64_t runout[RUNOUT_CARDS];
+		for (int i = 0; i < RUNOUT_CARDS; i++) {
+			runout[i] = draw_card(dead_cards, rng);
+			dead_cards |= runout[i];
+		}
+		return set_runout(next, runout);
+	}
+
+	static bool is_terminal(const State& s) {
+		return ::is_terminal(const_cast<State*>(&s));
+	}
+
+	static int player(const State& s) {
+		return s.active_player;
+	}
+
+	static int legal_actions(const State& s, int* out) {
+		return get_legal_actions(const_cast<State*>(&s), out);
+	}
+
+	static State apply(const State& s, int action) {
+		return apply_action(s, action);
+	}
+
+	static float payoff(const State& s, int p) {
+		return evaluate_payoff(const_cast<State*>(&s), p);
+	}
+
+	static uint64_t infoset_key(const State& s) {
+		return get_infoset_key(const_cast<State*>(&s));
+	}
+};
+
+#endif // NLH_GAME_HPP
@@ -2,6 +2,8 @@
 #include "Constants.h"
 #include "Util.h"
 #include <locale>
+#include <cstdlib>
+#include <numeric>
 #include <algorithm>
 #include <cassert>
 
@@ -46,6 +48,20 @@ CardRange::CardRange(const std::vector<std::array<uint8_t,2>>& combos)
     removeDuplicates();
 }
 
+// Construct from vector with weights.
+CardRange::CardRange(const std::vector<std::array<uint8_t,2>>& combos, const std::vector<double>& weights)
+{
+    omp_assert(combos.size() == weights.size());
+    for (size_t i = 0; i < combos.size(); ++i)
+        addCombo(combos[i][0], combos[i][1], weights[i]);
+    removeDuplicates();
+}
+
+bool CardRange::weighted() const
+{
+    return std::any_of(mWeights.begin(), mWeights.end(), [](double w){ return w != 1; });
+}
+
 // Card mask from a string.
 uint64_t CardRange::getCardMask(const std::string& text)
 {
@@ -73,6 +89,7 @@ uint64_t CardRange::getCardMask(const std::string& text)
 bool CardRange::parseHand(const char*&p)
 {
     const char* backtrack = p;
+    size_t firstCombo = mCombinations.size();
 
     bool explicitSuits = false;
     unsigned r1, r2, s1, s2;
@@ -107,6 +124,20 @@ bool CardRange::parseHand(const char*&p)
             addCombos(r1, r2, suited, offsuited);
     }
 
+    // Optional weight for everything the hand expression added.
+    if (parseChar(p, ':')) {
+        char* end;
+        double weight = std::strtod(p, &end);
+        if (end == p || weight < 0) {
+            p = backtrack;
+            mCombinations.resize(firstCombo);
+            mWeights.resize(firstCombo);
+            return false;
+        }
+        p = end;
+        std::fill(mWeights.begin() + firstCombo, mWeights.end(), weight);
+    }
+
     return true;
 }
 
@@ -179,19 +210,24 @@ void CardRange::addAll()
             addCombo(c1, c2);
 }
 
-void CardRange::addCombo(unsigned c1, unsigned c2)
+void CardRange::addCombo(unsigned c1, unsigned c2, double weight)
 {
     omp_assert(c1 != c2);
     if (c1 >> 2 < c2 >> 2 || (c1 >> 2 == c2 >> 2 && (c1 & 3) < (c2 & 3)))
         std::swap(c1, c2);
     mCombinations.push_back({(uint8_t)c1, (uint8_t)c2});
+    mWeights.push_back(weight);
 }
 
-// Removes duplicate combos.
+// Removes duplicate combos. If a combo is listed more than once the last weight wins, so that "AK,AKs:0.5"
+// works as expected. Combos with zero weight are removed too.
 void CardRange::removeDuplicates()
 {
-    std::sort(mCombinations.begin(), mCombinations.end(), [](const std::array<uint8_t,2>& lhs,
-              const std::array<uint8_t,2>& rhs){
+    std::vector<size_t> order(mCombinations.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [this](size_t a, size_t b){
+        const std::array<uint8_t,2>& lhs = mCombinations[a];
+        const std::array<uint8_t,2>& rhs = mCombinations[b];
         if (lhs[0] >> 2 != rhs[0] >> 2)
             return lhs[0] >> 2 < rhs[0] >> 2;
         if (lhs[1] >> 2 != rhs[1] >> 2)
@@ -200,11 +236,20 @@ void CardRange::removeDuplicates()
             return (lhs[0] & 3) < (rhs[0] & 3);
         return (lhs[1] & 3) < (rhs[1] & 3);
     });
-    auto last = std::unique(mCombinations.begin(), mCombinations.end(), [](const std::array<uint8_t,2>& lhs,
-                            const std::array<uint8_t,2>& rhs){
-        return lhs[0] == rhs[0] && lhs[1] == rhs[1];
-    });
-    mCombinations.erase(last, mCombinations.end());
+
+    std::vector<std::array<uint8_t,2>> combos;
+    std::vector<double> weights;
+    for (size_t i = 0; i < order.size(); ++i) {
+        const std::array<uint8_t,2>& combo = mCombinations[order[i]];
+        if (i + 1 < order.size() && mCombinations[order[i + 1]] == combo)
+            continue;
+        if (mWeights[order[i]] <= 0)
+            continue;
+        combos.push_back(combo);
+        weights.push_back(mWeights[order[i]]);
+    }
+    mCombinations.swap(combos);
+    mWeights.swap(weights);
 }
 
 unsigned CardRange::charToRank(char c)
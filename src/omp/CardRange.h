@@ -8,7 +8,7 @@
 
 namespace omp {
 
-// Stores a set of unique starting hands for Texas Holdem.
+// Stores a set of unique starting hands for Texas Holdem, each with a weight (1 by default).
 class CardRange
 {
 public:
@@ -24,6 +24,7 @@ public:
     // 44+ : pocket pair and all higher pairs
     // K4+,Q8s,84 : multiple hands can be combined with comma
     // random : all hands
+    // AKs:0.5 : weight for all combos of a hand, e.g. a mixed strategy frequency
     // Spaces and non-matching characters in the end are ignored. The expressions are case-insensitive.
     CardRange(const std::string& text);
     CardRange(const char* text);
@@ -31,6 +32,10 @@ public:
     // Constructs a range from a list of two-card combinations.
     CardRange(const std::vector<std::array<uint8_t,2>>& combos);
 
+    // Constructs a weighted range from a list of two-card combinations and a weight for each. Combos with zero
+    // weight are left out.
+    CardRange(const std::vector<std::array<uint8_t,2>>& combos, const std::vector<double>& weights);
+
     // Returns a list of card combinations belonging to this range. Guarantees that there are no duplicates.
     // Cards in each combo are ordered so that the bigger rank is always first. The whole vector is sorted in the
     // following order: 1) rank of first card 2) rank of second card 3) suit of first card 4) suit of second card
@@ -39,6 +44,15 @@ public:
         return mCombinations;
     }
 
+    // Weight of each combo in combinations().
+    const std::vector<double>& weights() const
+    {
+        return mWeights;
+    }
+
+    // True if any combo has a weight other than 1.
+    bool weighted() const;
+
     // Returns a 64-bit bitmask of cards from a string like "2c8hAh".
     static uint64_t getCardMask(const std::string& text);
 
@@ -50,12 +64,13 @@ private:
     void addAll();
     void addCombos(unsigned rank1, unsigned rank2, bool suited, bool offsuited);
     void addCombosPlus(unsigned rank1, unsigned rank2, bool suited, bool offsuited);
-    void addCombo(unsigned c1, unsigned c2);
+    void addCombo(unsigned c1, unsigned c2, double weight = 1);
     void removeDuplicates();
     static unsigned charToRank(char c);
     static unsigned charToSuit(char c);
 
     std::vector<std::array<uint8_t,2>> mCombinations;
+    std::vector<double> mWeights;
 };
 
 }
@@ -13,12 +13,15 @@ CombinedRange::CombinedRange()
 {
 }
 
-CombinedRange::CombinedRange(unsigned playerIdx, const std::vector<std::array<uint8_t,2>>& holeCards)
+CombinedRange::CombinedRange(unsigned playerIdx, const std::vector<std::array<uint8_t,2>>& holeCards,
+                             const std::vector<double>& weights)
 {
+    omp_assert(weights.empty() || weights.size() == holeCards.size());
     mPlayerCount = 1;
     mPlayers[0] = playerIdx;
-    for (auto& h: holeCards) {
-        Combo c{1ull << h[0] | 1ull << h[1], {h}, {Hand(h)}};
+    for (size_t i = 0; i < holeCards.size(); ++i) {
+        auto& h = holeCards[i];
+        Combo c{1ull << h[0] | 1ull << h[1], {h}, {Hand(h)}, weights.empty() ? 1.0 : weights[i]};
         mCombos.emplace_back(c);
     }
     mSize = mCombos.size();
@@ -44,6 +47,7 @@ CombinedRange CombinedRange::join(const CombinedRange& range2) const
             std::copy(std::begin(c2.holeCards), std::begin(c2.holeCards) + range2.mPlayerCount, std::begin(c.holeCards) + mPlayerCount);
             for (unsigned i = 0; i < newRange.mPlayerCount; ++i)
                 c.evalHands[i] = Hand(c.holeCards[i]);
+            c.weight = c1.weight * c2.weight;
             newRange.mCombos.push_back(c);
         }
     }
@@ -67,11 +71,14 @@ uint64_t CombinedRange::estimateJoinSize(const CombinedRange& range2) const
 }
 
 std::vector<CombinedRange> CombinedRange::joinRanges(
-        const std::vector<std::vector<std::array<uint8_t,2>>>& holeCardRanges, size_t maxSize)
+        const std::vector<std::vector<std::array<uint8_t,2>>>& holeCardRanges, size_t maxSize,
+        const std::vector<std::vector<double>>& weights)
 {
     std::vector<CombinedRange> combinedRanges;
-    for (unsigned i = 0; i < holeCardRanges.size(); ++i)
-        combinedRanges.emplace_back(CombinedRange{i, holeCardRanges[i]});
+    for (unsigned i = 0; i < holeCardRanges.size(); ++i) {
+        std::vector<double> rangeWeights = weights.empty() ? std::vector<double>{} : weights[i];
+        combinedRanges.emplace_back(CombinedRange{i, holeCardRanges[i], rangeWeights});
+    }
 
     for (;;) {
         uint64_t bestSize = ~0ull;
@@ -101,4 +108,12 @@ void CombinedRange::shuffle()
     std::shuffle(mCombos.begin(), mCombos.end(), rng);
 }
 
+std::vector<double> CombinedRange::weights() const
+{
+    std::vector<double> result;
+    for (const Combo& c : mCombos)
+        result.push_back(c.weight);
+    return result;
+}
+
 }
@@ -21,13 +21,16 @@ public:
         uint64_t cardMask;
         std::array<std::array<uint8_t,2>,MAX_PLAYERS> holeCards;
         Hand evalHands[MAX_PLAYERS];
+        // Product of the players' combo weights.
+        double weight;
     };
 
     // Default constructor (0 players).
     CombinedRange();
 
-    // Create a range for one player.
-    CombinedRange(unsigned playerIdx, const std::vector<std::array<uint8_t,2>>& holeCards);
+    // Create a range for one player. Weights are optional, all combos have weight 1 without them.
+    CombinedRange(unsigned playerIdx, const std::vector<std::array<uint8_t,2>>& holeCards,
+                  const std::vector<double>& weights = {});
 
     // Combine with another range and return the result.
     CombinedRange join(const CombinedRange& range2) const;
@@ -36,12 +39,16 @@ public:
     uint64_t estimateJoinSize(const CombinedRange& range2) const;
 
     // Takes multiple ranges and combines as many of them as possible, while keeping range sizes below the limit.
+    // Weights are optional like in the constructor, one vector per range.
     static std::vector<CombinedRange> joinRanges(const std::vector<std::vector<std::array<uint8_t,2>>>& holeCardRanges,
-                                              size_t maxSize);
+                                              size_t maxSize, const std::vector<std::vector<double>>& weights = {});
 
     // Randomize order of combos (good for random walk simulation).
     void shuffle();
 
+    // Combo weights in combos() order, e.g. for an AliasDistribution.
+    std::vector<double> weights() const;
+
     unsigned playerCount() const
     {
         return mPlayerCount;
@@ -9,6 +9,13 @@
 
 namespace omp {
 
+// Adds to an atomic that only the calling thread writes, so no read-modify-write instruction is needed.
+template<class T>
+static void addRelaxed(std::atomic<T>& a, T value)
+{
+    a.store(a.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+}
+
 // Start new calculation and spawn threads.
 bool EquityCalculator::start(const std::vector<CardRange>& handRanges, uint64_t boardCards, uint64_t deadCards,
                              bool enumerateAll, double stdevTarget, std::function<void(const Results&)> callback,
@@ -21,45 +28,76 @@ bool EquityCalculator::start(const std::vector<CardRange>& handRanges, uint64_t
     if (2 * handRanges.size() + bitCount(deadCards) + BOARD_CARDS > CARD_COUNT)
         return false;
 
+    // Cached preflop results are only valid for the board and dead cards they were calculated with, and the cache
+    // slot size depends on player count.
+    if (boardCards != mBoardCards || deadCards != mDeadCards || mLookupStride != 1u << handRanges.size()) {
+        clearLookup();
+        mLookupStride = 1u << handRanges.size();
+    }
+
     // Set up card ranges.
     mDeadCards = deadCards;
     mBoardCards = boardCards;
     mOriginalHandRanges = handRanges;
-    mHandRanges = removeInvalidCombos(handRanges, mDeadCards | mBoardCards);
-    std::vector<CombinedRange> combinedRanges = CombinedRange::joinRanges(mHandRanges, MAX_COMBINED_RANGE_SIZE);
+    mHandRanges = removeInvalidCombos(handRanges, mDeadCards | mBoardCards, &mHandWeights);
+    mWeighted = std::any_of(handRanges.begin(), handRanges.end(), [](const CardRange& r){ return r.weighted(); });
+    std::vector<CombinedRange> combinedRanges = CombinedRange::joinRanges(mHandRanges, MAX_COMBINED_RANGE_SIZE,
+                                                                          mHandWeights);
     for (unsigned i = 0; i < combinedRanges.size(); ++i) {
         if (combinedRanges[i].combos().size() == 0)
             return false;
         if (!enumerateAll)
             combinedRanges[i].shuffle();
         mCombinedRanges[i] = combinedRanges[i];
+        if (mWeighted && !enumerateAll)
+            mComboAliases[i].init(combinedRanges[i].weights());
     }
     mCombinedRangeCount = (unsigned)combinedRanges.size();
 
     // Set up simulation settings.
+    if (threadCount == 0 || threadCount > mThreadPool->threadCount())
+        threadCount = mThreadPool->threadCount();
+    if (mThreadResults.size() != threadCount)
+        mThreadResults = std::vector<ThreadResults>(threadCount);
+    for (ThreadResults& r : mThreadResults)
+        r.reset();
     mEnumPosition = 0;
-    mBatchSum = mBatchSumSqr = mBatchCount = 0;
-    mResults = Results();
-    mResults.players = (unsigned)handRanges.size();
-    mResults.enumerateAll = enumerateAll;
-    mUpdateResults = mResults;
+    mTotalHands = 0;
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mUpdateResults = Results();
+        mUpdateResults.players = (unsigned)handRanges.size();
+        mUpdateResults.enumerateAll = enumerateAll;
+    }
     mStdevTarget = stdevTarget;
     mCallback = callback;
     mUpdateInterval = updateInterval;
     mStopped = false;
-    mLastUpdate = std::chrono::high_resolution_clock::now();
-    if (threadCount == 0)
-        threadCount = std::thread::hardware_concurrency();
+    mStartTime = std::chrono::high_resolution_clock::now();
+    mLastUpdate = 0;
+    mNextUpdate = updateInterval;
     mUnfinishedThreads = threadCount;
 
-    // Start threads.
-    mThreads.clear();
+    // Queue one job per thread. Each one reserves batches until there's nothing left or the calculation is stopped.
+    {
+        std::lock_guard<std::mutex> lock(mJobMutex);
+        mRunningJobs = threadCount;
+    }
     for (unsigned i = 0; i < threadCount; ++i) {
-        mThreads.emplace_back([this,enumerateAll]{
+        mThreadPool->submit([this,enumerateAll,i]{
+            ThreadResults& threadResults = mThreadResults[i];
             if (enumerateAll)
-                enumerate();
+                enumerate(threadResults);
+            else if (mStratified)
+                simulateStratifiedMonteCarlo(threadResults);
+            else if (mWeighted)
+                simulateRegularMonteCarlo(threadResults);
             else
-                simulateRandomWalkMonteCarlo();
+                simulateRandomWalkMonteCarlo(threadResults);
+
+            std::lock_guard<std::mutex> lock(mJobMutex);
+            if (--mRunningJobs == 0)
+                mJobsDone.notify_all();
         });
     }
 
@@ -68,7 +106,7 @@ bool EquityCalculator::start(const std::vector<CardRange>& handRanges, uint64_t
 }
 
 // Regular monte carlo simulation.
-void EquityCalculator::simulateRegularMonteCarlo()
+void EquityCalculator::simulateRegularMonteCarlo(ThreadResults& threadResults)
 {
     unsigned nplayers = (unsigned)mHandRanges.size();
     Hand fixedBoard = getBoardFromBitmask(mBoardCards);
@@ -88,7 +126,8 @@ void EquityCalculator::simulateRegularMonteCarlo()
         Hand playerHands[MAX_PLAYERS];
         bool ok = true;
         for (unsigned i = 0; i < combinedRangeCount; ++i) {
-            unsigned comboIdx = comboDists[i](rng);
+            // Rejecting conflicts keeps the weighted probabilities proportional to the product of combo weights.
+            unsigned comboIdx = mWeighted ? mComboAliases[i](rng) : comboDists[i](rng);
             const CombinedRange::Combo& combo = mCombinedRanges[i].combos()[comboIdx];
             if (usedCardsMask & combo.cardMask) {
                 ok = false;
@@ -114,14 +153,14 @@ void EquityCalculator::simulateRegularMonteCarlo()
 
         // Update periodically.
         if ((stats.evalCount & 0xfff) == 0) {
-            updateResults(stats, false);
+            updateResults(threadResults, stats, false);
             stats = BatchResults(nplayers);
             if (mStopped)
                 break;
         }
     }
 
-    updateResults(stats, true);
+    updateResults(threadResults, stats, true);
 }
 
 // Monte carlo simulation using a random walk. On each iteration a random player is chosen and the next feasible
@@ -129,7 +168,7 @@ void EquityCalculator::simulateRegularMonteCarlo()
 // visited the preflop combinations can be thought of as a directed k-regular graph. The transition probability
 // matrix P then has k non-zero values on each row and column, and all non-zero elements have value of 1/k.
 // It is easy to see that (1,1,...,1) * P = (1,1,...,1), i.e. (1,1,...,1) is a stable distribution.
-void EquityCalculator::simulateRandomWalkMonteCarlo()
+void EquityCalculator::simulateRandomWalkMonteCarlo(ThreadResults& threadResults)
 {
     unsigned nplayers = (unsigned)mHandRanges.size();
     Hand fixedBoard = getBoardFromBitmask(mBoardCards);
@@ -158,7 +197,7 @@ void EquityCalculator::simulateRandomWalkMonteCarlo()
 
             // Update results periodically.
             if ((stats.evalCount & 0xfff) == 0) {
-                updateResults(stats, false);
+                updateResults(threadResults, stats, false);
                 if (mStopped)
                     break;
                 stats = BatchResults(nplayers);
@@ -191,7 +230,168 @@ void EquityCalculator::simulateRandomWalkMonteCarlo()
         }
     }
 
-    updateResults(stats, true);
+    updateResults(threadResults, stats, true);
+}
+
+// Stratified monte carlo. Instead of drawing everything independently, each thread walks through all preflop
+// combinations of the combined ranges in a scrambled order (like enumerate(), but starting from a random offset and
+// wrapping around), and the first one or two undealt board cards go through a shuffled list of every position (or
+// position pair) in the remaining deck. The remaining deck has the same size for every preflop, so each stratum is
+// equally likely and each sample stays unbiased, while every batch covers preflops and boards much more evenly than
+// independent draws. Weighted ranges accept a preflop with probability weight / max weight.
+// The first player's equity is also summed per board stratum and per combo of the first range, which the walk visits
+// in proportion too. With proportional allocation the variance of the mean is the within strata variance / n, and
+// the two stratifications together leave board + hand - total of it (additive two way model), so that sets stdev.
+void EquityCalculator::simulateStratifiedMonteCarlo(ThreadResults& threadResults)
+{
+    unsigned nplayers = (unsigned)mHandRanges.size();
+    Hand fixedBoard = getBoardFromBitmask(mBoardCards);
+    unsigned remainingCards = BOARD_CARDS - fixedBoard.count();
+    if (remainingCards == 0) {
+        simulateRegularMonteCarlo(threadResults);
+        return;
+    }
+
+    BatchResults stats(nplayers);
+    Rng rng{std::random_device{}()};
+    FastUniformIntDistribution<unsigned,16> cardDist(0, CARD_COUNT - 1);
+    unsigned combinedRangeCount = mCombinedRangeCount;
+    uint64_t preflopCombos = getPreflopCombinationCount();
+    UniqueRng64 urng(preflopCombos);
+    libdivide::libdivide_u64_t fastDividers[MAX_PLAYERS];
+    double maxWeight = 1;
+    for (unsigned i = 0; i < combinedRangeCount; ++i) {
+        fastDividers[i] = libdivide::libdivide_u64_gen(mCombinedRanges[i].combos().size());
+        double rangeMax = 0;
+        for (auto& combo : mCombinedRanges[i].combos())
+            rangeMax = std::max(rangeMax, combo.weight);
+        maxWeight *= rangeMax;
+    }
+
+    // Strata are deck positions (first card) or position pairs (first two cards).
+    unsigned deckSize = CARD_COUNT - bitCount(mBoardCards | mDeadCards) - 2 * nplayers;
+    unsigned strataCards = std::min(remainingCards, 2u);
+    std::vector<std::array<uint8_t,2>> strata;
+    for (unsigned i = 0; i < deckSize; ++i) {
+        if (strataCards == 1)
+            strata.push_back({(uint8_t)i, 0});
+        else
+            for (unsigned j = i + 1; j < deckSize; ++j)
+                strata.push_back({(uint8_t)i, (uint8_t)j});
+    }
+    std::vector<unsigned> strataOrder(strata.size());
+    for (size_t i = 0; i < strata.size(); ++i)
+        strataOrder[i] = (unsigned)i;
+    std::shuffle(strataOrder.begin(), strataOrder.end(), rng);
+    size_t stratum = 0;
+    // Equity sums per board stratum and per combo of the first range, the preflop walk stratifies those.
+    std::vector<double> boardSum(strata.size()), boardSumSqr(strata.size()), boardCount(strata.size());
+    size_t handStrata = mCombinedRanges[0].combos().size();
+    std::vector<double> handSum(handStrata), handSumSqr(handStrata), handCount(handStrata);
+    double samples = 0, sampleSum = 0, sampleSumSqr = 0;
+    auto withinVariance = [](const std::vector<double>& sum, const std::vector<double>& sumSqr,
+                             const std::vector<double>& count) {
+        double ss = 0, n = 0, used = 0;
+        for (size_t i = 0; i < sum.size(); ++i) {
+            if (count[i] == 0)
+                continue;
+            ss += sumSqr[i] - sum[i] * sum[i] / count[i];
+            n += count[i];
+            used += 1;
+        }
+        return n > used ? ss / (n - used) : 0.25;
+    };
+    auto setStrataVariance = [&](BatchResults& batch) {
+        double total = samples > 1 ? (sampleSumSqr - sampleSum * sampleSum / samples) / (samples - 1) : 0.25;
+        double board = withinVariance(boardSum, boardSumSqr, boardCount);
+        double hand = withinVariance(handSum, handSumSqr, handCount);
+        batch.strataSamples = samples;
+        batch.strataVariance = std::max(board + hand - total, 0.0) * samples;
+    };
+
+    uint64_t allCards = (1ull << CARD_COUNT) - 1;
+    uint64_t preflopPos = rng() % preflopCombos;
+    for (;;) {
+        // Map the scrambled preflop index to hands like in enumerate().
+        uint64_t enumPos = urng(preflopPos);
+        if (++preflopPos == preflopCombos)
+            preflopPos = 0;
+
+        uint64_t usedCardsMask = mDeadCards | mBoardCards;
+        Hand playerHands[MAX_PLAYERS];
+        double preflopWeight = 1;
+        size_t handStratum = 0;
+        bool ok = true;
+        for (unsigned i = 0; i < combinedRangeCount; ++i) {
+            uint64_t quotient = libdivide_u64_do(enumPos, &fastDividers[i]);
+            uint64_t remainder = enumPos - quotient * mCombinedRanges[i].combos().size();
+            enumPos = quotient;
+
+            if (i == 0)
+                handStratum = (size_t)remainder;
+            const CombinedRange::Combo& combo = mCombinedRanges[i].combos()[(size_t)remainder];
+            if (usedCardsMask & combo.cardMask) {
+                ok = false;
+                break;
+            }
+            for (unsigned j = 0; j < mCombinedRanges[i].playerCount(); ++j) {
+                unsigned playerIdx = mCombinedRanges[i].players()[j];
+                playerHands[playerIdx] = combo.evalHands[j];
+            }
+            usedCardsMask |= combo.cardMask;
+            preflopWeight *= combo.weight;
+        }
+
+        if (ok && mWeighted && preflopWeight < maxWeight)
+            ok = (rng() >> 11) * (1.0 / 9007199254740992.0) * maxWeight < preflopWeight;
+        if (!ok) {
+            if (++stats.skippedPreflopCombos > 1000000 && stats.evalCount == 0)
+                break;
+            continue;
+        }
+
+        // Map stratum positions to the cards left in the deck, positions are in ascending card order.
+        Hand board = fixedBoard;
+        uint64_t deck = allCards & ~usedCardsMask;
+        size_t h = strataOrder[stratum];
+        for (unsigned i = 0, k = 0; i < strataCards; ++i) {
+            for (; k < strata[h][i]; ++k)
+                deck &= deck - 1;
+            unsigned card = countTrailingZeros(deck);
+            board += card;
+            usedCardsMask |= 1ull << card;
+        }
+        if (++stratum == strata.size()) {
+            std::shuffle(strataOrder.begin(), strataOrder.end(), rng);
+            stratum = 0;
+        }
+
+        randomizeBoard(board, remainingCards - strataCards, usedCardsMask, rng, cardDist);
+        unsigned winners = evaluateHands(playerHands, nplayers, board, &stats, 1);
+        double equity = (winners & 1) ? 1.0 / bitCount(winners) : 0.0;
+        boardSum[h] += equity;
+        boardSumSqr[h] += equity * equity;
+        boardCount[h] += 1;
+        handSum[handStratum] += equity;
+        handSumSqr[handStratum] += equity * equity;
+        handCount[handStratum] += 1;
+        samples += 1;
+        sampleSum += equity;
+        sampleSumSqr += equity * equity;
+
+        // Update periodically.
+        if ((stats.evalCount & 0xfff) == 0) {
+            setStrataVariance(stats);
+            updateResults(threadResults, stats, false);
+            stats = BatchResults(nplayers);
+            if (mStopped)
+                break;
+        }
+    }
+
+    if (samples > 0)
+        setStrataVariance(stats);
+    updateResults(threadResults, stats, true);
 }
 
 // Randomize holecards using rejection sampling. Returns false if maximum number of attempts was reached.
@@ -237,9 +437,9 @@ void EquityCalculator::randomizeBoard(Hand& board, unsigned remainingCards, uint
     }
 }
 
-// Evaluates a single showdown with one or more players and stores the result.
+// Evaluates a single showdown with one or more players and stores the result. Returns the mask of the winners.
 template<bool tFlushPossible>
-void EquityCalculator::evaluateHands(const Hand* playerHands, unsigned nplayers, const Hand& board, BatchResults* stats,
+unsigned EquityCalculator::evaluateHands(const Hand* playerHands, unsigned nplayers, const Hand& board, BatchResults* stats,
                                      unsigned weight)
 {
     omp_assert(board.count() == BOARD_CARDS);
@@ -258,10 +458,11 @@ void EquityCalculator::evaluateHands(const Hand* playerHands, unsigned nplayers,
     }
 
     stats->winsByPlayerMask[winnersMask] += weight;
+    return winnersMask;
 }
 
 // Calculates exact equities by enumerating through all possible combinations.
-void EquityCalculator::enumerate()
+void EquityCalculator::enumerate(ThreadResults& threadResults)
 {
     uint64_t enumPosition = 0, enumEnd = 0;
     uint64_t preflopCombos = getPreflopCombinationCount();
@@ -274,9 +475,15 @@ void EquityCalculator::enumerate()
     for (unsigned i = 0; i < combinedRangeCount; ++i)
         fastDividers[i] = libdivide::libdivide_u64_gen(mCombinedRanges[i].combos().size());
 
-    // Lookup overhead becomes too much if postflop tree is very small.
+    // Lookup overhead becomes too much if postflop tree is very small. With at least two suits that can't make a flush
+    // the hole cards in them are interchangeable, which makes the hit rate high enough to pay off on the turn too.
     uint64_t postflopCombos = getPostflopCombinationCount();
-    bool useLookup = postflopCombos > 500;
+    bool useLookup = postflopCombos > 500 || (postflopCombos > 1 && irrelevantSuitCount() >= 2);
+
+    // Cached preflops are combined locally and the shared results updated only once in a while. The limit keeps
+    // the 32-bit counters from overflowing.
+    uint64_t maxBatchPreflops = useLookup ? std::min<uint64_t>(10000, (1u << 30) / postflopCombos) : ~0ull;
+    uint64_t batchPreflops = 0;
 
     // Disable random preflop enumeration order if postflop is too small (bad for caching). It's also makes no sense
     // if all the combos don't fit in the lookup table.
@@ -298,6 +505,7 @@ void EquityCalculator::enumerate()
         // Map enumeration index to actual hands and check duplicate card.
         bool ok = true;
         uint64_t usedCardsMask = mBoardCards | mDeadCards;
+        double preflopWeight = 1;
         HandWithPlayerIdx playerHands[MAX_PLAYERS];
         for (unsigned i = 0; i < combinedRangeCount; ++i) {
             uint64_t quotient = libdivide_u64_do(randomizedEnumPos, &fastDividers[i]);
@@ -310,6 +518,7 @@ void EquityCalculator::enumerate()
                 break;
             }
             usedCardsMask |= combo.cardMask;
+            preflopWeight *= combo.weight;
             for (unsigned j = 0; j < mCombinedRanges[i].playerCount(); ++j) {
                 unsigned playerIdx = mCombinedRanges[i].players()[j];
                 playerHands[playerIdx].cards = combo.holeCards[j];
@@ -337,45 +546,46 @@ void EquityCalculator::enumerate()
                 });
 
                 // Save original player indexes cause we eventually want the results for the original order.
+                BatchResults preflopStats(nplayers);
                 for (unsigned i = 0; i < nplayers; ++i)
-                    stats.playerIds[i] = playerHands[i].playerIdx;
+                    preflopStats.playerIds[i] = playerHands[i].playerIdx;
 
                 // Suit isomorphism.
                 transformSuits(playerHands, nplayers, &boardCards, &deadCards);
+                transformIrrelevantSuits(playerHands, nplayers, boardCards, deadCards);
                 usedCardsMask = boardCards | deadCards;
                 for (unsigned j = 0; j < nplayers; ++j)
                     usedCardsMask |= (1ull << playerHands[j].cards[0]) | (1ull << playerHands[j].cards[1]);
 
                 // Get cached results if this combo has already been calculated.
                 uint64_t preflopId = calculateUniquePreflopId(playerHands, nplayers);
-                if (lookupResults(preflopId, stats)) {
-                    for (unsigned i = 0; i < nplayers; ++i)
-                        stats.playerIds[i] = playerHands[i].playerIdx;
-                    stats.evalCount = 0;
-                    stats.uniquePreflopCombos = 0;
-                } else {
+                if (!lookupResults(preflopId, preflopStats)) {
                     // Do full postflop enumeration.
                     ++stats.uniquePreflopCombos;
                     Hand board = getBoardFromBitmask(boardCards);
-                    enumerateBoard(playerHands, nplayers, board, usedCardsMask, &stats);
-                    storeResults(preflopId, stats);
+                    enumerateBoard(playerHands, nplayers, board, usedCardsMask, &preflopStats);
+                    storeResults(preflopId, preflopStats);
+                    stats.evalCount += preflopStats.evalCount;
                 }
+                addPermutedResults(stats, preflopStats, nplayers);
             } else {
                 ++stats.uniquePreflopCombos;
                 enumerateBoard(playerHands, nplayers, fixedBoard, usedCardsMask, &stats);
             }
         }
 
-        //TODO combine lookup results here so we don't need update so often
-        if (stats.evalCount >= 10000 || stats.skippedPreflopCombos >= 10000 || useLookup) {
-            updateResults(stats, false);
+        // Weighted ranges need an update for every preflop, because the weight applies to the whole batch.
+        if (stats.evalCount >= 10000 || stats.skippedPreflopCombos >= 10000 || ++batchPreflops >= maxBatchPreflops
+            || mWeighted) {
+            updateResults(threadResults, stats, false, preflopWeight);
             stats = BatchResults(nplayers);
+            batchPreflops = 0;
             if (mStopped)
                 break;
         }
     }
 
-    updateResults(stats, true);
+    updateResults(threadResults, stats, true);
 }
 
 // Starts the postflop enumeration.
@@ -513,17 +723,371 @@ void EquityCalculator::enumerateBoardRec(const Hand* playerHands, unsigned nplay
     }
 }
 
+// Applies a suit permutation to a card mask.
+static uint64_t permuteSuits(uint64_t cards, const unsigned* perm)
+{
+    uint64_t result = 0;
+    for (unsigned c = 0; c < CARD_COUNT; ++c) {
+        if (cards & (1ull << c))
+            result |= 1ull << ((c & RANK_MASK) | perm[c & SUIT_MASK]);
+    }
+    return result;
+}
+
+// Combo-vs-combo equity matrix. Runouts are grouped into orbits under the suit permutations that keep board and
+// dead cards in place, and only one runout per orbit is evaluated, weighted by orbit size. That sum isn't correct
+// for any single pair, but summing it over every permutation of the group is (each orbit gets counted |group| times),
+// so the group is applied to the accumulated matrix once at the end.
+bool EquityCalculator::calculateEquityMatrix(EquityMatrix& matrix, uint64_t boardCards, uint64_t deadCards,
+                                             unsigned threadCount) const
+{
+    unsigned boardCount = bitCount(boardCards);
+    if (boardCount < 3 || boardCount > BOARD_CARDS || (boardCards & deadCards))
+        return false;
+
+    matrix.boardCards = boardCards;
+    matrix.deadCards = deadCards;
+    for (unsigned i = 0; i < COMBO_COUNT; ++i) {
+        auto cards = comboCards(i);
+        matrix.comboMasks[i] = (1ull << cards[0]) | (1ull << cards[1]);
+    }
+
+    // Suit permutations that map board and dead cards onto themselves.
+    std::vector<std::array<unsigned,SUIT_COUNT>> group;
+    std::array<unsigned,SUIT_COUNT> perm = {0, 1, 2, 3};
+    do {
+        if (permuteSuits(boardCards, perm.data()) == boardCards && permuteSuits(deadCards, perm.data()) == deadCards)
+            group.push_back(perm);
+    } while (std::next_permutation(perm.begin(), perm.end()));
+
+    // Deck in descending order like in enumerateBoard().
+    unsigned deck[CARD_COUNT];
+    unsigned ndeck = 0;
+    for (unsigned c = CARD_COUNT; c-- > 0;) {
+        if (!((boardCards | deadCards) & (1ull << c)))
+            deck[ndeck++] = c;
+    }
+    if (ndeck < 4 + BOARD_CARDS - boardCount)
+        return false;
+
+    // Keep the runouts that are smallest in their orbit.
+    std::vector<uint64_t> runouts;
+    std::vector<unsigned> weights;
+    auto addRunout = [&](uint64_t runout) {
+        uint64_t images[4 * 3 * 2];
+        unsigned nimages = 0;
+        for (auto& p : group) {
+            uint64_t image = permuteSuits(runout, p.data());
+            if (image < runout)
+                return;
+            if (std::find(images, images + nimages, image) == images + nimages)
+                images[nimages++] = image;
+        }
+        runouts.push_back(runout);
+        weights.push_back(nimages);
+    };
+    unsigned remainingCards = BOARD_CARDS - boardCount;
+    if (remainingCards == 0) {
+        addRunout(0);
+    } else if (remainingCards == 1) {
+        for (unsigned i = 0; i < ndeck; ++i)
+            addRunout(1ull << deck[i]);
+    } else {
+        for (unsigned i = 0; i < ndeck; ++i)
+            for (unsigned j = i + 1; j < ndeck; ++j)
+                addRunout((1ull << deck[i]) | (1ull << deck[j]));
+    }
+
+    if (threadCount == 0)
+        threadCount = mThreadPool->threadCount();
+    auto runThreads = [&](const std::function<void()>& work) {
+        mThreadPool->run(threadCount, work);
+    };
+
+    // Rank every combo on every runout. Zero marks a combo that conflicts with board, dead or runout cards, since
+    // the evaluator never returns that for a real hand.
+    std::vector<uint16_t> ranks(runouts.size() * COMBO_COUNT);
+    std::atomic<size_t> nextRunout(0);
+    runThreads([&]{
+        for (size_t r; (r = nextRunout++) < runouts.size();) {
+            uint64_t fullBoard = boardCards | runouts[r];
+            Hand board = getBoardFromBitmask(fullBoard);
+            uint16_t* out = &ranks[r * COMBO_COUNT];
+            for (unsigned i = 0; i < COMBO_COUNT; ++i) {
+                if (matrix.comboMasks[i] & (fullBoard | deadCards)) {
+                    out[i] = 0;
+                } else {
+                    auto cards = comboCards(i);
+                    out[i] = mEval.evaluate(board + Hand(cards));
+                }
+            }
+        }
+    });
+
+    // Score 2 for a win and 1 for a tie, one full row per combo so rows can be split between threads without any
+    // merging. Pairs that share a card accumulate garbage, but those are blocked anyway.
+    std::vector<uint32_t> scores((size_t)COMBO_COUNT * COMBO_COUNT);
+    std::atomic<unsigned> nextRow(0);
+    runThreads([&]{
+        for (unsigned i; (i = nextRow++) < COMBO_COUNT;) {
+            uint32_t* row = &scores[(size_t)i * COMBO_COUNT];
+            for (size_t r = 0; r < runouts.size(); ++r) {
+                const uint16_t* rank = &ranks[r * COMBO_COUNT];
+                uint32_t ownRank = rank[i];
+                if (!ownRank)
+                    continue;
+                uint32_t weight = weights[r];
+                for (unsigned j = 0; j < COMBO_COUNT; ++j) {
+                    uint32_t score = (ownRank > rank[j]) * 2 + (ownRank == rank[j]);
+                    row[j] += rank[j] ? score * weight : 0;
+                }
+            }
+        }
+    });
+
+    // Every unblocked pair sees the same number of runouts.
+    uint64_t runoutsPerPair = 1;
+    for (unsigned i = 0; i < remainingCards; ++i)
+        runoutsPerPair = runoutsPerPair * (ndeck - 4 - i) / (i + 1);
+    double scale = 65535.0 / (2.0 * group.size() * runoutsPerPair);
+
+    // Apply the group and pack the upper triangle.
+    std::vector<std::vector<uint16_t>> comboPerms;
+    for (auto& p : group) {
+        comboPerms.emplace_back(COMBO_COUNT);
+        for (unsigned i = 0; i < COMBO_COUNT; ++i) {
+            auto cards = comboCards(i);
+            comboPerms.back()[i] = (uint16_t)comboIndex((cards[0] & RANK_MASK) | p[cards[0] & SUIT_MASK],
+                                                        (cards[1] & RANK_MASK) | p[cards[1] & SUIT_MASK]);
+        }
+    }
+
+    matrix.data.assign((size_t)COMBO_COUNT * (COMBO_COUNT - 1) / 2, 0);
+    nextRow = 0;
+    runThreads([&]{
+        for (unsigned i; (i = nextRow++) < COMBO_COUNT;) {
+            for (unsigned j = i + 1; j < COMBO_COUNT; ++j) {
+                if (matrix.blocked(i, j))
+                    continue;
+                uint64_t sum = 0;
+                for (auto& p : comboPerms)
+                    sum += scores[(size_t)p[i] * COMBO_COUNT + p[j]];
+                matrix.data[EquityMatrix::triangleIndex(i, j)] = (uint16_t)std::lround(sum * scale);
+            }
+        }
+    });
+
+    return true;
+}
+
+// Enumerates every turn and river (or river) once. On each runout both ranges are sorted by hand rank and swept
+// together, so every combo's wins, ties and showdowns against the whole opposing range come from running sums. Card
+// removal is handled with per-card sums: a combo's opponents are all unblocked combos minus those holding either of
+// its cards, plus the identical combo that got subtracted twice. Each runout is credited to both of its cards, since
+// either one can be the turn.
+bool EquityCalculator::calculateRunoutEquities(RunoutEquities& results, const std::vector<CardRange>& handRanges,
+                                               uint64_t boardCards, uint64_t deadCards, unsigned threadCount) const
+{
+    unsigned boardCount = bitCount(boardCards);
+    if (handRanges.size() != 2 || boardCount < 3 || boardCount > 4 || (boardCards & deadCards))
+        return false;
+
+    results.boardCards = boardCards;
+    results.deadCards = deadCards;
+    for (unsigned p = 0; p < 2; ++p) {
+        results.comboWeights[p].assign(COMBO_COUNT, 0);
+        auto& combos = handRanges[p].combinations();
+        for (size_t i = 0; i < combos.size(); ++i) {
+            uint64_t mask = (1ull << combos[i][0]) | (1ull << combos[i][1]);
+            if (!(mask & (boardCards | deadCards)))
+                results.comboWeights[p][comboIndex(combos[i][0], combos[i][1])] = handRanges[p].weights()[i];
+        }
+    }
+
+    std::vector<uint64_t> runouts;
+    for (unsigned c1 = 0; c1 < CARD_COUNT; ++c1) {
+        if ((boardCards | deadCards) & (1ull << c1))
+            continue;
+        if (boardCount == 4) {
+            runouts.push_back(1ull << c1);
+            continue;
+        }
+        for (unsigned c2 = c1 + 1; c2 < CARD_COUNT; ++c2) {
+            if (!((boardCards | deadCards) & (1ull << c2)))
+                runouts.push_back((1ull << c1) | (1ull << c2));
+        }
+    }
+    if (boardCount == 3) {
+        results.runoutScores.assign(CARD_COUNT * CARD_COUNT, 0);
+        results.runoutHands.assign(CARD_COUNT * CARD_COUNT, 0);
+    } else {
+        results.runoutScores.clear();
+        results.runoutHands.clear();
+    }
+
+    struct Entry
+    {
+        unsigned rank, combo;
+        uint8_t cards[2];
+        double weight;
+    };
+
+    // Per-thread tallies, merged at the end.
+    if (threadCount == 0)
+        threadCount = mThreadPool->threadCount();
+    threadCount = std::max(1u, std::min<unsigned>(threadCount, (unsigned)runouts.size()));
+    std::vector<std::vector<double>> threadTallies(threadCount);
+    std::atomic<unsigned> nextThread(0);
+    std::atomic<size_t> nextRunout(0);
+    const size_t tallySize = (size_t)COMBO_COUNT * CARD_COUNT;
+
+    mThreadPool->run(threadCount, [&]{
+        std::vector<double>& tallies = threadTallies[nextThread++];
+        tallies.assign(4 * tallySize, 0); // Scores and hands of both players.
+        std::vector<Entry> entries[2];
+
+        for (size_t r; (r = nextRunout++) < runouts.size();) {
+            uint64_t fullBoard = boardCards | runouts[r];
+            Hand board = getBoardFromBitmask(fullBoard);
+            double totalWeight[2] = {}, cardWeight[2][CARD_COUNT] = {};
+            for (unsigned p = 0; p < 2; ++p) {
+                entries[p].clear();
+                for (unsigned i = 0; i < COMBO_COUNT; ++i) {
+                    double weight = results.comboWeights[p][i];
+                    auto cards = comboCards(i);
+                    if (weight == 0 || (fullBoard & ((1ull << cards[0]) | (1ull << cards[1]))))
+                        continue;
+                    entries[p].push_back({mEval.evaluate(board + Hand(cards)), i, {cards[0], cards[1]}, weight});
+                    totalWeight[p] += weight;
+                    cardWeight[p][cards[0]] += weight;
+                    cardWeight[p][cards[1]] += weight;
+                }
+                std::sort(entries[p].begin(), entries[p].end(), [](const Entry& a, const Entry& b) {
+                    return a.rank < b.rank;
+                });
+            }
+
+            unsigned runoutCards[2], runoutCardCount = 0;
+            for (uint64_t m = runouts[r]; m; m &= m - 1)
+                runoutCards[runoutCardCount++] = countTrailingZeros(m);
+
+            double rangeScore = 0, rangeHands = 0;
+            for (unsigned p = 0; p < 2; ++p) {
+                const std::vector<Entry>& own = entries[p];
+                const std::vector<Entry>& opp = entries[p ^ 1];
+                const std::vector<double>& oppWeights = results.comboWeights[p ^ 1];
+                double* scores = &tallies[p * tallySize];
+                double* hands = &tallies[(2 + p) * tallySize];
+                double lowWeight = 0, lowCards[CARD_COUNT] = {}, tieCards[CARD_COUNT] = {};
+                size_t lowEnd = 0;
+                for (size_t i = 0; i < own.size();) {
+                    unsigned rank = own[i].rank;
+                    while (lowEnd < opp.size() && opp[lowEnd].rank < rank) {
+                        const Entry& e = opp[lowEnd++];
+                        lowWeight += e.weight;
+                        lowCards[e.cards[0]] += e.weight;
+                        lowCards[e.cards[1]] += e.weight;
+                    }
+                    size_t tieEnd = lowEnd;
+                    double tieWeight = 0;
+                    for (; tieEnd < opp.size() && opp[tieEnd].rank == rank; ++tieEnd) {
+                        tieWeight += opp[tieEnd].weight;
+                        tieCards[opp[tieEnd].cards[0]] += opp[tieEnd].weight;
+                        tieCards[opp[tieEnd].cards[1]] += opp[tieEnd].weight;
+                    }
+
+                    for (; i < own.size() && own[i].rank == rank; ++i) {
+                        const Entry& e = own[i];
+                        unsigned c1 = e.cards[0], c2 = e.cards[1];
+                        // The identical combo always ties, so it's never in the low sums.
+                        double same = oppWeights[e.combo];
+                        double wins = lowWeight - lowCards[c1] - lowCards[c2];
+                        double ties = tieWeight - tieCards[c1] - tieCards[c2] + same;
+                        double total = totalWeight[p ^ 1] - cardWeight[p ^ 1][c1] - cardWeight[p ^ 1][c2] + same;
+                        double score = wins + 0.5 * ties;
+                        for (unsigned k = 0; k < runoutCardCount; ++k) {
+                            scores[e.combo * CARD_COUNT + runoutCards[k]] += score;
+                            hands[e.combo * CARD_COUNT + runoutCards[k]] += total;
+                        }
+                        if (p == 0) {
+                            rangeScore += e.weight * score;
+                            rangeHands += e.weight * total;
+                        }
+                    }
+
+                    for (size_t j = lowEnd; j < tieEnd; ++j) {
+                        tieCards[opp[j].cards[0]] -= opp[j].weight;
+                        tieCards[opp[j].cards[1]] -= opp[j].weight;
+                    }
+                }
+            }
+
+            // Each runout is handled by one thread only.
+            if (runoutCardCount == 2) {
+                unsigned c1 = runoutCards[0], c2 = runoutCards[1];
+                results.runoutScores[c1 * CARD_COUNT + c2] = results.runoutScores[c2 * CARD_COUNT + c1] = rangeScore;
+                results.runoutHands[c1 * CARD_COUNT + c2] = results.runoutHands[c2 * CARD_COUNT + c1] = rangeHands;
+            }
+        }
+    });
+
+    for (unsigned p = 0; p < 2; ++p) {
+        results.comboScores[p].assign(tallySize, 0);
+        results.comboHands[p].assign(tallySize, 0);
+        for (auto& tallies : threadTallies) {
+            if (tallies.empty())
+                continue;
+            for (size_t i = 0; i < tallySize; ++i) {
+                results.comboScores[p][i] += tallies[p * tallySize + i];
+                results.comboHands[p][i] += tallies[(2 + p) * tallySize + i];
+            }
+        }
+        for (unsigned c = 0; c < CARD_COUNT; ++c)
+            results.rangeScores[p][c] = results.rangeHands[p][c] = 0;
+        for (unsigned i = 0; i < COMBO_COUNT; ++i) {
+            double weight = results.comboWeights[p][i];
+            if (weight == 0)
+                continue;
+            for (unsigned c = 0; c < CARD_COUNT; ++c) {
+                results.rangeScores[p][c] += weight * results.comboScores[p][i * CARD_COUNT + c];
+                results.rangeHands[p][c] += weight * results.comboHands[p][i * CARD_COUNT + c];
+            }
+        }
+    }
+
+    return true;
+}
+
+// Murmur3 finalizer, spreads preflop ids over the cache slots.
+static uint64_t hashPreflopId(uint64_t id)
+{
+    id ^= id >> 33;
+    id *= 0xff51afd7ed558ccdull;
+    id ^= id >> 33;
+    id *= 0xc4ceb9fe1a85ec53ull;
+    id ^= id >> 33;
+    return id;
+}
+
 // Lookup cached results for particular preflop.
 bool EquityCalculator::lookupResults(uint64_t preflopId, BatchResults& results)
 {
     if (!mDeadCards && !mBoardCards && lookupPrecalculatedResults(preflopId, results))
         return true;
 
-    std::lock_guard<std::mutex> lock(mMutex);
-    auto it = mLookup.find(preflopId);
-    if (it != mLookup.end())
-        results = it->second;
-    return it != mLookup.end();
+    std::lock_guard<std::mutex> lock(mLookupMutex);
+    if (mLookupKeys.empty())
+        return false;
+    size_t mask = mLookupKeys.size() - 1;
+    for (size_t i = hashPreflopId(preflopId) & mask;; i = (i + 1) & mask) {
+        if (mLookupKeys[i] == preflopId) {
+            const unsigned* src = &mLookupResults[i * mLookupStride];
+            std::copy(src, src + mLookupStride, results.winsByPlayerMask);
+            return true;
+        }
+        if (mLookupKeys[i] == 0)
+            return false;
+    }
 }
 
 // Lookup precalculated results.
@@ -550,15 +1114,51 @@ bool EquityCalculator::lookupPrecalculatedResults(uint64_t preflopId, BatchResul
     return true;
 }
 
-// Store results for one preflop in the lookup table.
+// Store results for one preflop in the lookup table. The table starts small and doubles at half load.
 void EquityCalculator::storeResults(uint64_t preflopId, const BatchResults& results)
 {
-    std::lock_guard<std::mutex> lock(mMutex); //TODO read-write lock
-    mLookup.emplace(preflopId, results);
-    // Make sure the hash map doesn't eat all memory. Not a great way of doing it but the lookup
+    std::lock_guard<std::mutex> lock(mLookupMutex); //TODO read-write lock
+    // Make sure the table doesn't eat all memory. Not a great way of doing it but the lookup
     // table is quite useless with that many preflop combos anyway.
-    if (mLookup.size() >= MAX_LOOKUP_SIZE)
-        mLookup.clear();
+    if (mLookupCount >= MAX_LOOKUP_SIZE) {
+        std::fill(mLookupKeys.begin(), mLookupKeys.end(), 0);
+        mLookupCount = 0;
+    }
+
+    if (2 * (mLookupCount + 1) > mLookupKeys.size()) {
+        std::vector<uint64_t> oldKeys(std::max<size_t>(2 * mLookupKeys.size(), 4096));
+        std::vector<unsigned> oldResults(oldKeys.size() * mLookupStride);
+        oldKeys.swap(mLookupKeys);
+        oldResults.swap(mLookupResults);
+        size_t mask = mLookupKeys.size() - 1;
+        for (size_t j = 0; j < oldKeys.size(); ++j) {
+            if (oldKeys[j] == 0)
+                continue;
+            size_t i = hashPreflopId(oldKeys[j]) & mask;
+            while (mLookupKeys[i] != 0)
+                i = (i + 1) & mask;
+            mLookupKeys[i] = oldKeys[j];
+            std::copy(&oldResults[j * mLookupStride], &oldResults[j * mLookupStride] + mLookupStride,
+                      &mLookupResults[i * mLookupStride]);
+        }
+    }
+
+    size_t mask = mLookupKeys.size() - 1;
+    size_t i = hashPreflopId(preflopId) & mask;
+    while (mLookupKeys[i] != 0 && mLookupKeys[i] != preflopId)
+        i = (i + 1) & mask;
+    if (mLookupKeys[i] == 0)
+        ++mLookupCount;
+    mLookupKeys[i] = preflopId;
+    std::copy(results.winsByPlayerMask, results.winsByPlayerMask + mLookupStride, &mLookupResults[i * mLookupStride]);
+}
+
+void EquityCalculator::clearLookup()
+{
+    std::lock_guard<std::mutex> lock(mLookupMutex);
+    mLookupKeys.clear();
+    mLookupResults.clear();
+    mLookupCount = 0;
 }
 
 // Transforms suits in such way that suit isomorphism can be easily detected. Goes through all the holecards, board
@@ -572,26 +1172,24 @@ unsigned EquityCalculator::transformSuits(HandWithPlayerIdx* playerHands, unsign
     //TODO transform fixed cards before main enumeration loop.
 
     uint64_t newBoardCards = 0;
-    for (unsigned i = 0; i < CARD_COUNT; ++i) {
-        if ((*boardCards >> i) & 1) {
-            unsigned suit = i & SUIT_MASK;
-            if (transform[suit] == ~0u)
-                transform[suit] = suitCount++;
-            unsigned newCard = (i & RANK_MASK) | transform[suit];
-            newBoardCards |= 1ull << newCard;
-        }
+    for (uint64_t cards = *boardCards; cards; cards &= cards - 1) {
+        unsigned i = countTrailingZeros(cards);
+        unsigned suit = i & SUIT_MASK;
+        if (transform[suit] == ~0u)
+            transform[suit] = suitCount++;
+        unsigned newCard = (i & RANK_MASK) | transform[suit];
+        newBoardCards |= 1ull << newCard;
     }
     *boardCards = newBoardCards;
 
     uint64_t newDeadCards = 0;
-    for (unsigned i = 0; i < CARD_COUNT; ++i) {
-        if ((*deadCards >> i) & 1) {
-            unsigned suit = i & SUIT_MASK;
-            if (transform[suit] == ~0u)
-                transform[suit] = suitCount++;
-            unsigned newCard = (i & RANK_MASK) | transform[suit];
-            newDeadCards |= 1ull << newCard;
-        }
+    for (uint64_t cards = *deadCards; cards; cards &= cards - 1) {
+        unsigned i = countTrailingZeros(cards);
+        unsigned suit = i & SUIT_MASK;
+        if (transform[suit] == ~0u)
+            transform[suit] = suitCount++;
+        unsigned newCard = (i & RANK_MASK) | transform[suit];
+        newDeadCards |= 1ull << newCard;
     }
     *deadCards = newDeadCards;
 
@@ -608,6 +1206,69 @@ unsigned EquityCalculator::transformSuits(HandWithPlayerIdx* playerHands, unsign
     return suitCount;
 }
 
+// Number of suits in which nobody can make a flush, counted with the current board and dead cards.
+unsigned EquityCalculator::irrelevantSuitCount() const
+{
+    unsigned remainingCards = BOARD_CARDS - bitCount(mBoardCards);
+    unsigned count = 0;
+    for (unsigned suit = 0; suit < SUIT_COUNT; ++suit) {
+        unsigned boardSuitCount = bitCount(mBoardCards & (SUIT_BITS << suit));
+        count += boardSuitCount + remainingCards + 2 < 5;
+    }
+    return count;
+}
+
+// Second pass after transformSuits(). Suits that can't make a flush for anyone only matter through card removal, so
+// a hole card in one of them can be moved to any other such suit that still has the same rank free. Each hole card
+// is moved to the lowest one available, which maps e.g. 7s8h and 7h8s on a Kc9c2d4c turn to the same preflop id.
+void EquityCalculator::transformIrrelevantSuits(HandWithPlayerIdx* playerHands, unsigned nplayers,
+                                                uint64_t boardCards, uint64_t deadCards)
+{
+    unsigned remainingCards = BOARD_CARDS - bitCount(boardCards);
+    unsigned irrelevantSuits[SUIT_COUNT];
+    unsigned irrelevantCount = 0;
+    uint64_t irrelevantMask = 0;
+    for (unsigned suit = 0; suit < SUIT_COUNT; ++suit) {
+        if (bitCount(boardCards & (SUIT_BITS << suit)) + remainingCards + 2 < 5) {
+            irrelevantSuits[irrelevantCount++] = suit;
+            irrelevantMask |= SUIT_BITS << suit;
+        }
+    }
+    if (irrelevantCount < 2)
+        return;
+
+    uint64_t usedCards = boardCards | deadCards;
+    for (unsigned i = 0; i < nplayers; ++i) {
+        for (uint8_t& c : playerHands[i].cards) {
+            if (!((irrelevantMask >> c) & 1))
+                continue;
+            for (unsigned j = 0; j < irrelevantCount; ++j) {
+                unsigned newCard = (c & RANK_MASK) | irrelevantSuits[j];
+                if (!((usedCards >> newCard) & 1)) {
+                    c = newCard;
+                    break;
+                }
+            }
+            usedCards |= 1ull << c;
+        }
+    }
+}
+
+// Sums results of a batch whose players are permuted by its playerIds into a batch with identity player order.
+void EquityCalculator::addPermutedResults(BatchResults& dst, const BatchResults& src, unsigned nplayers)
+{
+    for (unsigned i = 0; i < (1u << nplayers); ++i) {
+        if (!src.winsByPlayerMask[i])
+            continue;
+        unsigned actualPlayerMask = 0;
+        for (unsigned j = 0; j < nplayers; ++j) {
+            if (i & (1 << j))
+                actualPlayerMask |= 1 << src.playerIds[j];
+        }
+        dst.winsByPlayerMask[actualPlayerMask] += src.winsByPlayerMask[i];
+    }
+}
+
 // Calculates a unique 64-bit id for each combination of starting hands.
 uint64_t EquityCalculator::calculateUniquePreflopId(const HandWithPlayerIdx* playerHands, unsigned nplayers)
 {
@@ -633,17 +1294,22 @@ Hand EquityCalculator::getBoardFromBitmask(uint64_t cards)
     return board;
 }
 
-// Removes combos that conflict with board and dead cards.
+// Removes combos that conflict with board and dead cards. Weights of the remaining combos go to weights.
 std::vector<std::vector<std::array<uint8_t,2>>> EquityCalculator::removeInvalidCombos(
-        const std::vector<CardRange>& handRanges, uint64_t reservedCards)
+        const std::vector<CardRange>& handRanges, uint64_t reservedCards, std::vector<std::vector<double>>* weights)
 {
     std::vector<std::vector<std::array<uint8_t,2>>> result;
+    weights->clear();
     for (auto& hr : handRanges) {
         result.push_back(std::vector<std::array<uint8_t,2>>{});
-        for (auto& h : hr.combinations()) {
+        weights->push_back(std::vector<double>{});
+        for (size_t i = 0; i < hr.combinations().size(); ++i) {
+            auto& h = hr.combinations()[i];
             uint64_t handMask = (1ull << h[0]) | (1ull << h[1]);
-            if (!(reservedCards & handMask))
+            if (!(reservedCards & handMask)) {
                 result.back().push_back(h);
+                weights->back().push_back(hr.weights()[i]);
+            }
         }
     }
     return result;
@@ -652,12 +1318,9 @@ std::vector<std::vector<std::array<uint8_t,2>>> EquityCalculator::removeInvalidC
 // Work allocation for enumeration threads.
 std::pair<uint64_t,uint64_t> EquityCalculator::reserveBatch(uint64_t batchCount)
 {
-    std::lock_guard<std::mutex> lock(mMutex);
-
     uint64_t totalBatchCount = getPreflopCombinationCount();
-    uint64_t start = mEnumPosition;
-    uint64_t end = std::min<uint64_t>(totalBatchCount, mEnumPosition + batchCount);
-    mEnumPosition = end;
+    uint64_t start = std::min<uint64_t>(totalBatchCount, mEnumPosition.fetch_add(batchCount));
+    uint64_t end = std::min<uint64_t>(totalBatchCount, start + batchCount);
 
     return {start, end};
 }
@@ -688,107 +1351,236 @@ uint64_t EquityCalculator::getPostflopCombinationCount()
     return postflopCombos;
 }
 
-// Results aggregation for both enumeration and monte carlo.
-void EquityCalculator::updateResults(const BatchResults& stats, bool threadFinished)
+// Results aggregation for both enumeration and monte carlo. Adds the batch to the thread's own results, checks the
+// limits and publishes an update if one is due and no other thread is already doing it.
+void EquityCalculator::updateResults(ThreadResults& threadResults, const BatchResults& stats, bool threadFinished,
+                                     double weight)
 {
-    auto t = std::chrono::high_resolution_clock::now();
+    unsigned sequence = threadResults.sequence.load(std::memory_order_relaxed);
+    threadResults.sequence.store(sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
 
-    std::lock_guard<std::mutex> lock(mMutex);
-
-    double batchEquity = combineResults(stats);
+    uint64_t handsBefore = threadResults.hands.load(std::memory_order_relaxed);
+    double batchEquity = combineResults(threadResults, stats, weight);
 
     // Store values for stdev calculation
     if (!threadFinished) {
-        mBatchSum += batchEquity;
-        mBatchSumSqr += batchEquity * batchEquity;
-        mBatchCount += 1;
+        addRelaxed(threadResults.batchSum, batchEquity);
+        addRelaxed(threadResults.batchSumSqr, batchEquity * batchEquity);
+        addRelaxed(threadResults.batchCount, 1.0);
+    }
+    if (stats.strataSamples > 0) {
+        threadResults.strataSamples.store(stats.strataSamples, std::memory_order_relaxed);
+        threadResults.strataVariance.store(stats.strataVariance, std::memory_order_relaxed);
     }
 
-    mResults.finished = threadFinished && --mUnfinishedThreads == 0;
+    threadResults.sequence.store(sequence + 2, std::memory_order_release);
 
-    double dt = 1e-9 * std::chrono::duration_cast<std::chrono::nanoseconds>(t - mLastUpdate).count();
-    //std::cout << mResults.hands << " " << mHandLimit << std::endl;
-    if (mResults.time + dt >= mTimeLimit || mResults.hands + mResults.intervalHands >= mHandLimit)
+    uint64_t batchHands = threadResults.hands.load(std::memory_order_relaxed) - handsBefore;
+    uint64_t totalHands = mTotalHands.fetch_add(batchHands, std::memory_order_relaxed) + batchHands;
+    double elapsed = 1e-9 * std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::high_resolution_clock::now() - mStartTime).count();
+    if (elapsed >= mTimeLimit.load(std::memory_order_relaxed)
+            || totalHands >= mHandLimit.load(std::memory_order_relaxed))
         mStopped = true;
 
-    // Periodic update through callback.
-    if (dt >= mUpdateInterval || mResults.finished) {
-        mResults.intervalTime = dt;
-        mResults.time += mResults.intervalTime;
-        mResults.hands += mResults.intervalHands;
-        mResults.intervalSpeed = mResults.intervalHands / (mResults.intervalTime + 1e-9);
-        mResults.speed = mResults.hands / (mResults.time + 1e-9);
-        mResults.intervalHands = 0;
-        mResults.stdev = std::sqrt(1e-9 + mBatchSumSqr - mBatchSum * mBatchSum / mBatchCount) / mBatchCount;
-        mResults.stdevPerHand = mResults.stdev * std::sqrt(mResults.hands);
-        if (mResults.enumerateAll) {
-            mResults.progress = (double)mEnumPosition / getPreflopCombinationCount();
-        } else {
-            double estimatedHands = std::pow(mResults.stdev / mStdevTarget, 2) * mResults.hands;
-            mResults.progress = mResults.hands / estimatedHands;
-        }
-        mResults.preflopCombos = getPreflopCombinationCount();
+    if (threadFinished) {
+        // Last thread out publishes the final results.
+        if (mUnfinishedThreads.fetch_sub(1, std::memory_order_acq_rel) == 1)
+            reportResults(true);
+    } else if (elapsed >= mNextUpdate.load(std::memory_order_relaxed)) {
+        reportResults(false);
+    }
+}
 
-        if (!mResults.enumerateAll && mResults.stdev < mStdevTarget) //TODO use max stdev of any player
-            mStopped = true;
+// Sums up the thread results and publishes them to getResults() and the callback. Blocks only for the final update.
+void EquityCalculator::reportResults(bool finished)
+{
+    std::unique_lock<std::mutex> lock(mReportMutex, std::defer_lock);
+    if (finished)
+        lock.lock();
+    else if (!lock.try_lock())
+        return;
 
-        for (unsigned i = 0; i < mResults.players; ++i)
-            mResults.equity[i] = (mResults.wins[i] + mResults.ties[i]) / (mResults.hands + 1e-9);
+    double t = 1e-9 * std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::high_resolution_clock::now() - mStartTime).count();
+    if (!finished && t < mNextUpdate)
+        return;
+    mNextUpdate = t + mUpdateInterval;
 
-        mUpdateResults = mResults;
+    Results results;
+    uint64_t previousHands;
+    {
+        std::lock_guard<std::mutex> lock2(mMutex);
+        results.players = mUpdateResults.players;
+        results.enumerateAll = mUpdateResults.enumerateAll;
+        previousHands = mUpdateResults.hands;
+    }
+    double batchSum = 0, batchSumSqr = 0, batchCount = 0, strataSamples = 0, strataVariance = 0;
+    for (const ThreadResults& r : mThreadResults)
+        r.addTo(results, batchSum, batchSumSqr, batchCount, strataSamples, strataVariance);
+
+    results.finished = finished;
+    results.intervalHands = results.hands - previousHands;
+    results.intervalTime = t - mLastUpdate;
+    results.time = t;
+    results.intervalSpeed = results.intervalHands / (results.intervalTime + 1e-9);
+    results.speed = results.hands / (results.time + 1e-9);
+    // Stratified threads know their own variance, the thread means combine weighted by samples.
+    if (strataSamples > 0)
+        results.stdev = std::sqrt(1e-18 + strataVariance) / strataSamples;
+    else
+        results.stdev = std::sqrt(1e-9 + batchSumSqr - batchSum * batchSum / batchCount) / batchCount;
+    results.stdevPerHand = results.stdev * std::sqrt(results.hands);
+    results.preflopCombos = getPreflopCombinationCount();
+    if (results.enumerateAll) {
+        results.progress = (double)std::min(mEnumPosition.load(), results.preflopCombos) / results.preflopCombos;
+    } else {
+        double estimatedHands = std::pow(results.stdev / mStdevTarget, 2) * results.hands;
+        results.progress = results.hands / estimatedHands;
+    }
 
-        if (mCallback)
-            mCallback(mResults);
+    if (!results.enumerateAll && results.stdev < mStdevTarget) //TODO use max stdev of any player
+        mStopped = true;
+
+    for (unsigned i = 0; i < results.players; ++i)
+        results.equity[i] = (results.weightedWins[i] + results.weightedTies[i]) / (results.weightedHands + 1e-9);
 
-        mLastUpdate = t;
+    {
+        std::lock_guard<std::mutex> lock2(mMutex);
+        mUpdateResults = results;
     }
 
+    if (mCallback)
+        mCallback(results);
+
+    mLastUpdate = t;
+
     //if (finished)
     //    outputLookupTable();
 }
 
-// Sum batch results in the main results structure.
-double EquityCalculator::combineResults(const BatchResults& batch)
+// Sum batch results in the thread's results. Weight multiplies every showdown of the batch. Only called by the owner
+// thread inside the seqlock write.
+double EquityCalculator::combineResults(ThreadResults& threadResults, const BatchResults& batch, double weight)
 {
     uint64_t batchHands = 0;
     double batchEquity = 0;
+    unsigned nplayers = (unsigned)mHandRanges.size();
 
-    for (unsigned i = 0; i < (1u << mResults.players); ++i) {
-        mResults.intervalHands += batch.winsByPlayerMask[i];
+    for (unsigned i = 0; i < (1u << nplayers); ++i) {
+        if (!batch.winsByPlayerMask[i])
+            continue;
         batchHands += batch.winsByPlayerMask[i];
         unsigned winnerCount = bitCount(i);
         unsigned actualPlayerMask = 0;
-        for (unsigned j = 0; j < mResults.players; ++j) {
+        for (unsigned j = 0; j < nplayers; ++j) {
             if (i & (1 << j)) {
                 if (winnerCount == 1) {
-                    mResults.wins[batch.playerIds[j]] += batch.winsByPlayerMask[i];
+                    addRelaxed(threadResults.wins[batch.playerIds[j]], (uint64_t)batch.winsByPlayerMask[i]);
+                    addRelaxed(threadResults.weightedWins[batch.playerIds[j]], batch.winsByPlayerMask[i] * weight);
                     if (batch.playerIds[j] == 0)
                         batchEquity += batch.winsByPlayerMask[i];
                 } else {
-                    mResults.ties[batch.playerIds[j]] += batch.winsByPlayerMask[i] / (double)winnerCount;
+                    addRelaxed(threadResults.ties[batch.playerIds[j]],
+                               batch.winsByPlayerMask[i] / (double)winnerCount);
+                    addRelaxed(threadResults.weightedTies[batch.playerIds[j]],
+                               batch.winsByPlayerMask[i] * weight / winnerCount);
                     if (batch.playerIds[j] == 0)
                         batchEquity += batch.winsByPlayerMask[i] / (double)winnerCount;
                 }
                 actualPlayerMask |= 1 << batch.playerIds[j];
             }
         }
-        mResults.winsByPlayerMask[actualPlayerMask] += batch.winsByPlayerMask[i];
+        addRelaxed(threadResults.winsByPlayerMask[actualPlayerMask], (uint64_t)batch.winsByPlayerMask[i]);
     }
 
-    mResults.evaluations += batch.evalCount;
-    mResults.skippedPreflopCombos += batch.skippedPreflopCombos;
-    mResults.evaluatedPreflopCombos += batch.uniquePreflopCombos;
+    addRelaxed(threadResults.hands, batchHands);
+    addRelaxed(threadResults.weightedHands, batchHands * weight);
+    addRelaxed(threadResults.evaluations, batch.evalCount);
+    addRelaxed(threadResults.skippedPreflopCombos, batch.skippedPreflopCombos);
+    addRelaxed(threadResults.evaluatedPreflopCombos, batch.uniquePreflopCombos);
 
     return batchEquity / (batchHands + 1e-9);
 }
 
+void EquityCalculator::ThreadResults::reset()
+{
+    sequence = 0;
+    for (unsigned i = 0; i < MAX_PLAYERS; ++i) {
+        wins[i] = 0;
+        ties[i] = weightedWins[i] = weightedTies[i] = 0;
+    }
+    for (auto& w : winsByPlayerMask)
+        w = 0;
+    weightedHands = 0;
+    hands = skippedPreflopCombos = evaluatedPreflopCombos = evaluations = 0;
+    batchSum = batchSumSqr = batchCount = 0;
+    strataSamples = strataVariance = 0;
+}
+
+// Adds a consistent copy of the thread's results. Retries if the owner was writing at the same time.
+void EquityCalculator::ThreadResults::addTo(Results& results, double& batchSumOut, double& batchSumSqrOut,
+                                            double& batchCountOut, double& strataSamplesOut,
+                                            double& strataVarianceOut) const
+{
+    Results r;
+    double bs, bss, bc, sn, sv;
+    for (;;) {
+        unsigned seq = sequence.load(std::memory_order_acquire);
+        if (seq & 1)
+            continue;
+        for (unsigned i = 0; i < results.players; ++i) {
+            r.wins[i] = wins[i].load(std::memory_order_relaxed);
+            r.ties[i] = ties[i].load(std::memory_order_relaxed);
+            r.weightedWins[i] = weightedWins[i].load(std::memory_order_relaxed);
+            r.weightedTies[i] = weightedTies[i].load(std::memory_order_relaxed);
+        }
+        for (unsigned i = 0; i < (1u << results.players); ++i)
+            r.winsByPlayerMask[i] = winsByPlayerMask[i].load(std::memory_order_relaxed);
+        r.weightedHands = weightedHands.load(std::memory_order_relaxed);
+        r.hands = hands.load(std::memory_order_relaxed);
+        r.skippedPreflopCombos = skippedPreflopCombos.load(std::memory_order_relaxed);
+        r.evaluatedPreflopCombos = evaluatedPreflopCombos.load(std::memory_order_relaxed);
+        r.evaluations = evaluations.load(std::memory_order_relaxed);
+        bs = batchSum.load(std::memory_order_relaxed);
+        bss = batchSumSqr.load(std::memory_order_relaxed);
+        bc = batchCount.load(std::memory_order_relaxed);
+        sn = strataSamples.load(std::memory_order_relaxed);
+        sv = strataVariance.load(std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (sequence.load(std::memory_order_relaxed) == seq)
+            break;
+    }
+
+    for (unsigned i = 0; i < results.players; ++i) {
+        results.wins[i] += r.wins[i];
+        results.ties[i] += r.ties[i];
+        results.weightedWins[i] += r.weightedWins[i];
+        results.weightedTies[i] += r.weightedTies[i];
+    }
+    for (unsigned i = 0; i < (1u << results.players); ++i)
+        results.winsByPlayerMask[i] += r.winsByPlayerMask[i];
+    results.weightedHands += r.weightedHands;
+    results.hands += r.hands;
+    results.skippedPreflopCombos += r.skippedPreflopCombos;
+    results.evaluatedPreflopCombos += r.evaluatedPreflopCombos;
+    results.evaluations += r.evaluations;
+    batchSumOut += bs;
+    batchSumSqrOut += bss;
+    batchCountOut += bc;
+    strataSamplesOut += sn;
+    strataVarianceOut += sv;
+}
+
 // Helper function for printing out precalculated lookup tables.
 void EquityCalculator::outputLookupTable() const
 {
     std::vector<std::array<unsigned,3>> a;
-    for (auto& e: mLookup) {
-        a.push_back({(unsigned)e.first, (unsigned)e.second.winsByPlayerMask[1],
-                     (unsigned)e.second.winsByPlayerMask[3]});
+    for (size_t i = 0; i < mLookupKeys.size(); ++i) {
+        if (mLookupKeys[i] != 0)
+            a.push_back({(unsigned)mLookupKeys[i], mLookupResults[i * mLookupStride + 1],
+                         mLookupResults[i * mLookupStride + 3]});
     }
     std::sort(a.begin(), a.end(), [](const std::array<unsigned,3>& lhs, const std::array<unsigned,3>& rhs){
         return lhs[0] < rhs[0];
@@ -7,12 +7,16 @@
 #include "HandEvaluator.h"
 #include "Constants.h"
 #include "Util.h"
+#include "ThreadPool.h"
 #include <chrono>
 #include <thread>
 #include <mutex>
 #include <atomic>
-#include <unordered_map>
+#include <memory>
+#include <condition_variable>
 #include <array>
+#include <vector>
+#include <functional>
 #include <cstdint>
 
 namespace omp {
@@ -22,17 +26,33 @@ namespace omp {
 class EquityCalculator
 {
 public:
+    // Calculations run on a thread pool instead of spawning threads every time, which matters for short
+    // queries. The pool can be shared with other calculators; by default each calculator gets its own.
+    EquityCalculator(std::shared_ptr<ThreadPool> threadPool = nullptr)
+        : mThreadPool(threadPool ? std::move(threadPool) : std::make_shared<ThreadPool>())
+    {
+    }
+
+    // Waits for any unfinished calculation.
+    ~EquityCalculator()
+    {
+        wait();
+    }
+
 
     struct Results
     {
         // Number of players.
         unsigned players = 0;
-        // Equity by player (between 0 and 1).
+        // Equity by player (between 0 and 1). Uses the range weights, see weightedWins.
         double equity[MAX_PLAYERS] = {};
         // Wins by player.
         uint64_t wins[MAX_PLAYERS] = {};
         // Ties by player, adjusted for equity: 2-way splits = 1/2, 3-way = 1/3 etc..
         double ties[MAX_PLAYERS] = {};
+        // Wins, ties and hands where every showdown counts with the product of the players' combo weights. Same as
+        // wins, ties and hands when ranges have no weights.
+        double weightedWins[MAX_PLAYERS] = {}, weightedTies[MAX_PLAYERS] = {}, weightedHands = 0;
         // Wins for each combination of winning players. Index ranges from 0 to 2^(n-1), where
         // bit 0 is player 1, bit 1 player 2 etc).
         uint64_t winsByPlayerMask[1 << MAX_PLAYERS] = {};
@@ -62,6 +82,144 @@ public:
         bool finished = false;
     };
 
+    // Heads-up equity of every combo against every other combo on a fixed board. Combos are indexed with
+    // comboIndex(). Since equity(j, i) = 1 - equity(i, j), only the upper triangle is stored, as 16-bit fixed point
+    // (65535 = 1.0), which is ~1.7MB for the whole matrix.
+    struct EquityMatrix
+    {
+        // Cards on the board and dead cards used in the calculation.
+        uint64_t boardCards = 0, deadCards = 0;
+        // Card mask of each combo.
+        uint64_t comboMasks[COMBO_COUNT] = {};
+        // Upper triangle in row-major order, see triangleIndex().
+        std::vector<uint16_t> data;
+
+        // True if combos share a card or either one conflicts with board or dead cards. Equity is meaningless then.
+        bool blocked(unsigned i, unsigned j) const
+        {
+            return i == j || (comboMasks[i] & comboMasks[j])
+                   || ((comboMasks[i] | comboMasks[j]) & (boardCards | deadCards));
+        }
+
+        // Equity of combo i against combo j (between 0 and 1), ties count as half.
+        double equity(unsigned i, unsigned j) const
+        {
+            if (i < j)
+                return data[triangleIndex(i, j)] * (1.0 / 65535);
+            else
+                return 1 - data[triangleIndex(j, i)] * (1.0 / 65535);
+        }
+
+        // Position of pair i < j in data.
+        static size_t triangleIndex(unsigned i, unsigned j)
+        {
+            omp_assert(i < j && j < COMBO_COUNT);
+            return (size_t)i * (2 * COMBO_COUNT - i - 1) / 2 + (j - i - 1);
+        }
+    };
+
+    // Maps two different cards to a combo index between 0 and 1325 (same mapping as used by the preflop lookup).
+    static unsigned comboIndex(unsigned c1, unsigned c2)
+    {
+        omp_assert(c1 != c2 && c1 < CARD_COUNT && c2 < CARD_COUNT);
+        if (c1 < c2)
+            std::swap(c1, c2);
+        return (c1 * (c1 - 1) >> 1) + c2;
+    }
+
+    // Inverse of comboIndex(), higher card first.
+    static std::array<uint8_t,2> comboCards(unsigned combo)
+    {
+        omp_assert(combo < COMBO_COUNT);
+        unsigned c1 = 1;
+        while (((c1 + 1) * c1 >> 1) <= combo)
+            ++c1;
+        return {(uint8_t)c1, (uint8_t)(combo - (c1 * (c1 - 1) >> 1))};
+    }
+
+    // Calculates the full combo-vs-combo equity matrix by enumerating the remaining board cards. Board must have at
+    // least 3 cards (preflop matrices are far too expensive to enumerate). Only runouts that are unique under
+    // the suit permutations preserving board and dead cards are evaluated. Blocks until finished and returns false
+    // for an invalid board. Independent of start(), but a running calculation keeps the pool threads busy.
+    // threadCount: number of pool threads to use, 0 for all of them
+    bool calculateEquityMatrix(EquityMatrix& matrix, uint64_t boardCards, uint64_t deadCards = 0,
+                               unsigned threadCount = 0) const;
+
+    // Heads-up equities of a flop or turn split by the cards still to come, from one enumeration of the remaining
+    // board. Every combo keeps its win/tie tallies by next card, so the equity of any combo or range after any turn
+    // (or river) card is a lookup, and the current street is the sum over next cards. Flops also keep range tallies
+    // for every turn and river pair, which covers the river after each turn.
+    struct RunoutEquities
+    {
+        // Cards on the board and dead cards used in the calculation.
+        uint64_t boardCards = 0, deadCards = 0;
+        // Weight of every combo of each player, 0 if not in range or blocked by board or dead cards.
+        std::vector<double> comboWeights[2];
+        // Wins plus half of ties, and showdowns, of each player's combo against the opponent's range when the given
+        // card comes next. Index is comboIndex() * CARD_COUNT + card. Showdowns count with the opponent's weights.
+        std::vector<double> comboScores[2], comboHands[2];
+        // Same for the whole range, showdowns counting with the weights of both players.
+        double rangeScores[2][CARD_COUNT] = {}, rangeHands[2][CARD_COUNT] = {};
+        // First player's score and showdowns for each turn and river pair (flops only). Index is
+        // card1 * CARD_COUNT + card2, symmetric. The second player's score is the hands minus the first player's.
+        std::vector<double> runoutScores, runoutHands;
+
+        // Equity of player's range on the current board.
+        double equity(unsigned player) const
+        {
+            return sum(rangeScores[player]) / (sum(rangeHands[player]) + 1e-9);
+        }
+
+        // Equity of player's range when card comes next.
+        double equity(unsigned player, unsigned card) const
+        {
+            omp_assert(player < 2 && card < CARD_COUNT);
+            return rangeScores[player][card] / (rangeHands[player][card] + 1e-9);
+        }
+
+        // Equity of player's range on the river after turn and river cards (flops only).
+        double equity(unsigned player, unsigned card1, unsigned card2) const
+        {
+            omp_assert(player < 2 && card1 < CARD_COUNT && card2 < CARD_COUNT && !runoutScores.empty());
+            size_t i = card1 * CARD_COUNT + card2;
+            double score = player == 0 ? runoutScores[i] : runoutHands[i] - runoutScores[i];
+            return score / (runoutHands[i] + 1e-9);
+        }
+
+        // Equity of a combo (see comboIndex()) on the current board.
+        double comboEquity(unsigned player, unsigned combo) const
+        {
+            omp_assert(player < 2 && combo < COMBO_COUNT);
+            const double* scores = &comboScores[player][combo * CARD_COUNT];
+            const double* hands = &comboHands[player][combo * CARD_COUNT];
+            return sum(scores) / (sum(hands) + 1e-9);
+        }
+
+        // Equity of a combo when card comes next.
+        double comboEquity(unsigned player, unsigned combo, unsigned card) const
+        {
+            omp_assert(player < 2 && combo < COMBO_COUNT && card < CARD_COUNT);
+            size_t i = combo * CARD_COUNT + card;
+            return comboScores[player][i] / (comboHands[player][i] + 1e-9);
+        }
+
+    private:
+        static double sum(const double* values)
+        {
+            double s = 0;
+            for (unsigned i = 0; i < CARD_COUNT; ++i)
+                s += values[i];
+            return s;
+        }
+    };
+
+    // Fills the runout equities of two ranges on a flop or turn. Ranges may be weighted. Blocks until finished and
+    // returns false unless there are exactly two ranges and 3 or 4 valid board cards. Like calculateEquityMatrix()
+    // independent of start().
+    // threadCount: number of pool threads to use, 0 for all of them
+    bool calculateRunoutEquities(RunoutEquities& results, const std::vector<CardRange>& handRanges,
+                                 uint64_t boardCards, uint64_t deadCards = 0, unsigned threadCount = 0) const;
+
     // Start a new calculation. Returns false if calculation is impossible for given hand ranges and board/dead cards.
     // After calling start() succesfully, wait() must be called in order wait for threads to finish.
     // handRanges: hand ranges for each player
@@ -70,7 +228,9 @@ public:
     // stdevTarget: stops monte carlo when standard deviation is smaller than this, use 0 for infinite simulation
     // callback: function that is called periodically with incomplete results
     // updateInterval: how often callback is called
-    // threadCount: number of threads to spawn, 0 for maximum parallelism supported by hardware
+    // threadCount: number of pool threads to use, 0 for all of them
+    // Weighted ranges (see CardRange) are supported by both methods. Enumeration weights each preflop by its combo
+    // weights, and monte carlo samples combos from alias tables instead of doing the random walk.
     bool start(const std::vector<CardRange>& handRanges, uint64_t boardCards = 0, uint64_t deadCards = 0,
                bool enumerateAll = false, double stdevTarget = 5e-5,
                std::function<void(const Results&)> callback = nullptr,
@@ -85,24 +245,31 @@ public:
     // Wait for calculation to finish. Must always be called once for every successful start() call!
     void wait()
     {
-        for (auto& t : mThreads)
-            t.join();
+        std::unique_lock<std::mutex> lock(mJobMutex);
+        mJobsDone.wait(lock, [this]{ return mRunningJobs == 0; });
     }
 
     // Set a time limit for the calculation in seconds. Use 0 to disable. Disabled by default.
     void setTimeLimit(double seconds)
     {
-        std::lock_guard<std::mutex> lock(mMutex);
-        mTimeLimit = seconds <= 0 ? INFINITE : seconds;
+        mTimeLimit = seconds <= 0 ? (double)INFINITE : seconds;
     }
 
     // Set a hand limit for the calculation or 0 to disable. Disabled by default.
     void setHandLimit(uint64_t handLimit)
     {
-        std::lock_guard<std::mutex> lock(mMutex);
         mHandLimit = handLimit == 0 ? INFINITE : handLimit;
     }
 
+    // Use stratified sampling in monte carlo. Disabled by default. Preflops are visited in a scrambled order without
+    // repetition and the first one or two undealt board cards go through every position (pair) of the remaining deck,
+    // which lowers the variance per hand somewhat (mostly with wide ranges). Takes effect on the next start().
+    void setStratified(bool stratified)
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mStratified = stratified;
+    }
+
     // Get results from previous update.
     Results getResults()
     {
@@ -110,6 +277,12 @@ public:
         return mUpdateResults;
     }
 
+    // Thread pool used for the calculations.
+    const std::shared_ptr<ThreadPool>& threadPool() const
+    {
+        return mThreadPool;
+    }
+
     // Hand ranges used in current calculation.
     const std::vector<CardRange>& handRanges() const
     {
@@ -117,15 +290,26 @@ public:
     }
 
 private:
+    // The lanes of MultiXoroShiro128Plus only pay off as SIMD, its plain loop fallback is slower than one stream.
+    #if OMP_AVX2 || OMP_AVX512
+    typedef MultiXoroShiro128Plus<> Rng;
+    #else
     typedef XoroShiro128Plus Rng;
+    #endif
 
     static const size_t MAX_LOOKUP_SIZE = 1000000;
     static const size_t MAX_COMBINED_RANGE_SIZE = 10000;
     static const uint64_t INFINITE = ~0ull;
+    // Bits of one suit in a 64-bit card mask.
+    static const uint64_t SUIT_BITS = 0x1111111111111ull;
 
     // Temporary storage for results.
     struct BatchResults
     {
+        BatchResults()
+        {
+        }
+
         BatchResults(unsigned nplayers)
         {
             for (unsigned i = 0; i < nplayers; ++i)
@@ -137,6 +321,28 @@ private:
         uint64_t evalCount = 0;
         uint8_t playerIds[MAX_PLAYERS];
         unsigned winsByPlayerMask[1 << MAX_PLAYERS] = {};
+        // Set by the stratified walk only: samples so far and samples^2 * variance of the thread's first player
+        // equity, from the per-stratum sums (see simulateStratifiedMonteCarlo).
+        double strataSamples = 0, strataVariance = 0;
+    };
+
+    // Results accumulated by one worker thread. Only the owner writes, the reporting thread reads a consistent copy
+    // using sequence as a seqlock (odd while a write is in progress). Cache line aligned so that workers never write
+    // to the same line.
+    struct alignas(64) ThreadResults
+    {
+        std::atomic<unsigned> sequence;
+        std::atomic<uint64_t> wins[MAX_PLAYERS], winsByPlayerMask[1 << MAX_PLAYERS];
+        std::atomic<double> ties[MAX_PLAYERS], weightedWins[MAX_PLAYERS], weightedTies[MAX_PLAYERS], weightedHands;
+        std::atomic<uint64_t> hands, skippedPreflopCombos, evaluatedPreflopCombos, evaluations;
+        // Sums for the stdev of the first player's equity over batches.
+        std::atomic<double> batchSum, batchSumSqr, batchCount;
+        // Latest BatchResults::strataSamples / strataVariance of a stratified thread, used instead of the batches.
+        std::atomic<double> strataSamples, strataVariance;
+
+        void reset();
+        void addTo(Results& results, double& batchSum, double& batchSumSqr, double& batchCount,
+                   double& strataSamples, double& strataVariance) const;
     };
 
     // Ad-hoc struct used when sorting hands.
@@ -146,16 +352,17 @@ private:
         unsigned playerIdx;
     };
 
-    void simulateRegularMonteCarlo();
-    void simulateRandomWalkMonteCarlo();
+    void simulateRegularMonteCarlo(ThreadResults& threadResults);
+    void simulateRandomWalkMonteCarlo(ThreadResults& threadResults);
+    void simulateStratifiedMonteCarlo(ThreadResults& threadResults);
     bool randomizeHoleCards(uint64_t &usedCardsMask, unsigned* comboIndexes, Hand* playerHands,
                             Rng& rng, FastUniformIntDistribution<unsigned,21>*comboDists);
     OMP_FORCE_INLINE void randomizeBoard(Hand& board, unsigned remainingCards, uint64_t usedCardsMask,
                         Rng& rng, FastUniformIntDistribution<unsigned,16>& cardDist);
     template<bool tFlushPossible = true>
-    OMP_FORCE_INLINE void evaluateHands(const Hand* playerHands, unsigned nplayers, const Hand& board,
+    OMP_FORCE_INLINE unsigned evaluateHands(const Hand* playerHands, unsigned nplayers, const Hand& board,
             BatchResults* stats, unsigned weight);
-    void enumerate();
+    void enumerate(ThreadResults& threadResults);
     void enumerateBoard(const HandWithPlayerIdx* playerHands, unsigned nplayers,
                    const Hand& board, uint64_t usedCardsMask, BatchResults* stats);
     void enumerateBoardRec(const Hand* playerHands, unsigned nplayers, BatchResults* stats,
@@ -166,39 +373,68 @@ private:
     void storeResults(uint64_t hash, const BatchResults& results);
     static unsigned transformSuits(HandWithPlayerIdx* playerHands, unsigned nplayers,
                                    uint64_t* boardCards, uint64_t* usedCards);
+    static void transformIrrelevantSuits(HandWithPlayerIdx* playerHands, unsigned nplayers,
+                                         uint64_t boardCards, uint64_t deadCards);
+    static void addPermutedResults(BatchResults& dst, const BatchResults& src, unsigned nplayers);
+    void clearLookup();
+    unsigned irrelevantSuitCount() const;
     static uint64_t calculateUniquePreflopId(const HandWithPlayerIdx* playerHands, unsigned nplayers);
     static Hand getBoardFromBitmask(uint64_t board);
     static std::vector<std::vector<std::array<uint8_t,2>>> removeInvalidCombos(const std::vector<CardRange>& handRanges,
-                                                               uint64_t reservedCards);
+                                                               uint64_t reservedCards,
+                                                               std::vector<std::vector<double>>* weights);
     std::pair<uint64_t,uint64_t> reserveBatch(uint64_t batchCount);
     uint64_t getPreflopCombinationCount();
     uint64_t getPostflopCombinationCount();
 
-    void updateResults(const BatchResults& stats, bool finished);
-    double combineResults(const BatchResults& batch);
+    void updateResults(ThreadResults& threadResults, const BatchResults& stats, bool finished, double weight = 1);
+    double combineResults(ThreadResults& threadResults, const BatchResults& batch, double weight);
+    void reportResults(bool finished);
     void outputLookupTable() const;
 
-    std::vector<std::thread> mThreads;
+    std::shared_ptr<ThreadPool> mThreadPool;
 
-    // Shared between threads, protected by mMutex.
-    std::mutex mMutex;
+    // Jobs of the current calculation still in the pool, protected by mJobMutex.
+    std::mutex mJobMutex;
+    std::condition_variable mJobsDone;
+    unsigned mRunningJobs = 0;
+
+    // Shared between threads. Workers only write their own ThreadResults and the atomics, so they never wait for each
+    // other. Updates are published by whichever worker gets mReportMutex first (try_lock, except for the final
+    // update), and only getResults() waits for that on mMutex.
     std::atomic<bool> mStopped;
-    unsigned mUnfinishedThreads;
-    std::chrono::high_resolution_clock::time_point mLastUpdate;
-    Results mResults, mUpdateResults;
-    double mBatchSum, mBatchSumSqr, mBatchCount;
-    uint64_t mEnumPosition;
-    std::unordered_map<uint64_t, BatchResults> mLookup;
+    std::atomic<unsigned> mUnfinishedThreads;
+    std::atomic<uint64_t> mEnumPosition, mTotalHands;
+    std::atomic<double> mNextUpdate; // Seconds from mStartTime.
+    std::atomic<double> mTimeLimit{(double)INFINITE};
+    std::atomic<uint64_t> mHandLimit{INFINITE};
+    std::chrono::high_resolution_clock::time_point mStartTime;
+    std::vector<ThreadResults> mThreadResults;
+    std::mutex mReportMutex;
+    double mLastUpdate = 0; // Protected by mReportMutex.
+    std::mutex mMutex;
+    Results mUpdateResults; // Protected by mMutex.
+
+    // Preflop results cache, open addressing with linear probing. Key 0 marks an empty slot (preflop ids are never 0),
+    // each slot has mLookupStride = 2^players results. Protected by mLookupMutex.
+    std::mutex mLookupMutex;
+    std::vector<uint64_t> mLookupKeys;
+    std::vector<unsigned> mLookupResults;
+    unsigned mLookupStride = 0;
+    size_t mLookupCount = 0;
 
     // Constant shared data
     std::vector<CardRange> mOriginalHandRanges; // Original ranges without before card removal.
     std::vector<std::vector<std::array<uint8_t,2>>> mHandRanges; // Ranges after card removal.
+    std::vector<std::vector<double>> mHandWeights; // Combo weights of mHandRanges.
+    bool mWeighted = false;
+    AliasDistribution mComboAliases[MAX_PLAYERS]; // Weighted combo sampling for each combined range.
     CombinedRange mCombinedRanges[MAX_PLAYERS];
     unsigned mCombinedRangeCount;
-    uint64_t mDeadCards, mBoardCards;
+    uint64_t mDeadCards = 0, mBoardCards = 0;
     HandEvaluator mEval;
-    double mStdevTarget = 5e-5, mTimeLimit = (double)INFINITE, mUpdateInterval = 0.1;
-    uint64_t mHandLimit = INFINITE;
+    double mStdevTarget = 5e-5, mUpdateInterval = 0.1;
+    bool mStratified = false;
     std::function<void(const Results& results)> mCallback;
 
     // Precalculated results for 2 player preflop situations. Uses a sorted array for lowest memory use.
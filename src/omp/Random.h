@@ -1,9 +1,16 @@
 #ifndef OMP_RANDOM_H
 #define OMP_RANDOM_H
 
+#include "Util.h"
 #include "../libdivide/libdivide.h"
+#include <vector>
+#include <algorithm>
 #include <cstdint>
+#include <cstddef>
 #include <climits>
+#if OMP_AVX2 || OMP_AVX512
+    #include <immintrin.h>
+#endif
 
 namespace omp {
 
@@ -29,16 +36,35 @@ public:
         return result;
     }
 
-    static uint64_t min()
+    static constexpr uint64_t min()
     {
         return 0;
     }
 
-    static uint64_t max()
+    static constexpr uint64_t max()
     {
         return ~(uint64_t)0;
     }
 
+    // Advances the state by 2^64 steps. Calling it i times on copies of the same generator gives non-overlapping
+    // streams for 2^64 threads.
+    void jump()
+    {
+        static const uint64_t JUMP[] = {0xbeac0467eba5facb, 0xd86b048b86aa9922};
+        uint64_t s0 = 0, s1 = 0;
+        for (uint64_t j : JUMP) {
+            for (unsigned b = 0; b < 64; ++b) {
+                if (j & (1ull << b)) {
+                    s0 ^= mState[0];
+                    s1 ^= mState[1];
+                }
+                (*this)();
+            }
+        }
+        mState[0] = s0;
+        mState[1] = s1;
+    }
+
 private:
     static uint64_t rotl(uint64_t x, unsigned k)
     {
@@ -47,6 +73,135 @@ private:
     }
 
     uint64_t mState[2];
+
+    template<unsigned, unsigned> friend class MultiXoroShiro128Plus;
+};
+
+#if OMP_AVX512
+    #define OMP_RNG_LANES 8
+#else
+    #define OMP_RNG_LANES 4
+#endif
+
+// tLanes independent XoroShiro128Plus streams advanced together, so that one step produces tLanes numbers with a
+// handful of SIMD instructions (AVX2 for 4 lanes, AVX-512 for 8, plain loops otherwise). The streams are 2^64 apart,
+// and jump() moves all of them past the block of streams used by this generator. Output is buffered tSteps steps at
+// a time and handed out one number per call, so it's a drop-in replacement for XoroShiro128Plus. Use fill() to get
+// many numbers at once without the per-call overhead.
+template<unsigned tLanes = OMP_RNG_LANES, unsigned tSteps = 8>
+class MultiXoroShiro128Plus
+{
+public:
+    typedef uint64_t result_type;
+
+    static const unsigned BUFFER_SIZE = tLanes * tSteps;
+
+    MultiXoroShiro128Plus(uint64_t seed)
+    {
+        XoroShiro128Plus rng(seed);
+        for (unsigned i = 0; i < tLanes; ++i) {
+            mState0[i] = rng.mState[0];
+            mState1[i] = rng.mState[1];
+            rng.jump();
+        }
+    }
+
+    uint64_t operator()()
+    {
+        if (mBufferPos == BUFFER_SIZE) {
+            generate(mBuffer);
+            mBufferPos = 0;
+        }
+        return mBuffer[mBufferPos++];
+    }
+
+    // Writes count random numbers to out. Uses up the buffer first, then generates whole blocks in place.
+    void fill(uint64_t* out, size_t count)
+    {
+        for (; count && mBufferPos < BUFFER_SIZE; --count)
+            *out++ = mBuffer[mBufferPos++];
+        for (; count >= BUFFER_SIZE; count -= BUFFER_SIZE, out += BUFFER_SIZE)
+            generate(out);
+        for (; count; --count)
+            *out++ = (*this)();
+    }
+
+    // Moves every stream forward by tLanes * 2^64 steps, which is the next block of streams not used by a generator
+    // with the same seed. Thread i can call jump() i times to get its own streams. Discards buffered numbers.
+    void jump()
+    {
+        for (unsigned i = 0; i < tLanes; ++i) {
+            XoroShiro128Plus rng(0);
+            rng.mState[0] = mState0[i];
+            rng.mState[1] = mState1[i];
+            for (unsigned j = 0; j < tLanes; ++j)
+                rng.jump();
+            mState0[i] = rng.mState[0];
+            mState1[i] = rng.mState[1];
+        }
+        mBufferPos = BUFFER_SIZE;
+    }
+
+    static constexpr uint64_t min()
+    {
+        return 0;
+    }
+
+    static constexpr uint64_t max()
+    {
+        return ~(uint64_t)0;
+    }
+
+private:
+    // Runs tSteps steps of every stream. Output is step-major: out[step * tLanes + lane].
+    void generate(uint64_t* out)
+    {
+        #if OMP_AVX512
+        if (tLanes == 8) {
+            __m512i s0 = _mm512_load_si512((const __m512i*)mState0);
+            __m512i s1 = _mm512_load_si512((const __m512i*)mState1);
+            for (unsigned i = 0; i < tSteps; ++i) {
+                _mm512_storeu_si512((__m512i*)(out + i * 8), _mm512_add_epi64(s0, s1));
+                s1 = _mm512_xor_si512(s1, s0);
+                s0 = _mm512_xor_si512(_mm512_xor_si512(_mm512_rol_epi64(s0, 55), s1), _mm512_slli_epi64(s1, 14));
+                s1 = _mm512_rol_epi64(s1, 36);
+            }
+            _mm512_store_si512((__m512i*)mState0, s0);
+            _mm512_store_si512((__m512i*)mState1, s1);
+            return;
+        }
+        #endif
+        #if OMP_AVX2
+        if (tLanes == 4) {
+            __m256i s0 = _mm256_load_si256((const __m256i*)mState0);
+            __m256i s1 = _mm256_load_si256((const __m256i*)mState1);
+            for (unsigned i = 0; i < tSteps; ++i) {
+                _mm256_storeu_si256((__m256i*)(out + i * 4), _mm256_add_epi64(s0, s1));
+                s1 = _mm256_xor_si256(s1, s0);
+                __m256i r0 = _mm256_or_si256(_mm256_slli_epi64(s0, 55), _mm256_srli_epi64(s0, 9));
+                s0 = _mm256_xor_si256(_mm256_xor_si256(r0, s1), _mm256_slli_epi64(s1, 14));
+                s1 = _mm256_or_si256(_mm256_slli_epi64(s1, 36), _mm256_srli_epi64(s1, 28));
+            }
+            _mm256_store_si256((__m256i*)mState0, s0);
+            _mm256_store_si256((__m256i*)mState1, s1);
+            return;
+        }
+        #endif
+        for (unsigned i = 0; i < tSteps; ++i) {
+            for (unsigned j = 0; j < tLanes; ++j) {
+                uint64_t s0 = mState0[j], s1 = mState1[j];
+                out[i * tLanes + j] = s0 + s1;
+                s1 ^= s0;
+                mState0[j] = XoroShiro128Plus::rotl(s0, 55) ^ s1 ^ (s1 << 14);
+                mState1[j] = XoroShiro128Plus::rotl(s1, 36);
+            }
+        }
+    }
+
+    alignas(64) uint64_t mState0[tLanes];
+    alignas(64) uint64_t mState1[tLanes];
+    alignas(64) uint64_t mBuffer[BUFFER_SIZE];
+    unsigned mBufferPos = BUFFER_SIZE;
 };
 
 // Generates non-repeating pseudo random numbers in specified range using a linear congruential generator.
@@ -121,9 +276,48 @@ public:
         return mMin + res;
     }
 
+    // Draws count numbers into out. Whole random words are taken from rng.fill() (if it has one) and split in a
+    // branch-free loop that the compiler can vectorize. Leaves the single number buffer untouched.
+    template<class TRng>
+    void fill(TRng& rng, T* out, size_t count)
+    {
+        static_assert(sizeof(typename TRng::result_type) == sizeof(uint64_t), "64-bit RNG required.");
+        static const unsigned USES = sizeof(uint64_t) * CHAR_BIT / tBits;
+        static const size_t BLOCK = 64;
+        uint64_t words[BLOCK];
+        while (count >= USES) {
+            size_t wordCount = std::min<size_t>(BLOCK, count / USES);
+            fillWords(rng, words, wordCount, 0);
+            for (size_t i = 0; i < wordCount; ++i) {
+                for (unsigned j = 0; j < USES; ++j)
+                    out[i * USES + j] = mMin + (T)((((words[i] >> (j * tBits)) & MASK) * mDiff) >> tBits);
+            }
+            out += wordCount * USES;
+            count -= wordCount * USES;
+        }
+        if (count) {
+            fillWords(rng, words, 1, 0);
+            for (size_t j = 0; j < count; ++j)
+                out[j] = mMin + (T)((((words[0] >> (j * tBits)) & MASK) * mDiff) >> tBits);
+        }
+    }
+
 private:
     static const unsigned MASK = (1u << tBits) - 1;
 
+    template<class TRng>
+    static auto fillWords(TRng& rng, uint64_t* words, size_t count, int) -> decltype(rng.fill(words, count))
+    {
+        rng.fill(words, count);
+    }
+
+    template<class TRng>
+    static void fillWords(TRng& rng, uint64_t* words, size_t count, long)
+    {
+        for (size_t i = 0; i < count; ++i)
+            words[i] = rng();
+    }
+
     uint64_t mBuffer;
     unsigned mBufferUsesLeft;
     unsigned mDiff, mMin;
@@ -215,6 +409,66 @@ private:
     unsigned mBufferUsesLeft, mMaxBufferUses;
 };
 
+// Samples indexes with probability proportional to given weights in O(1) using Walker's alias method. Each bucket
+// holds its own index with probability threshold/2^32 and the alias otherwise. One 64-bit random number is used per
+// sample: the upper half picks the bucket and the lower half is compared against the threshold.
+class AliasDistribution
+{
+public:
+    AliasDistribution()
+    {
+    }
+
+    AliasDistribution(const std::vector<double>& weights)
+    {
+        init(weights);
+    }
+
+    void init(const std::vector<double>& weights)
+    {
+        size_t n = weights.size();
+        mThresholds.assign(n, ~0u);
+        mAliases.resize(n);
+        double sum = 0;
+        for (double w : weights)
+            sum += w;
+
+        // Vose's variant: pair each underfull bucket with an overfull one.
+        std::vector<double> scaled(n);
+        std::vector<unsigned> small, large;
+        for (size_t i = 0; i < n; ++i) {
+            mAliases[i] = (unsigned)i;
+            scaled[i] = sum > 0 ? weights[i] * n / sum : 1;
+            (scaled[i] < 1 ? small : large).push_back((unsigned)i);
+        }
+        while (!small.empty() && !large.empty()) {
+            unsigned s = small.back(), l = large.back();
+            small.pop_back();
+            mThresholds[s] = (uint32_t)(scaled[s] * 4294967296.0);
+            mAliases[s] = l;
+            scaled[l] -= 1 - scaled[s];
+            if (scaled[l] < 1) {
+                large.pop_back();
+                small.push_back(l);
+            }
+        }
+        // Leftovers are full buckets up to rounding errors.
+    }
+
+    template<class TRng>
+    unsigned operator()(TRng& rng) const
+    {
+        static_assert(sizeof(typename TRng::result_type) == sizeof(uint64_t), "64-bit RNG required.");
+        uint64_t r = rng();
+        unsigned idx = (unsigned)(((r >> 32) * mThresholds.size()) >> 32);
+        return (uint32_t)r < mThresholds[idx] ? idx : mAliases[idx];
+    }
+
+private:
+    std::vector<uint32_t> mThresholds;
+    std::vector<unsigned> mAliases;
+};
+
 }
 
 #endif // OMP_RANDOM_H
@@ -0,0 +1,73 @@
+#include "ThreadPool.h"
+
+#include <algorithm>
+
+namespace omp {
+
+ThreadPool::ThreadPool(unsigned threadCount)
+{
+    if (threadCount == 0)
+        threadCount = std::max(std::thread::hardware_concurrency(), 1u);
+    for (unsigned i = 0; i < threadCount; ++i)
+        mThreads.emplace_back([this]{ workerLoop(); });
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mShutdown = true;
+    }
+    mJobAvailable.notify_all();
+    for (auto& t : mThreads)
+        t.join();
+}
+
+void ThreadPool::submit(std::function<void()> job)
+{
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mJobs.push_back(std::move(job));
+    }
+    mJobAvailable.notify_one();
+}
+
+void ThreadPool::run(unsigned jobCount, const std::function<void()>& work)
+{
+    jobCount = std::max(std::min(jobCount, threadCount()), 1u);
+
+    std::mutex doneMutex;
+    std::condition_variable done;
+    unsigned unfinished = jobCount;
+
+    for (unsigned i = 0; i < jobCount; ++i) {
+        submit([&]{
+            work();
+            std::lock_guard<std::mutex> lock(doneMutex);
+            if (--unfinished == 0)
+                done.notify_all();
+        });
+    }
+
+    std::unique_lock<std::mutex> lock(doneMutex);
+    done.wait(lock, [&]{ return unfinished == 0; });
+}
+
+// Workers sleep until there's a job, and only exit once the queue is empty.
+void ThreadPool::workerLoop()
+{
+    for (;;) {
+        std::function<void()> job;
+        {
+            std::unique_lock<std::mutex> lock(mMutex);
+            mJobAvailable.wait(lock, [this]{ return mShutdown || !mJobs.empty(); });
+            if (mJobs.empty())
+                return;
+            job = std::move(mJobs.front());
+            mJobs.pop_front();
+        }
+        job();
+    }
+}
+
+}
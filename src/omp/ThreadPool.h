@@ -0,0 +1,55 @@
+#ifndef OMP_THREAD_POOL_H
+#define OMP_THREAD_POOL_H
+
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+
+namespace omp {
+
+// Fixed set of worker threads running jobs from a FIFO queue. Threads are started once and live as long as the pool,
+// so submitting a job only costs a queue push and a wakeup. Can be shared by multiple EquityCalculators and anything
+// else that wants to run work in the background.
+class ThreadPool
+{
+public:
+    // threadCount: number of worker threads, 0 for maximum parallelism supported by hardware
+    explicit ThreadPool(unsigned threadCount = 0);
+
+    // Finishes all queued jobs before joining the workers.
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    // Queue a job to be run by the next free worker.
+    void submit(std::function<void()> job);
+
+    // Runs work() on min(jobCount, threadCount()) workers at the same time and blocks until all of them return.
+    // Must not be called from a job of the same pool.
+    void run(unsigned jobCount, const std::function<void()>& work);
+
+    // Number of worker threads.
+    unsigned threadCount() const
+    {
+        return (unsigned)mThreads.size();
+    }
+
+private:
+    void workerLoop();
+
+    std::vector<std::thread> mThreads;
+
+    // Protected by mMutex.
+    std::mutex mMutex;
+    std::condition_variable mJobAvailable;
+    std::deque<std::function<void()>> mJobs;
+    bool mShutdown = false;
+};
+
+}
+
+#endif // OMP_THREAD_POOL_H
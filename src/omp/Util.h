@@ -24,6 +24,14 @@
     #endif
 #endif
 
+// Detect AVX2/AVX-512 (only used for wide integer operations, so AVX-512F is enough).
+#ifndef OMP_AVX2
+    #define OMP_AVX2 __AVX2__
+#endif
+#ifndef OMP_AVX512
+    #define OMP_AVX512 __AVX512F__
+#endif
+
 #if _MSC_VER
     #define OMP_FORCE_INLINE __forceinline
 #else
@@ -43,6 +51,28 @@ inline unsigned countTrailingZeros(unsigned x)
     #endif
 }
 
+inline unsigned countTrailingZeros(unsigned long long x)
+{
+    #if _MSC_VER && _M_X64
+    unsigned long bitIdx;
+    _BitScanForward64(&bitIdx, x);
+    return bitIdx;
+    #elif _MSC_VER
+    return (unsigned)x ? countTrailingZeros((unsigned)x) : 32 + countTrailingZeros((unsigned)(x >> 32));
+    #else
+    return __builtin_ctzll(x);
+    #endif
+}
+
+inline unsigned countTrailingZeros(unsigned long x)
+{
+    #if _MSC_VER
+    return countTrailingZeros((unsigned)x);
+    #else
+    return countTrailingZeros((unsigned long long)x);
+    #endif
+}
+
 inline unsigned countLeadingZeros(unsigned x)
 {
     #if _MSC_VER
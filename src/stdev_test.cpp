@@ -0,0 +1,66 @@
+/*
+ * ./stdev_test [runs] [hands]
+ *
+ * Checks that Results.stdev of stratified monte carlo matches the spread
+ * it claims: runs independent calculations of a few spots with a hand
+ * limit and compares the mean reported stdev with the standard deviation
+ * of their equities. With 40 runs the empirical value is good to about
+ * 11%, so anything outside 0.7 - 1.4 of it fails. Exits 1 on a failure.
+ */
+#include "omp/EquityCalculator.h"
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+struct Spot {
+	const char* name;
+	std::vector<const char*> ranges;
+	const char* board;
+};
+
+static bool check(const Spot& spot, int runs, uint64_t hands) {
+	std::vector<omp::CardRange> ranges(spot.ranges.begin(), spot.ranges.end());
+	uint64_t board = omp::CardRange::getCardMask(spot.board);
+	double sum = 0, sum_sqr = 0, reported = 0;
+
+	for (int r = 0; r < runs; r++) {
+		omp::EquityCalculator eq;
+		eq.setStratified(true);
+		eq.setHandLimit(hands);
+		eq.start(ranges, board, 0, false, 0, nullptr, 0.2, 1);
+		eq.wait();
+		omp::EquityCalculator::Results res = eq.getResults();
+		sum += res.equity[0];
+		sum_sqr += res.equity[0] * res.equity[0];
+		reported += res.stdev;
+	}
+
+	double empirical = std::sqrt((sum_sqr - sum * sum / runs) / (runs - 1));
+	reported /= runs;
+	double ratio = reported / empirical;
+	bool ok = ratio > 0.7 && ratio < 1.4;
+	printf("%-24s equity %.5f  reported stdev %.3e  across runs %.3e  ratio %.2f  %s\n", spot.name, sum / runs,
+	       reported, empirical, ratio, ok ? "ok" : "FAIL");
+	return ok;
+}
+
+int main(int argc, char** argv) {
+	int runs = (argc > 1) ? atoi(argv[1]) : 40;
+	uint64_t hands = (argc > 2) ? strtoull(argv[2], NULL, 10) : 200000;
+	if (runs < 2)
+		runs = 2;
+
+	std::vector<Spot> spots = {
+		{ "AKs vs QQ preflop", { "AKs", "QQ" }, "" },
+		{ "random vs random flop", { "random", "random" }, "2c7dKh" },
+		{ "random vs random turn", { "random", "random" }, "2c7dKhTs" },
+		{ "wide vs narrow flop", { "22+,A2s+,KTo+", "TT+,AK" }, "Jh8s3c" },
+	};
+
+	bool ok = true;
+	for (const Spot& spot : spots)
+		ok = check(spot, runs, hands) && ok;
+	return ok ? 0 : 1;
+}
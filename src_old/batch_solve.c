@@ -0,0 +1,392 @@
+#include "spot_cache.h"
+#include "strategy_export.h"
+#include "evaluator.h"
+#include "cfr.h"
+
+#include <omp.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/*
+ * ./batch_solve [--dry-run] spots.txt out_dir [threads_per_job] [mem_mb] [max_variants]
+ *
+ * Solves a list of spots, one per line as spot_request_parse fields plus
+ * name=<file stem> and bits=<8|16>, blank lines and # comments skipped:
+ *
+ *   name=As8s2s board=As8s2s pot=200 stacks=300,300 iters=500 target=0.3
+ *
+ * Spots that differ only in their ranges (same board up to suits, pot,
+ * stacks, iters and target) are solved together as range variants of one
+ * tree (cfr.h), up to max_variants (16) at a time, 1 solving each alone.
+ *
+ * Each tree is sized beforehand with estimate_public_tree, which gives its
+ * arena exactly, and costed at iters times the work of one iteration. A
+ * job's memory is that arena (regret and strategy sums of all its
+ * variants) plus the reach rows, the node values and the strategy file
+ * writer on the heap. Jobs run concurrently with threads_per_job OpenMP
+ * threads each (all cores over the batch), longest first, starting the
+ * longest pending job whose memory still fits in mem_mb next to the ones
+ * running. A job larger than mem_mb on its own runs alone.
+ *
+ * Strategy files go to out_dir/<name>.tfs with their node values
+ * (calc_node_values), and a line per finished spot to out_dir/results.txt
+ * as soon as it's written. --dry-run prints the estimates and the order
+ * jobs would start in, taking cost for time, without solving.
+ */
+#define LINE_LEN 4096
+#define NAME_LEN 128
+
+typedef struct {
+	char name[NAME_LEN];
+	int quant_bits;
+	SpotRequest* req;           //canonical
+} BatchSpot;
+
+typedef struct {
+	BatchSpot* spots[SPOT_MAX_VARIANTS];
+	int num_variants;
+	int num_buckets;            //num_variants * padded buckets
+	TreeStats stats;
+	size_t bytes;               //stats.bytes plus the heap the job holds at its peak
+	double work;                //bucket cells touched per iteration
+	double cost;                //work * iters
+	int state;                  //0 pending, 1 running, 2 done
+} BatchJob;
+
+typedef struct {
+	BatchSpot* spots;
+	int num_spots;
+	BatchJob* jobs;
+	int num_jobs;
+	int threads_per_job;
+	const char* out_dir;
+	FILE* results;
+
+	pthread_mutex_t lock;
+	pthread_cond_t job_done;
+	int running;
+	size_t bytes_running;
+	double total_cost;
+} Batch;
+
+static double now_seconds() {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+//showdowns compare every pair of unique buckets, folds and the rest are per bucket
+static void estimate_job(BatchJob* job) {
+	const SpotRequest* req = job->spots[0]->req;
+	IsoMap map;
+	build_isomorphism_map(req->board, &map);
+	job->num_buckets = map.padded_buckets * job->num_variants;
+
+	GameState state = {0};
+	state.board = req->board;
+	state.pot = req->pot;
+	state.p1_stack = req->p1_stack;
+	state.p2_stack = req->p2_stack;
+	state.street = __builtin_popcountll(req->board) - 3;
+	estimate_public_tree(state, job->num_buckets, &job->stats);
+
+	int quant_bits = 8;
+	for (int v = 0; v < job->num_variants; v++)
+		if (job->spots[v]->quant_bits > quant_bits)
+			quant_bits = job->spots[v]->quant_bits;
+	job->bytes = job->stats.bytes + 2 * job->num_buckets * sizeof(float) +
+		node_values_bytes(&job->stats, &map, job->num_buckets) +
+		strategy_file_write_bytes(job->stats.action_nodes, &map, quant_bits);
+
+	double unique = map.num_unique_buckets;
+	int folds = job->stats.terminal_nodes - job->stats.showdown_nodes;
+	job->work = job->stats.action_cells + job->stats.showdown_nodes * unique * unique * job->num_variants +
+		(double)(folds + job->stats.chance_nodes) * job->num_buckets;
+	job->cost = job->work * req->max_iterations;
+}
+
+static int by_cost(const void* a, const void* b) {
+	double ca = ((const BatchJob*)a)->cost, cb = ((const BatchJob*)b)->cost;
+	return (ca < cb) - (ca > cb);
+}
+
+static int read_spots(const char* path, Batch* batch) {
+	FILE* f = fopen(path, "r");
+	if (!f) {
+		printf("Couldn't open %s\n", path);
+		return 0;
+	}
+
+	int capacity = 64;
+	batch->spots = (BatchSpot*)calloc(capacity, sizeof(BatchSpot));
+	batch->num_spots = 0;
+	SpotRequest* req = (SpotRequest*)malloc(sizeof(SpotRequest));
+
+	char line[LINE_LEN];
+	int line_no = 0, ok = 1;
+	while (fgets(line, sizeof(line), f)) {
+		line_no++;
+		char* text = line + strspn(line, " \t\r\n");
+		if (!*text || *text == '#')
+			continue;
+
+		SpotParams params;
+		spot_params_split(text, &params);
+		const char* error = spot_request_parse(&params, req);
+		if (error) {
+			printf("%s:%d: %s\n", path, line_no, error);
+			ok = 0;
+			continue;
+		}
+
+		if (batch->num_spots == capacity) {
+			capacity *= 2;
+			batch->spots = (BatchSpot*)realloc(batch->spots, capacity * sizeof(BatchSpot));
+		}
+		const char* bits = spot_param(&params, "bits", "8");
+		if (strcmp(bits, "8") != 0 && strcmp(bits, "16") != 0) {
+			printf("%s:%d: bits must be 8 or 16\n", path, line_no);
+			ok = 0;
+			continue;
+		}
+
+		BatchSpot* spot = &batch->spots[batch->num_spots++];
+		spot->quant_bits = atoi(bits);
+		snprintf(spot->name, NAME_LEN, "%s", spot_param(&params, "name", ""));
+		if (!spot->name[0])
+			snprintf(spot->name, NAME_LEN, "spot%d", line_no);
+
+		spot->req = (SpotRequest*)malloc(sizeof(SpotRequest));
+		spot_hash(req, spot->req);
+	}
+	free(req);
+	fclose(f);
+	return ok;
+}
+
+static int same_tree(const SpotRequest* a, const SpotRequest* b) {
+	return a->board == b->board && a->pot == b->pot && a->p1_stack == b->p1_stack && a->p2_stack == b->p2_stack &&
+		a->max_iterations == b->max_iterations && a->target == b->target;
+}
+
+//groups spots sharing a tree into jobs of up to max_variants, in file order
+static void make_jobs(Batch* batch, int max_variants) {
+	batch->jobs = (BatchJob*)calloc(batch->num_spots, sizeof(BatchJob));
+	batch->num_jobs = 0;
+	int* taken = (int*)calloc(batch->num_spots, sizeof(int));
+
+	for (int i = 0; i < batch->num_spots; i++) {
+		if (taken[i])
+			continue;
+		BatchJob* job = &batch->jobs[batch->num_jobs++];
+		for (int j = i; j < batch->num_spots && job->num_variants < max_variants; j++) {
+			if (!taken[j] && same_tree(batch->spots[i].req, batch->spots[j].req)) {
+				job->spots[job->num_variants++] = &batch->spots[j];
+				taken[j] = 1;
+			}
+		}
+		estimate_job(job);
+	}
+	free(taken);
+}
+
+//the longest pending job that fits next to the running ones, -1 if none can start now
+static int next_job(const Batch* batch, size_t max_bytes, int slots) {
+	if (batch->running >= slots)
+		return -1;
+	for (int i = 0; i < batch->num_jobs; i++) {
+		const BatchJob* job = &batch->jobs[i];
+		if (job->state != 0)
+			continue;
+		if (batch->bytes_running + job->bytes <= max_bytes || batch->running == 0)
+			return i;
+	}
+	return -1;
+}
+
+typedef struct {
+	Batch* batch;
+	BatchJob* job;
+} JobArgs;
+
+static void* run_job(void* arg) {
+	Batch* batch = ((JobArgs*)arg)->batch;
+	BatchJob* job = ((JobArgs*)arg)->job;
+	free(arg);
+	omp_set_num_threads(batch->threads_per_job);
+
+	double start = now_seconds();
+	const SpotRequest* variants[SPOT_MAX_VARIANTS];
+	for (int v = 0; v < job->num_variants; v++)
+		variants[v] = job->spots[v]->req;
+	SpotEntry* e = (SpotEntry*)calloc(1, sizeof(SpotEntry));
+	spot_entry_build(e, variants, job->num_variants, job->stats.bytes);
+	spot_entry_solve(e, variants[0]->target, variants[0]->max_iterations);
+
+	calc_node_values(e->root, e->state, &e->map, e->map.padded_buckets * e->num_variants, e->reach[0], e->reach[1]);
+	char paths[SPOT_MAX_VARIANTS][LINE_LEN];
+	int written[SPOT_MAX_VARIANTS];
+	for (int v = 0; v < job->num_variants; v++) {
+		snprintf(paths[v], LINE_LEN, "%s/%s.tfs", batch->out_dir, job->spots[v]->name);
+		written[v] = strategy_file_write_variant(paths[v], e->root, e->state, &e->map, job->spots[v]->quant_bits,
+			v, job->num_variants);
+	}
+	double seconds = now_seconds() - start;
+
+	pthread_mutex_lock(&batch->lock);
+	job->state = 2;
+	batch->running--;
+	batch->bytes_running -= job->bytes;
+	for (int v = 0; v < job->num_variants; v++) {
+		fprintf(batch->results, "%s iterations=%d exploitability=%.4f seconds=%.1f mb=%.1f variants=%d file=%s\n",
+			job->spots[v]->name, e->iterations, e->variant_exploitability[v], seconds, job->bytes / 1048576.0,
+			job->num_variants, written[v] ? paths[v] : "ERROR");
+		printf("%-20s %5d iterations  %.4f%% pot  %7.1fs%s\n", job->spots[v]->name, e->iterations,
+			e->variant_exploitability[v], seconds, written[v] ? "" : "  (couldn't write the strategy file)");
+	}
+	fflush(batch->results);
+	fflush(stdout);
+	pthread_cond_signal(&batch->job_done);
+	pthread_mutex_unlock(&batch->lock);
+
+	free_node_values(e->root);
+	spot_entry_clear(e);
+	free(e);
+	return NULL;
+}
+
+//replays run_batch with cost for time, printing jobs in the order they'd start
+static void plan_batch(Batch* batch, size_t max_bytes, int slots) {
+	double* finish = (double*)calloc(batch->num_jobs, sizeof(double));
+	double clock = 0.0;
+	int started = 0;
+
+	printf("%-20s %2s %5s %8s %9s %12s %7s\n", "name", "K", "bkts", "nodes", "MB", "cost", "start");
+	while (started < batch->num_jobs || batch->running > 0) {
+		int i = (started < batch->num_jobs) ? next_job(batch, max_bytes, slots) : -1;
+		if (i < 0) {
+			int first = -1;
+			for (int j = 0; j < batch->num_jobs; j++)
+				if (batch->jobs[j].state == 1 && (first < 0 || finish[j] < finish[first]))
+					first = j;
+			clock = finish[first];
+			batch->jobs[first].state = 2;
+			batch->running--;
+			batch->bytes_running -= batch->jobs[first].bytes;
+			continue;
+		}
+
+		BatchJob* job = &batch->jobs[i];
+		job->state = 1;
+		finish[i] = clock + job->cost;
+		batch->running++;
+		batch->bytes_running += job->bytes;
+		started++;
+		printf("%-20s %2d %5d %8d %9.1f %12.3e %6.1f%%\n", job->spots[0]->name, job->num_variants, job->num_buckets,
+			job->stats.action_nodes + job->stats.chance_nodes + job->stats.terminal_nodes,
+			job->bytes / 1048576.0, job->cost, clock * 100.0 / batch->total_cost);
+	}
+	printf("Estimated wall time %.1f%% of running the spots one after another.\n", clock * 100.0 / batch->total_cost);
+	free(finish);
+}
+
+//starts jobs in next_job order as running ones finish
+static void run_batch(Batch* batch, size_t max_bytes, int slots) {
+	pthread_mutex_lock(&batch->lock);
+	int started = 0;
+	while (started < batch->num_jobs) {
+		int i = next_job(batch, max_bytes, slots);
+		if (i < 0) {
+			pthread_cond_wait(&batch->job_done, &batch->lock);
+			continue;
+		}
+
+		BatchJob* job = &batch->jobs[i];
+		job->state = 1;
+		batch->running++;
+		batch->bytes_running += job->bytes;
+		started++;
+
+		JobArgs* args = (JobArgs*)malloc(sizeof(JobArgs));
+		args->batch = batch;
+		args->job = job;
+		pthread_t thread;
+		pthread_create(&thread, NULL, run_job, args);
+		pthread_detach(thread);
+	}
+	while (batch->running > 0)
+		pthread_cond_wait(&batch->job_done, &batch->lock);
+	pthread_mutex_unlock(&batch->lock);
+}
+
+int main(int argc, char** argv) {
+	int dry_run = (argc > 1 && strcmp(argv[1], "--dry-run") == 0);
+	argv += dry_run;
+	argc -= dry_run;
+	if (argc < 3) {
+		printf("Usage: %s [--dry-run] spots.txt out_dir [threads_per_job] [mem_mb] [max_variants]\n", argv[0]);
+		return 1;
+	}
+
+	int procs = omp_get_num_procs();
+	int threads_per_job = (argc > 3) ? atoi(argv[3]) : 1;
+	size_t max_bytes = (size_t)((argc > 4) ? atol(argv[4]) : 8192) << 20;
+	int max_variants = (argc > 5) ? atoi(argv[5]) : SPOT_MAX_VARIANTS;
+	if (max_variants < 1 || max_variants > SPOT_MAX_VARIANTS)
+		max_variants = SPOT_MAX_VARIANTS;
+	if (threads_per_job < 1)
+		threads_per_job = 1;
+	if (threads_per_job > procs)
+		threads_per_job = procs;
+	int slots = procs / threads_per_job;
+
+	Batch batch;
+	memset(&batch, 0, sizeof(batch));
+	pthread_mutex_init(&batch.lock, NULL);
+	pthread_cond_init(&batch.job_done, NULL);
+	batch.threads_per_job = threads_per_job;
+	batch.out_dir = argv[2];
+
+	if (!read_spots(argv[1], &batch))
+		return 1;
+	make_jobs(&batch, max_variants);
+	qsort(batch.jobs, batch.num_jobs, sizeof(BatchJob), by_cost);
+
+	size_t largest = 0;
+	for (int i = 0; i < batch.num_jobs; i++) {
+		batch.total_cost += batch.jobs[i].cost;
+		if (batch.jobs[i].bytes > largest)
+			largest = batch.jobs[i].bytes;
+	}
+	printf("%d spots in %d jobs, %d at a time x %d threads, %zu MB cap, largest job %.1f MB, total cost %.3e\n",
+		batch.num_spots, batch.num_jobs, slots, threads_per_job, max_bytes >> 20, largest / 1048576.0, batch.total_cost);
+	if (largest > max_bytes)
+		printf("WARNING: some jobs are over the cap on their own and will run alone.\n");
+
+	if (dry_run) {
+		plan_batch(&batch, max_bytes, slots);
+		return 0;
+	}
+
+	char path[LINE_LEN];
+	snprintf(path, sizeof(path), "%s/results.txt", batch.out_dir);
+	batch.results = fopen(path, "a");
+	if (!batch.results) {
+		printf("Couldn't open %s\n", path);
+		return 1;
+	}
+
+	init_evaluator();
+	double start = now_seconds();
+	run_batch(&batch, max_bytes, slots);
+	printf("Batch done in %.1fs.\n", now_seconds() - start);
+
+	fclose(batch.results);
+	for (int i = 0; i < batch.num_spots; i++)
+		free(batch.spots[i].req);
+	free(batch.spots);
+	free(batch.jobs);
+	return 0;
+}
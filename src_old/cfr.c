@@ -57,12 +57,31 @@ void calc_average_strategy(float* strategy_sum, float* avg_strategy, int num_act
 	}
 }
 
+//depth limit: blueprint value of each P1 bucket against the opponent's reach mass in its range variant
+static void evaluate_leaf(PublicNode* node, GameState state, int num_buckets, int stride, float* p2_reach, float* out_util) {
+	float sign = (state.active_player == 0) ? 1.0f : -1.0f;
+	for (int offset = 0; offset < num_buckets; offset += stride) {
+		float opp_mass = 0.0f;
+		for (int b = offset; b < offset + stride; b++)
+			opp_mass += p2_reach[b];
+
+		#pragma omp parallel for simd if(stride > 500)
+		for (int b = offset; b < offset + stride; b++)
+			out_util[b] = sign * node->leaf_values[b] * opp_mass;
+	}
+}
+
 void walk_tree(PublicNode* node, GameState state, IsoMap* map, int num_buckets, float* p1_reach, float* p2_reach, float* out_util, uint64_t* precomputed_masks) {
 	if (node->type == NODE_TERMINAL) {
 		evaluate_showdown(state, map, num_buckets, p1_reach, p2_reach, out_util, precomputed_masks);
 		return;
 	}
 
+	if (node->type == NODE_LEAF) {
+		evaluate_leaf(node, state, num_buckets, map->padded_buckets, p2_reach, out_util);
+		return;
+	}
+
 	if (node->type == NODE_CHANCE) {
 		memset(out_util, 0, num_buckets * sizeof(float));
 		float* child_util = (float*) malloc(num_buckets * sizeof(float));
@@ -159,6 +178,11 @@ void walk_br_tree(PublicNode* node, GameState state, IsoMap* map, int num_bucket
 		return;
 	}
 
+	if (node->type == NODE_LEAF) {
+		evaluate_leaf(node, state, num_buckets, map->padded_buckets, p2_reach, out_util);
+		return;
+	}
+
 	if (node->type == NODE_CHANCE) {
 		memset(out_util, 0, num_buckets * sizeof(float));
 		float* child_util = (float*) malloc(num_buckets * sizeof(float));
@@ -244,11 +268,15 @@ void walk_br_tree(PublicNode* node, GameState state, IsoMap* map, int num_bucket
 	free(action_utils);
 }
 
-float calc_exploitability(PublicNode* root, GameState initial_state, IsoMap* map, int num_buckets, float* p1_starting_range, float* p2_starting_range) {
-	float br_total_ev = 0.0f;
-	uint64_t* precomputed_masks = (uint64_t*)malloc(num_buckets * sizeof(uint64_t));
-	for (int i = 0; i < num_buckets; i++)
+//out gets one value per range variant, calc_exploitability in each
+void calc_exploitability_variants(PublicNode* root, GameState initial_state, IsoMap* map, int num_buckets, float* p1_starting_range, float* p2_starting_range, float* out) {
+	int stride = map->padded_buckets;
+	int num_variants = num_buckets / stride;
+	uint64_t* precomputed_masks = (uint64_t*)malloc(stride * sizeof(uint64_t));
+	for (int i = 0; i < stride; i++)
 		precomputed_masks[i] = get_mask_for_bucket(map,i);
+	for (int v = 0; v < num_variants; v++)
+		out[v] = 0.0f;
 
 	for (int exploiter = 0; exploiter < 2; exploiter++) {
 		float* p1_reach  = (float*)malloc(num_buckets * sizeof(float));
@@ -262,37 +290,281 @@ float calc_exploitability(PublicNode* root, GameState initial_state, IsoMap* map
 		}
 
 		walk_br_tree(root, initial_state, map, num_buckets, exploiter, p1_reach, p2_reach, root_util, precomputed_masks);
-		float player_ev = 0.0f;
-		for (int b = 0; b < num_buckets; b++) {
-			if (exploiter == 0)
-				player_ev += root_util[b] * p1_starting_range[b];
-			else
-				player_ev += root_util[b] * p2_starting_range[b];
+		for (int v = 0; v < num_variants; v++) {
+			float player_ev = 0.0f;
+			for (int b = v * stride; b < (v + 1) * stride; b++) {
+				if (exploiter == 0)
+					player_ev += root_util[b] * p1_starting_range[b];
+				else
+					player_ev += root_util[b] * p2_starting_range[b];
+			}
+			out[v] += player_ev;
 		}
 
-		br_total_ev += player_ev;
-
 		free(p1_reach);
 		free(p2_reach);
 		free(root_util);
 	}
 
+	for (int v = 0; v < num_variants; v++)
+		out[v] /= 2.0f;
 	free(precomputed_masks);
-	return br_total_ev / 2.0f;
+}
+
+//summed over the range variants
+float calc_exploitability(PublicNode* root, GameState initial_state, IsoMap* map, int num_buckets, float* p1_starting_range, float* p2_starting_range) {
+	int num_variants = num_buckets / map->padded_buckets;
+	float* per_variant = (float*)malloc(num_variants * sizeof(float));
+	calc_exploitability_variants(root, initial_state, map, num_buckets, p1_starting_range, p2_starting_range, per_variant);
+
+	float total = 0.0f;
+	for (int v = 0; v < num_variants; v++)
+		total += per_variant[v];
+	free(per_variant);
+	return total;
+}
+
+//shared by a calc_node_values pass
+typedef struct {
+	IsoMap* map;
+	int num_buckets;
+	int stride;                  //padded buckets, one range variant
+	int root_stack[2];
+	uint64_t* precomputed_masks;
+	ShowdownOrder** orders;      //open addressing on the board, ORDER_SLOTS
+} ReportPass;
+
+#define ORDER_SLOTS 8192
+
+//river boards repeat all over the tree, so each is sorted once
+static const ShowdownOrder* report_order(ReportPass* pass, uint64_t board) {
+	uint32_t slot = (uint32_t)((board * 0x9e3779b97f4a7c15ull) >> 51) & (ORDER_SLOTS - 1);
+	while (pass->orders[slot] && pass->orders[slot]->board != board)
+		slot = (slot + 1) & (ORDER_SLOTS - 1);
+	if (!pass->orders[slot]) {
+		pass->orders[slot] = (ShowdownOrder*)malloc(sizeof(ShowdownOrder));
+		showdown_order(board, pass->map, pass->precomputed_masks, pass->orders[slot]);
+	}
+	return pass->orders[slot];
+}
+
+//adds weight * showdown share against opp_reach over every runout from state
+static void checkdown_shares(ReportPass* pass, GameState state, float* opp_reach, float weight, float* out_share) {
+	if (state.street == 2) {
+		const ShowdownOrder* order = report_order(pass, state.board);
+		for (int offset = 0; offset < pass->num_buckets; offset += pass->stride)
+			showdown_shares(order, opp_reach + offset, weight, out_share + offset);
+		return;
+	}
+
+	int unique_cards[52];
+	float weights[52];
+	int num_deals = get_isomorphic_runouts(&state, unique_cards, weights);
+	float total_weight = 0.0f;
+	for (int i = 0; i < num_deals; i++)
+		total_weight += weights[i];
+	for (int i = 0; i < num_deals; i++)
+		checkdown_shares(pass, apply_deal(state, unique_cards[i]), opp_reach, weight * weights[i] / total_weight, out_share);
+}
+
+//opponent reach mass of the range variant bucket b is in
+static void block_masses(ReportPass* pass, const float* reach, float* out_mass) {
+	for (int offset = 0; offset < pass->num_buckets; offset += pass->stride) {
+		float mass = 0.0f;
+		for (int b = offset; b < offset + pass->stride; b++)
+			mass += reach[b];
+		for (int b = offset; b < offset + pass->stride; b++)
+			out_mass[b] = mass;
+	}
+}
+
+/*
+ * Counterfactual values of both players, out_util[p] per bucket: chips
+ * back from the pot minus chips put in since the root, weighted by the
+ * opponent's reach. Unlike walk_tree this counts the whole pot and every
+ * street's chips, so the values are real chip EVs once normalized.
+ */
+static void walk_report(PublicNode* node, GameState state, ReportPass* pass, float* p1_reach, float* p2_reach, float* out_util[2]) {
+	int num_buckets = pass->num_buckets;
+	float invested[2] = {
+		(float)(pass->root_stack[0] - state.p1_stack),
+		(float)(pass->root_stack[1] - state.p2_stack)
+	};
+	float* reach[2] = { p1_reach, p2_reach };
+
+	if (node->type == NODE_TERMINAL) {
+		for (int p = 0; p < 2; p++) {
+			float* opp_mass = (float*)malloc(num_buckets * sizeof(float));
+			block_masses(pass, reach[1 - p], opp_mass);
+
+			if (state.last_action_was_fold) {
+				float won = (state.active_player == p) ? 0.0f : (float)state.pot;
+				for (int b = 0; b < num_buckets; b++)
+					out_util[p][b] = (won - invested[p]) * opp_mass[b];
+			} else {
+				memset(out_util[p], 0, num_buckets * sizeof(float));
+				checkdown_shares(pass, state, reach[1 - p], 1.0f, out_util[p]);
+				for (int b = 0; b < num_buckets; b++)
+					out_util[p][b] = (float)state.pot * out_util[p][b] - invested[p] * opp_mass[b];
+			}
+			free(opp_mass);
+		}
+		return;
+	}
+
+	//leaf values are P1's blueprint values net of the dead pot, neither player's EV in the terms above
+	if (node->type == NODE_LEAF) {
+		for (int p = 0; p < 2; p++)
+			for (int b = 0; b < num_buckets; b++)
+				out_util[p][b] = NAN;
+		return;
+	}
+
+	float* child_util[2] = {
+		(float*)malloc(num_buckets * sizeof(float)),
+		(float*)malloc(num_buckets * sizeof(float))
+	};
+	memset(out_util[0], 0, num_buckets * sizeof(float));
+	memset(out_util[1], 0, num_buckets * sizeof(float));
+
+	if (node->type == NODE_CHANCE) {
+		float total_weight = 0.0f;
+		for (int i = 0; i < node->num_children; i++)
+			total_weight += node->chance_weights[i];
+
+		for (int i = 0; i < node->num_children; i++) {
+			GameState next_state = apply_deal(state, node->dealt_cards[i]);
+			walk_report(node->children[i], next_state, pass, p1_reach, p2_reach, child_util);
+			float p_card = (total_weight > 0.0f) ? (node->chance_weights[i] / total_weight) : 0.0f;
+			for (int p = 0; p < 2; p++)
+				for (int b = 0; b < num_buckets; b++)
+					out_util[p][b] += child_util[p][b] * p_card;
+		}
+		free(child_util[0]);
+		free(child_util[1]);
+		return;
+	}
+
+	int active = node->active_player;
+	int num_actions = node->num_children;
+	int legal_actions[8];
+	generate_bet_sizes(&state, legal_actions);
+
+	float* avg_strategy = (float*)malloc(num_actions * num_buckets * sizeof(float));
+	float* next_reach = (float*)malloc(num_buckets * sizeof(float));
+	calc_average_strategy(node->strategy_sum, avg_strategy, num_actions, num_buckets);
+
+	for (int a = 0; a < num_actions; a++) {
+		for (int b = 0; b < num_buckets; b++)
+			next_reach[b] = reach[active][b] * avg_strategy[a * num_buckets + b];
+
+		GameState next_state = apply_bet(state, legal_actions[a]);
+		if (active == 0)
+			walk_report(node->children[a], next_state, pass, next_reach, p2_reach, child_util);
+		else
+			walk_report(node->children[a], next_state, pass, p1_reach, next_reach, child_util);
+
+		for (int b = 0; b < num_buckets; b++) {
+			out_util[active][b] += avg_strategy[a * num_buckets + b] * child_util[active][b];
+			out_util[1 - active][b] += child_util[1 - active][b];
+		}
+	}
+
+	//EV from here on: the counterfactual value per unit of opponent reach, plus the chips already in
+	if (!node->values)
+		node->values = (float*)malloc(4 * num_buckets * sizeof(float));
+	float* opp_mass = next_reach;
+	for (int p = 0; p < 2; p++) {
+		float* ev = node->values + p * num_buckets;
+		float* equity = node->values + (2 + p) * num_buckets;
+		block_masses(pass, reach[1 - p], opp_mass);
+		memset(equity, 0, num_buckets * sizeof(float));
+		checkdown_shares(pass, state, reach[1 - p], 1.0f, equity);
+
+		for (int b = 0; b < num_buckets; b++) {
+			if (opp_mass[b] > 0.0f) {
+				ev[b] = out_util[p][b] / opp_mass[b] + invested[p];
+				equity[b] /= opp_mass[b];
+			} else {
+				ev[b] = NAN;
+				equity[b] = NAN;
+			}
+		}
+	}
+
+	free(avg_strategy);
+	free(next_reach);
+	free(child_util[0]);
+	free(child_util[1]);
+}
+
+/*
+ * Report pass, run once after solving: walks the tree with the average
+ * strategy and gives every action node its values (tree.h), four rows of
+ * num_buckets: EV of P1, EV of P2, equity of P1, equity of P2.
+ *
+ * EV is a bucket's expected chips out of the pot from the node on minus
+ * the chips it still puts in, against the opponent's range at the node.
+ * Equity is its share of that pot if the hand were checked down from
+ * there, on the same showdown scores the solver uses. Both are NAN where
+ * the opponent can't be at the node, and EQR is EV / (equity * pot). EV
+ * is NAN too at nodes with a depth limit leaf (tree.h) below them.
+ */
+void calc_node_values(PublicNode* root, GameState initial_state, IsoMap* map, int num_buckets, float* p1_starting_range, float* p2_starting_range) {
+	ReportPass pass;
+	pass.map = map;
+	pass.num_buckets = num_buckets;
+	pass.stride = map->padded_buckets;
+	pass.root_stack[0] = initial_state.p1_stack;
+	pass.root_stack[1] = initial_state.p2_stack;
+	pass.precomputed_masks = (uint64_t*)malloc(pass.stride * sizeof(uint64_t));
+	for (int i = 0; i < pass.stride; i++)
+		pass.precomputed_masks[i] = get_mask_for_bucket(map, i);
+	pass.orders = (ShowdownOrder**)calloc(ORDER_SLOTS, sizeof(ShowdownOrder*));
+
+	float* root_util[2] = {
+		(float*)malloc(num_buckets * sizeof(float)),
+		(float*)malloc(num_buckets * sizeof(float))
+	};
+	walk_report(root, initial_state, &pass, p1_starting_range, p2_starting_range, root_util);
+
+	for (int i = 0; i < ORDER_SLOTS; i++)
+		free(pass.orders[i]);
+	free(pass.orders);
+	free(pass.precomputed_masks);
+	free(root_util[0]);
+	free(root_util[1]);
+}
+
+//heap calc_node_values holds at its peak: the values rows, which stay until free_node_values, and its board orders
+size_t node_values_bytes(const TreeStats* stats, const IsoMap* map, int num_buckets) {
+	size_t orders = (stats->showdown_nodes < ORDER_SLOTS) ? stats->showdown_nodes : ORDER_SLOTS;
+	return (size_t)stats->action_nodes * 4 * num_buckets * sizeof(float) + orders * sizeof(ShowdownOrder) +
+		ORDER_SLOTS * sizeof(ShowdownOrder*) + map->padded_buckets * sizeof(uint64_t) + 2 * num_buckets * sizeof(float);
+}
+
+void free_node_values(PublicNode* node) {
+	free(node->values);
+	node->values = NULL;
+	if (node->type == NODE_TERMINAL || node->type == NODE_LEAF)
+		return;
+	for (int i = 0; i < node->num_children; i++)
+		free_node_values(node->children[i]);
 }
 
 void do_cfr_iteration(PublicNode* root, GameState initial_state, IsoMap* map, int num_buckets, float* p1_starting_range, float* p2_starting_range) {
 	float* p1_reach  = (float*)malloc(num_buckets * sizeof(float));
 	float* p2_reach  = (float*)malloc(num_buckets * sizeof(float));
 	float* root_util = (float*)malloc(num_buckets * sizeof(float));
-	uint64_t* precomputed_masks = (uint64_t*)malloc(num_buckets * sizeof(uint64_t));
+	uint64_t* precomputed_masks = (uint64_t*)malloc(map->padded_buckets * sizeof(uint64_t));
 
 	for (int i = 0; i < num_buckets; i++) {
 		p1_reach[i] = p1_starting_range[i];
 		p2_reach[i] = p2_starting_range[i];
 		root_util[i] = 0.0f;
-		precomputed_masks[i] = get_mask_for_bucket(map, i);
 	}
+	for (int i = 0; i < map->padded_buckets; i++)
+		precomputed_masks[i] = get_mask_for_bucket(map, i);
 
 	walk_tree(root, initial_state, map, num_buckets, p1_reach, p2_reach, root_util, precomputed_masks);
 
@@ -4,9 +4,26 @@
 #include "tree.h"
 #include "indexer.h"
 
+/*
+ * num_buckets is map->padded_buckets, or K times that to solve K range
+ * variants of the same tree in one walk: the reach, regret and strategy
+ * rows then hold K blocks of padded_buckets back to back (a * num_buckets
+ * + k * padded_buckets + b), each an independent game sharing the tree
+ * walk, the showdown scores and the SIMD loops. Build the tree with the
+ * same num_buckets.
+ */
 void do_cfr_iteration(PublicNode* root, GameState initial_state, IsoMap* map, int num_buckets, float* p1_starting_range, float* p2_starting_range);
 
+float calc_exploitability(PublicNode* root, GameState initial_state, IsoMap* map, int num_buckets, float* p1_starting_range, float* p2_starting_range);
+void calc_exploitability_variants(PublicNode* root, GameState initial_state, IsoMap* map, int num_buckets, float* p1_starting_range, float* p2_starting_range, float* out);
+
+void calc_node_values(PublicNode* root, GameState initial_state, IsoMap* map, int num_buckets, float* p1_starting_range, float* p2_starting_range);
+void free_node_values(PublicNode* root);
+size_t node_values_bytes(const TreeStats* stats, const IsoMap* map, int num_buckets);
+
 void discount_tree(PublicNode* node, int num_buckets, int t, float alpha, float beta, float gamma);
 
+void calc_average_strategy(float* strategy_sum, float* avg_strategy, int num_actions, int num_buckets);
+
 void extract_action_range(PublicNode* node, int num_buckets, int action_idx, float* current_reach, float* out_new_reach);
 #endif //CFR_H
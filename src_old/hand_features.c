@@ -0,0 +1,155 @@
+#include "hand_features.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+int hand_features_load(const char* path, HandFeatures* out) {
+	int fd = open(path, O_RDONLY);
+	if (fd < 0)
+		return 0;
+
+	struct stat st;
+	if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(HandFeaturesHeader)) {
+		close(fd);
+		return 0;
+	}
+
+	size_t size = (size_t)st.st_size;
+	void* map = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (map == MAP_FAILED)
+		return 0;
+
+	const HandFeaturesHeader* header = (const HandFeaturesHeader*)map;
+	size_t expected = sizeof(HandFeaturesHeader) + header->num_boards * sizeof(HandFeaturesBoard) +
+		(size_t)header->num_rows * HF_NUM_FEATURES * sizeof(uint16_t);
+	if (header->magic != HAND_FEATURES_MAGIC || header->num_features != HF_NUM_FEATURES || size != expected) {
+		munmap(map, size);
+		return 0;
+	}
+
+	out->map = map;
+	out->map_size = size;
+	out->range_hash = header->range_hash;
+	out->num_boards = header->num_boards;
+	out->boards = (const HandFeaturesBoard*)(header + 1);
+	out->rows = (const uint16_t*)(out->boards + header->num_boards);
+	return 1;
+}
+
+void hand_features_free(HandFeatures* hf) {
+	if (hf->map)
+		munmap(hf->map, hf->map_size);
+	hf->map = NULL;
+	hf->boards = NULL;
+	hf->rows = NULL;
+}
+
+uint64_t hand_features_range_hash(const char* range) {
+	if (!range || !*range)
+		return 0;
+
+	uint64_t h = 0xcbf29ce484222325ull;
+	for (; *range; range++) {
+		h ^= (unsigned char)*range;
+		h *= 0x100000001b3ull;
+	}
+	return h;
+}
+
+static uint64_t permute_board(uint64_t board, const int perm[4]) {
+	uint64_t out = 0;
+	for (int s = 0; s < 4; s++)
+		out |= ((board >> (s * 16)) & 0x1FFF) << (perm[s] * 16);
+	return out;
+}
+
+/*
+ * Smallest image of the board over all suit permutations. suit_perm gets
+ * the permutation that maps the board's suits onto the canonical ones.
+ */
+uint64_t canonical_board(uint64_t board, int suit_perm[4]) {
+	int perm[4] = {0, 1, 2, 3};
+	uint64_t best = ~0ull;
+
+	for (int i = 0; i < 24; i++) {
+		uint64_t image = permute_board(board, perm);
+		if (image < best) {
+			best = image;
+			if (suit_perm)
+				for (int s = 0; s < 4; s++)
+					suit_perm[s] = perm[s];
+		}
+
+		//next permutation in lexicographic order
+		int k = 2;
+		while (k >= 0 && perm[k] > perm[k + 1])
+			k--;
+		if (k < 0)
+			break;
+		int l = 3;
+		while (perm[l] < perm[k])
+			l--;
+		int t = perm[k]; perm[k] = perm[l]; perm[l] = t;
+		for (int a = k + 1, b = 3; a < b; a++, b--) {
+			t = perm[a]; perm[a] = perm[b]; perm[b] = t;
+		}
+	}
+	return best;
+}
+
+const HandFeaturesBoard* hand_features_find(const HandFeatures* hf, uint64_t canonical) {
+	uint32_t lo = 0, hi = hf->num_boards;
+	while (lo < hi) {
+		uint32_t mid = (lo + hi) / 2;
+		if (hf->boards[mid].board < canonical)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	return (lo < hf->num_boards && hf->boards[lo].board == canonical) ? &hf->boards[lo] : NULL;
+}
+
+/*
+ * Expands the features of any flop or turn to the buckets of map (built
+ * for that same board), structure of arrays: out[feature * padded_buckets
+ * + bucket]. Each combo is carried over to the canonical board by the suit
+ * permutation, which keeps its bucket identity, and its features as the
+ * generator's range is suit symmetric. Returns 0 if the board isn't in the
+ * table.
+ */
+int hand_features_fill(const HandFeatures* hf, uint64_t board, const IsoMap* map, float* out) {
+	int perm[4];
+	const HandFeaturesBoard* b = hand_features_find(hf, canonical_board(board, perm));
+	if (!b)
+		return 0;
+
+	IsoMap canonical_map;
+	build_isomorphism_map(b->board, &canonical_map);
+
+	for (int i = 0; i < HF_NUM_FEATURES * map->padded_buckets; i++)
+		out[i] = 0.0f;
+
+	int combo = 0;
+	for (int c1 = 0; c1 < 51; c1++) {
+		for (int c2 = c1 + 1; c2 < 52; c2++, combo++) {
+			int bucket = map->combo_to_bucket[combo];
+			if (bucket < 0)
+				continue;
+
+			int p1 = perm[c1 / 13] * 13 + c1 % 13;
+			int p2 = perm[c2 / 13] * 13 + c2 % 13;
+			if (p1 > p2) {
+				int t = p1; p1 = p2; p2 = t;
+			}
+			int image = p1 * (103 - p1) / 2 + (p2 - p1 - 1);
+
+			const uint16_t* row = hand_features_row(hf, b, canonical_map.combo_to_bucket[image]);
+			for (int f = 0; f < HF_NUM_FEATURES; f++)
+				out[f * map->padded_buckets + bucket] = row[f] * (1.0f / 65535.0f);
+		}
+	}
+	return 1;
+}
@@ -0,0 +1,77 @@
+#ifndef HAND_FEATURES_H
+#define HAND_FEATURES_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "indexer.h"
+
+/*
+ * Hand strength features of every isomorphic combo on every canonical flop
+ * and turn, written by hand_features_gen and mapped read-only.
+ *
+ * Boards are stored once per suit permutation class, as the smallest mask
+ * (rank + suit * 16 layout) over the 24 permutations, sorted. Each board
+ * has one row per bucket of build_isomorphism_map(board), every feature a
+ * 16 bit fixed point value (65535 = 1.0).
+ */
+#define HAND_FEATURES_MAGIC 0x46484654    // "TFHF"
+
+enum {
+	HF_HS,      //equity vs the range if no more cards came
+	HF_EHS,     //equity vs the range after all runouts
+	HF_EHS2,    //mean of the squared river equity over the runouts
+	HF_PPOT,    //chance to end up ahead when behind now (Billings et al.)
+	HF_NPOT,    //chance to end up behind when ahead now
+	HF_NUM_FEATURES
+};
+
+/*
+ * file: header, then num_boards HandFeaturesBoard entries, then num_rows
+ * rows of HF_NUM_FEATURES uint16 values
+ */
+typedef struct {
+	uint32_t magic;
+	uint32_t num_boards;
+	uint32_t num_rows;
+	uint32_t num_features;
+	uint64_t range_hash;    //FNV-1a of the opponent range text, 0 for the uniform range
+} HandFeaturesHeader;
+
+typedef struct {
+	uint64_t board;
+	uint32_t first_row;
+	uint32_t num_buckets;
+} HandFeaturesBoard;
+
+typedef struct {
+	void* map;
+	size_t map_size;
+	uint64_t range_hash;
+	uint32_t num_boards;
+	const HandFeaturesBoard* boards;
+	const uint16_t* rows;
+} HandFeatures;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+int hand_features_load(const char* path, HandFeatures* out);
+void hand_features_free(HandFeatures* hf);
+
+uint64_t hand_features_range_hash(const char* range);
+uint64_t canonical_board(uint64_t board, int suit_perm[4]);
+const HandFeaturesBoard* hand_features_find(const HandFeatures* hf, uint64_t canonical);
+int hand_features_fill(const HandFeatures* hf, uint64_t board, const IsoMap* map, float* out);
+
+#ifdef __cplusplus
+}
+#endif
+
+//features of a bucket of the canonical board, HF_NUM_FEATURES values
+static inline const uint16_t* hand_features_row(const HandFeatures* hf, const HandFeaturesBoard* b, int bucket) {
+	return hf->rows + (size_t)(b->first_row + bucket) * HF_NUM_FEATURES;
+}
+
+#endif //HAND_FEATURES_H
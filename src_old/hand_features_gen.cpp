@@ -0,0 +1,400 @@
+/*
+ * ./hand_features_gen [out_file] [threads] [range]
+ *
+ * Computes HS, EHS, EHS^2 and the Billings positive/negative potentials of
+ * every isomorphic combo on every canonical flop and turn, against a
+ * uniform opponent range or a weighted one (JSON file, pack.bin:name or an
+ * omp::CardRange expression, see range_loader.h), and writes the table
+ * hand_features.h maps.
+ * Everything is exact enumeration. Features are computed once per bucket
+ * and board class, so the range has to give every suit permutation of a
+ * combo the same weight, others are refused.
+ *
+ * On each runout the opponent combos are ranked once with omp's evaluator
+ * and sorted by river rank. A Fenwick tree over the current (flop or turn)
+ * rank then gives every combo its 3x3 table of now/final ahead, tied and
+ * behind weights against the whole range in O(log n), and card removal is
+ * fixed by walking the ~100 opponent combos that share a card with it.
+ */
+#include "hand_features.h"
+#include "omp/HandEvaluator.h"
+#include "range_loader.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+#include <vector>
+#include <array>
+#include <atomic>
+#include <thread>
+#include <algorithm>
+
+enum { AHEAD, TIED, BEHIND };
+
+static omp::HandEvaluator eval;
+
+struct Combo {
+	int c1, c2;    //indexer.c cards, suit * 13 + rank
+	uint64_t mask;
+	omp::Hand hand;
+};
+
+static std::array<Combo, 1326> combos;
+static std::vector<int> combos_with_card[52];
+
+static uint64_t card_mask(int card) {
+	return 1ull << (card % 13 + (card / 13) * 16);
+}
+
+//indexer.c card (suit * 13 + rank) to omp card (rank * 4 + suit)
+static unsigned omp_card(int card) {
+	return (unsigned)((card % 13) * 4 + card / 13);
+}
+
+//adds cards to h, which must already contain Hand::empty() exactly once
+static omp::Hand add_cards(omp::Hand h, uint64_t board) {
+	for (int c = 0; c < 52; c++)
+		if (board & card_mask(c))
+			h += omp::Hand(omp_card(c));
+	return h;
+}
+
+static void init_combos() {
+	int combo = 0;
+	for (int c1 = 0; c1 < 51; c1++) {
+		for (int c2 = c1 + 1; c2 < 52; c2++, combo++) {
+			combos[combo] = { c1, c2, card_mask(c1) | card_mask(c2),
+			                  omp::Hand(omp_card(c1)) + omp::Hand(omp_card(c2)) };
+			combos_with_card[c1].push_back(combo);
+			combos_with_card[c2].push_back(combo);
+		}
+	}
+}
+
+//weights over the current rank index, prefix sums in O(log n)
+struct Fenwick {
+	std::vector<double> tree;
+
+	void reset(size_t n) {
+		tree.assign(n + 1, 0.0);
+	}
+
+	void add(int i, double w) {
+		for (i++; i < (int)tree.size(); i += i & -i)
+			tree[i] += w;
+	}
+
+	//sum of indexes < i
+	double prefix(int i) const {
+		double s = 0.0;
+		for (; i > 0; i -= i & -i)
+			s += tree[i];
+		return s;
+	}
+};
+
+struct BucketStats {
+	double hp[3][3];    //[now][final] opponent weight
+	double ehs2;        //sum over runouts of total * river equity^2
+};
+
+struct Opponent {
+	int combo;
+	int river_rank;
+};
+
+/*
+ * Features of every bucket of a canonical board, HF_NUM_FEATURES uint16
+ * values per bucket. opp_weights is in indexer combo order.
+ */
+static void compute_board(uint64_t board, const IsoMap& map, const std::vector<double>& opp_weights,
+                          uint16_t* out) {
+	int nbuckets = map.num_unique_buckets;
+	std::vector<int> reps(nbuckets, -1);
+	for (int i = 0; i < 1326; i++)
+		if (map.combo_to_bucket[i] >= 0 && reps[map.combo_to_bucket[i]] < 0)
+			reps[map.combo_to_bucket[i]] = i;
+
+	//current ranks, compressed so the Fenwick trees stay small
+	omp::Hand board_h = add_cards(omp::Hand::empty(), board);
+	std::vector<int> now_rank(1326, -1);
+	std::vector<int> distinct;
+	for (int i = 0; i < 1326; i++) {
+		if (combos[i].mask & board)
+			continue;
+		now_rank[i] = eval.evaluate(board_h + combos[i].hand);
+		distinct.push_back(now_rank[i]);
+	}
+	std::sort(distinct.begin(), distinct.end());
+	distinct.erase(std::unique(distinct.begin(), distinct.end()), distinct.end());
+	for (int& r : now_rank)
+		if (r >= 0)
+			r = (int)(std::lower_bound(distinct.begin(), distinct.end(), r) - distinct.begin());
+	int nranks = (int)distinct.size();
+
+	std::vector<uint64_t> runouts;
+	int board_cards = __builtin_popcountll(board);
+	for (int c1 = 0; c1 < 52; c1++) {
+		if (board & card_mask(c1))
+			continue;
+		if (board_cards == 4) {
+			runouts.push_back(card_mask(c1));
+			continue;
+		}
+		for (int c2 = c1 + 1; c2 < 52; c2++)
+			if (!(board & card_mask(c2)))
+				runouts.push_back(card_mask(c1) | card_mask(c2));
+	}
+
+	std::vector<BucketStats> stats(nbuckets);
+	memset(stats.data(), 0, stats.size() * sizeof(BucketStats));
+
+	std::vector<int> river_rank(1326);
+	std::vector<Opponent> opps;
+	std::vector<int> own;
+	std::vector<double> all_by_rank(nranks + 1);
+	Fenwick lower, equal;
+
+	for (uint64_t runout : runouts) {
+		uint64_t full = board | runout;
+		omp::Hand full_h = add_cards(board_h, runout);
+
+		opps.clear();
+		std::fill(all_by_rank.begin(), all_by_rank.end(), 0.0);
+		for (int i = 0; i < 1326; i++) {
+			if (combos[i].mask & full) {
+				river_rank[i] = -1;
+				continue;
+			}
+			river_rank[i] = eval.evaluate(full_h + combos[i].hand);
+			if (opp_weights[i] > 0.0) {
+				opps.push_back({ i, river_rank[i] });
+				all_by_rank[now_rank[i] + 1] += opp_weights[i];
+			}
+		}
+		//prefix sums, all_by_rank[r] = weight of opponents with current rank < r
+		for (int r = 0; r < nranks; r++)
+			all_by_rank[r + 1] += all_by_rank[r];
+		std::sort(opps.begin(), opps.end(), [](const Opponent& a, const Opponent& b) {
+			return a.river_rank < b.river_rank;
+		});
+
+		own.clear();
+		for (int b = 0; b < nbuckets; b++)
+			if (river_rank[reps[b]] >= 0)
+				own.push_back(b);
+		std::sort(own.begin(), own.end(), [&](int a, int b) {
+			return river_rank[reps[a]] < river_rank[reps[b]];
+		});
+
+		lower.reset(nranks);
+		equal.reset(nranks);
+		double lower_total = 0.0, equal_total = 0.0;
+		size_t lower_end = 0, equal_end = 0;
+		int equal_rank = -1;
+
+		for (int b : own) {
+			int h = reps[b];
+			int rr = river_rank[h];
+			int nr = now_rank[h];
+
+			if (rr != equal_rank) {
+				for (size_t j = lower_end; j < equal_end; j++)
+					equal.add(now_rank[opps[j].combo], -opp_weights[opps[j].combo]);
+				equal_total = 0.0;
+				while (lower_end < opps.size() && opps[lower_end].river_rank < rr) {
+					int o = opps[lower_end++].combo;
+					lower.add(now_rank[o], opp_weights[o]);
+					lower_total += opp_weights[o];
+				}
+				for (equal_end = lower_end; equal_end < opps.size() && opps[equal_end].river_rank == rr; equal_end++) {
+					int o = opps[equal_end].combo;
+					equal.add(now_rank[o], opp_weights[o]);
+					equal_total += opp_weights[o];
+				}
+				equal_rank = rr;
+			}
+
+			//opponent below us now means we're ahead now
+			double hp[3][3];
+			double lt = lower.prefix(nr), le = lower.prefix(nr + 1);
+			hp[AHEAD][AHEAD] = lt;
+			hp[TIED][AHEAD] = le - lt;
+			hp[BEHIND][AHEAD] = lower_total - le;
+			lt = equal.prefix(nr);
+			le = equal.prefix(nr + 1);
+			hp[AHEAD][TIED] = lt;
+			hp[TIED][TIED] = le - lt;
+			hp[BEHIND][TIED] = equal_total - le;
+			hp[AHEAD][BEHIND] = all_by_rank[nr] - hp[AHEAD][AHEAD] - hp[AHEAD][TIED];
+			hp[TIED][BEHIND] = all_by_rank[nr + 1] - all_by_rank[nr] - hp[TIED][AHEAD] - hp[TIED][TIED];
+			hp[BEHIND][BEHIND] = all_by_rank[nranks] - all_by_rank[nr + 1] - hp[BEHIND][AHEAD] - hp[BEHIND][TIED];
+
+			//card removal, the identical combo is in both lists but removed once
+			int c1 = combos[h].c1, c2 = combos[h].c2;
+			for (int pass = 0; pass < 2; pass++) {
+				for (int o : combos_with_card[pass ? c2 : c1]) {
+					if (river_rank[o] < 0 || opp_weights[o] <= 0.0)
+						continue;
+					if (pass && (combos[o].c1 == c1 || combos[o].c2 == c1))
+						continue;
+					int now = now_rank[o] < nr ? AHEAD : now_rank[o] == nr ? TIED : BEHIND;
+					int fin = river_rank[o] < rr ? AHEAD : river_rank[o] == rr ? TIED : BEHIND;
+					hp[now][fin] -= opp_weights[o];
+				}
+			}
+
+			double total = 0.0, score = 0.0;
+			for (int now = 0; now < 3; now++) {
+				for (int fin = 0; fin < 3; fin++) {
+					stats[b].hp[now][fin] += hp[now][fin];
+					total += hp[now][fin];
+				}
+				score += hp[now][AHEAD] + 0.5 * hp[now][TIED];
+			}
+			if (total > 0.0)
+				stats[b].ehs2 += score * score / total;
+		}
+	}
+
+	auto fixed = [](double x) {
+		x = std::min(1.0, std::max(0.0, x));
+		return (uint16_t)std::lround(x * 65535.0);
+	};
+
+	for (int b = 0; b < nbuckets; b++) {
+		const double (*hp)[3] = stats[b].hp;
+		double row_total[3], total = 0.0, ehs = 0.0;
+		for (int now = 0; now < 3; now++) {
+			row_total[now] = hp[now][AHEAD] + hp[now][TIED] + hp[now][BEHIND];
+			total += row_total[now];
+			ehs += hp[now][AHEAD] + 0.5 * hp[now][TIED];
+		}
+		double hs = row_total[AHEAD] + 0.5 * row_total[TIED];
+		double ppot_den = row_total[BEHIND] + 0.5 * row_total[TIED];
+		double npot_den = row_total[AHEAD] + 0.5 * row_total[TIED];
+		double ppot = hp[BEHIND][AHEAD] + 0.5 * hp[BEHIND][TIED] + 0.5 * hp[TIED][AHEAD];
+		double npot = hp[AHEAD][BEHIND] + 0.5 * hp[TIED][BEHIND] + 0.5 * hp[AHEAD][TIED];
+
+		uint16_t* row = out + (size_t)b * HF_NUM_FEATURES;
+		row[HF_HS] = fixed(total > 0.0 ? hs / total : 0.0);
+		row[HF_EHS] = fixed(total > 0.0 ? ehs / total : 0.0);
+		row[HF_EHS2] = fixed(total > 0.0 ? stats[b].ehs2 / total : 0.0);
+		row[HF_PPOT] = fixed(ppot_den > 0.0 ? ppot / ppot_den : 0.0);
+		row[HF_NPOT] = fixed(npot_den > 0.0 ? npot / npot_den : 0.0);
+	}
+}
+
+//true if every suit permutation of every combo has the combo's weight
+static bool suit_symmetric(const std::vector<double>& weights) {
+	int perm[4] = { 0, 1, 2, 3 };
+	while (std::next_permutation(perm, perm + 4)) {
+		for (int i = 0; i < 1326; i++) {
+			int p1 = perm[combos[i].c1 / 13] * 13 + combos[i].c1 % 13;
+			int p2 = perm[combos[i].c2 / 13] * 13 + combos[i].c2 % 13;
+			if (p1 > p2)
+				std::swap(p1, p2);
+			int image = p1 * (103 - p1) / 2 + (p2 - p1 - 1);
+			if (std::fabs(weights[i] - weights[image]) > 1e-4)
+				return false;
+		}
+	}
+	return true;
+}
+
+static void add_canonical_boards(int cards, int first, uint64_t board, std::vector<uint64_t>& out) {
+	if (cards == 0) {
+		if (canonical_board(board, NULL) == board)
+			out.push_back(board);
+		return;
+	}
+	for (int c = first; c <= 52 - cards; c++)
+		add_canonical_boards(cards - 1, c + 1, board | card_mask(c), out);
+}
+
+int main(int argc, char** argv) {
+	const char* path = (argc > 1) ? argv[1] : "hand_features.bin";
+	unsigned num_threads = (argc > 2) ? (unsigned)atoi(argv[2]) : std::thread::hardware_concurrency();
+	const char* range = (argc > 3) ? argv[3] : NULL;
+	if (num_threads == 0)
+		num_threads = 1;
+
+	init_combos();
+
+	std::vector<double> opp_weights(1326, 1.0);
+	if (range) {
+		float w[RANGE_COMBOS] = {};
+		if (range_load(range, w) < 0 && range_parse_expression(range, 1.0f, w) <= 0) {
+			fprintf(stderr, "bad range %s\n", range);
+			return 1;
+		}
+		for (int i = 0; i < RANGE_COMBOS; i++)
+			opp_weights[i] = w[i];
+		if (!suit_symmetric(opp_weights)) {
+			fprintf(stderr, "range %s weights suit permutations of a combo differently, "
+			        "the table shares features across them\n", range);
+			return 1;
+		}
+	}
+
+	std::vector<uint64_t> boards;
+	add_canonical_boards(3, 0, 0, boards);
+	size_t num_flops = boards.size();
+	add_canonical_boards(4, 0, 0, boards);
+	std::sort(boards.begin(), boards.end());
+
+	std::vector<HandFeaturesBoard> index(boards.size());
+	std::vector<IsoMap> maps(boards.size());
+	uint32_t num_rows = 0;
+	for (size_t i = 0; i < boards.size(); i++) {
+		build_isomorphism_map(boards[i], &maps[i]);
+		index[i] = { boards[i], num_rows, (uint32_t)maps[i].num_unique_buckets };
+		num_rows += (uint32_t)maps[i].num_unique_buckets;
+	}
+	printf("%zu flops, %zu turns, %u rows, %u threads\n", num_flops, boards.size() - num_flops, num_rows,
+	       num_threads);
+
+	std::vector<uint16_t> rows((size_t)num_rows * HF_NUM_FEATURES);
+	std::atomic<size_t> next(0), done(0);
+	std::vector<std::thread> threads;
+
+	//flops first, they're the slow ones
+	std::vector<size_t> order(boards.size());
+	for (size_t i = 0; i < order.size(); i++)
+		order[i] = i;
+	std::stable_partition(order.begin(), order.end(), [&](size_t i) {
+		return __builtin_popcountll(boards[i]) == 3;
+	});
+
+	for (unsigned t = 0; t < num_threads; t++) {
+		threads.emplace_back([&] {
+			for (size_t k; (k = next++) < order.size();) {
+				size_t i = order[k];
+				compute_board(boards[i], maps[i], opp_weights, &rows[(size_t)index[i].first_row * HF_NUM_FEATURES]);
+
+				size_t n = ++done;
+				if (n % 1000 == 0)
+					printf("  %zu / %zu\n", n, boards.size());
+			}
+		});
+	}
+	for (auto& t : threads)
+		t.join();
+
+	FILE* f = fopen(path, "wb");
+	if (!f) {
+		printf("Couldn't open %s\n", path);
+		return 1;
+	}
+
+	HandFeaturesHeader header = { HAND_FEATURES_MAGIC, (uint32_t)boards.size(), num_rows, HF_NUM_FEATURES,
+	                              hand_features_range_hash(range) };
+	fwrite(&header, sizeof(header), 1, f);
+	fwrite(index.data(), sizeof(HandFeaturesBoard), index.size(), f);
+	fwrite(rows.data(), sizeof(uint16_t), rows.size(), f);
+	fclose(f);
+
+	printf("Wrote %s\n", path);
+	return 0;
+}
@@ -0,0 +1,276 @@
+#include "hand_grid.h"
+#include "cfr.h"
+#include "strategy_file.h"
+
+#include <math.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static uint8_t combo_cells[1326];
+static pthread_once_t combo_cells_once = PTHREAD_ONCE_INIT;
+
+//the combo's two cards are the same for every board, so the table is built once, by whichever thread gets there first
+static void build_combo_cells(void) {
+	int combo = 0;
+	for (int c1 = 0; c1 < 51; c1++) {
+		for (int c2 = c1 + 1; c2 < 52; c2++, combo++) {
+			int r1 = c1 % 13, s1 = c1 / 13;
+			int r2 = c2 % 13, s2 = c2 / 13;
+			int row = 12 - ((r1 > r2) ? r1 : r2);
+			int col = 12 - ((r1 < r2) ? r1 : r2);
+
+			if (s1 != s2 && r1 != r2) {
+				int t = row; row = col; col = t;    //offsuit below the diagonal
+			}
+			combo_cells[combo] = (uint8_t)(row * 13 + col);
+		}
+	}
+}
+
+int hand_grid_combo_cell(int combo) {
+	pthread_once(&combo_cells_once, build_combo_cells);
+	return combo_cells[combo];
+}
+
+void hand_grid_init(HandGrid* grid, const IsoMap* map) {
+	pthread_once(&combo_cells_once, build_combo_cells);
+
+	grid->num_buckets = map->num_unique_buckets;
+	memset(grid->bucket_combos, 0, sizeof(grid->bucket_combos));
+	memset(grid->cell_combos, 0, sizeof(grid->cell_combos));
+	for (int combo = 0; combo < 1326; combo++) {
+		int bucket = map->combo_to_bucket[combo];
+		if (bucket < 0)
+			continue;
+		grid->bucket_cell[bucket] = combo_cells[combo];
+		grid->bucket_combos[bucket] += 1.0f;
+		grid->cell_combos[combo_cells[combo]] += 1.0f;
+	}
+}
+
+/*
+ * out[r * GRID_CELLS + cell] += weights[b] * rows[r * stride + b] over the
+ * buckets of each cell, rows NULL for the weights alone. The products are
+ * one vector loop per row, the scatter a single sweep of the buckets.
+ */
+void hand_grid_scatter(const HandGrid* grid, const float* weights, const float* rows, int num_rows, int stride, float* out) {
+	float weighted[MAX_BUCKETS];
+	int num_buckets = grid->num_buckets;
+
+	for (int r = 0; r < num_rows; r++) {
+		const float* row = rows ? rows + (size_t)r * stride : weights;
+		float* cells = out + r * GRID_CELLS;
+		if (rows) {
+			#pragma omp simd
+			for (int b = 0; b < num_buckets; b++)
+				weighted[b] = weights[b] * row[b];
+			row = weighted;
+		}
+		for (int b = 0; b < num_buckets; b++)
+			cells[grid->bucket_cell[b]] += row[b];
+	}
+}
+
+/*
+ * Reach weighted average strategy per cell. reach is combo mass per bucket
+ * as range_to_buckets builds it, out_combos gets that mass per cell and
+ * out_freqs num_actions rows of frequencies, 0 in cells the range doesn't
+ * reach.
+ */
+void hand_grid_strategy(const HandGrid* grid, const float* strategy_sum, int num_actions, int stride, const float* reach,
+		float* out_combos, float* out_freqs) {
+	int num_buckets = grid->num_buckets;
+	float total[MAX_BUCKETS];
+	float* probs = (float*)malloc((size_t)num_actions * num_buckets * sizeof(float));
+
+	#pragma omp simd
+	for (int b = 0; b < num_buckets; b++)
+		total[b] = 0.0f;
+	for (int a = 0; a < num_actions; a++) {
+		#pragma omp simd
+		for (int b = 0; b < num_buckets; b++)
+			total[b] += strategy_sum[a * stride + b];
+	}
+	for (int a = 0; a < num_actions; a++) {
+		#pragma omp simd
+		for (int b = 0; b < num_buckets; b++)
+			probs[a * num_buckets + b] = (total[b] > 0.0f) ? strategy_sum[a * stride + b] / total[b] : 1.0f / num_actions;
+	}
+
+	memset(out_combos, 0, GRID_CELLS * sizeof(float));
+	memset(out_freqs, 0, (size_t)num_actions * GRID_CELLS * sizeof(float));
+	hand_grid_scatter(grid, reach, NULL, 1, 0, out_combos);
+	hand_grid_scatter(grid, reach, probs, num_actions, num_buckets, out_freqs);
+
+	for (int a = 0; a < num_actions; a++)
+		for (int c = 0; c < GRID_CELLS; c++)
+			out_freqs[a * GRID_CELLS + c] = (out_combos[c] > 0.0f) ? out_freqs[a * GRID_CELLS + c] / out_combos[c] : 0.0f;
+	free(probs);
+}
+
+//reach weighted mean of a bucket row (EV, equity) per cell, NAN where nothing reaches
+void hand_grid_values(const HandGrid* grid, const float* values, const float* reach, float* out) {
+	int num_buckets = grid->num_buckets;
+	float weights[MAX_BUCKETS], clean[MAX_BUCKETS];
+	float combos[GRID_CELLS] = {0};
+
+	//unreached buckets can carry NAN, which mustn't leak into their cell
+	#pragma omp simd
+	for (int b = 0; b < num_buckets; b++) {
+		int live = values[b] == values[b];
+		weights[b] = live ? reach[b] : 0.0f;
+		clean[b] = live ? values[b] : 0.0f;
+	}
+
+	memset(out, 0, GRID_CELLS * sizeof(float));
+	hand_grid_scatter(grid, weights, NULL, 1, 0, combos);
+	hand_grid_scatter(grid, weights, clean, 1, num_buckets, out);
+	for (int c = 0; c < GRID_CELLS; c++)
+		out[c] = (combos[c] > 0.0f) ? out[c] / combos[c] : NAN;
+}
+
+typedef struct {
+	FILE* f;
+	const IsoMap* map;
+	HandGrid grid;
+	int num_buckets;
+	float* combos;
+	float* freqs;
+	float* values;
+	int failed;
+} GridExport;
+
+static void write_row(FILE* f, const float* row, const char* format) {
+	fputc('[', f);
+	for (int c = 0; c < GRID_CELLS; c++) {
+		if (c)
+			fputc(',', f);
+		if (row[c] == row[c])
+			fprintf(f, format, row[c]);
+		else
+			fputs("null", f);
+	}
+	fputc(']', f);
+}
+
+static void write_node(GridExport* ex, PublicNode* node, GameState* state, const char* line, float* reach[2], const char** labels) {
+	FILE* f = ex->f;
+	int player = node->active_player;
+	int num_actions = node->num_children;
+
+	hand_grid_strategy(&ex->grid, node->strategy_sum, num_actions, ex->num_buckets, reach[player], ex->combos, ex->freqs);
+
+	fprintf(f, "{\"line\":\"%s\",\"player\":%d,\"pot\":%d,\"actions\":[", line, player + 1, state->pot);
+	for (int a = 0; a < num_actions; a++)
+		fprintf(f, a ? ",\"%s\"" : "\"%s\"", labels[a]);
+	fputs("],\"combos\":", f);
+	write_row(f, ex->combos, "%.4g");
+	fputs(",\"strategy\":[", f);
+	for (int a = 0; a < num_actions; a++) {
+		if (a)
+			fputc(',', f);
+		write_row(f, ex->freqs + a * GRID_CELLS, "%.4f");
+	}
+	fputc(']', f);
+
+	if (node->values) {
+		hand_grid_values(&ex->grid, node->values + player * ex->num_buckets, reach[player], ex->values);
+		fputs(",\"ev\":", f);
+		write_row(f, ex->values, "%.2f");
+		hand_grid_values(&ex->grid, node->values + (2 + player) * ex->num_buckets, reach[player], ex->values);
+		fputs(",\"equity\":", f);
+		write_row(f, ex->values, "%.4f");
+	}
+	fputs("}\n", f);
+	ex->failed |= ferror(f);
+}
+
+static void export_node(GridExport* ex, PublicNode* node, GameState state, char* line, int len, float* reach[2]) {
+	static const char ranks[] = "23456789TJQKA";
+	static const char suits[] = "shdc";
+
+	if (node->type == NODE_TERMINAL || node->type == NODE_LEAF || ex->failed)
+		return;
+
+	if (node->type == NODE_CHANCE) {
+		for (int i = 0; i < node->num_children; i++) {
+			int card = node->dealt_cards[i];
+			int child_len = len + snprintf(line + len, 8, len ? " %c%c" : "%c%c", ranks[card % 13], suits[card / 13]);
+			export_node(ex, node->children[i], apply_deal(state, card), line, child_len, reach);
+			line[len] = 0;
+		}
+		return;
+	}
+
+	int actions[STRATEGY_MAX_ACTIONS];
+	generate_bet_sizes(&state, actions);
+	int to_call = (state.active_player == 0) ? state.p2_commit - state.p1_commit : state.p1_commit - state.p2_commit;
+	char tokens[STRATEGY_MAX_ACTIONS][16];
+	const char* labels[STRATEGY_MAX_ACTIONS];
+	for (int a = 0; a < node->num_children; a++) {
+		if (actions[a] == -1)
+			snprintf(tokens[a], 16, "f");
+		else if (actions[a] == 0)
+			snprintf(tokens[a], 16, to_call > 0 ? "c" : "x");
+		else
+			snprintf(tokens[a], 16, "%c%d", to_call > 0 ? 'r' : 'b', actions[a]);
+		labels[a] = tokens[a];
+	}
+	write_node(ex, node, &state, line, reach, labels);
+
+	int player = node->active_player;
+	float* next_reach = (float*)malloc(ex->num_buckets * sizeof(float));
+	float* child_reach[2] = { reach[0], reach[1] };
+	child_reach[player] = next_reach;
+	for (int a = 0; a < node->num_children; a++) {
+		extract_action_range(node, ex->num_buckets, a, reach[player], next_reach);
+		int child_len = len + snprintf(line + len, 24, len ? " %s" : "%s", tokens[a]);
+		export_node(ex, node->children[a], apply_bet(state, actions[a]), line, child_len, child_reach);
+		line[len] = 0;
+	}
+	free(next_reach);
+}
+
+/*
+ * Writes the grids of every action node of a solved tree as JSON lines,
+ * in the depth first order of strategy files, for the player to act:
+ * {"line", "player", "pot", "actions", "combos", "strategy", "ev", "equity"}
+ * with 169 cells per row. "combos" is the player's reach weighted combos,
+ * "ev" / "equity" are there when calc_node_values has run. Returns 0 if
+ * the file couldn't be written.
+ */
+int hand_grid_export(const char* path, PublicNode* root, GameState root_state, const IsoMap* map,
+		const float* p1_range, const float* p2_range) {
+	GridExport ex;
+	ex.f = fopen(path, "w");
+	if (!ex.f)
+		return 0;
+	ex.map = map;
+	ex.num_buckets = map->padded_buckets;
+	ex.failed = 0;
+	ex.combos = (float*)malloc(GRID_CELLS * sizeof(float));
+	ex.freqs = (float*)malloc(STRATEGY_MAX_ACTIONS * GRID_CELLS * sizeof(float));
+	ex.values = (float*)malloc(GRID_CELLS * sizeof(float));
+	hand_grid_init(&ex.grid, map);
+
+	float* reach[2] = {
+		(float*)malloc(ex.num_buckets * sizeof(float)),
+		(float*)malloc(ex.num_buckets * sizeof(float))
+	};
+	memcpy(reach[0], p1_range, ex.num_buckets * sizeof(float));
+	memcpy(reach[1], p2_range, ex.num_buckets * sizeof(float));
+
+	char line[1024] = {0};
+	export_node(&ex, root, root_state, line, 0, reach);
+
+	int ok = !ex.failed;
+	ok = (fclose(ex.f) == 0) && ok;
+	free(ex.combos);
+	free(ex.freqs);
+	free(ex.values);
+	free(reach[0]);
+	free(reach[1]);
+	return ok;
+}
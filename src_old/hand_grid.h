@@ -0,0 +1,37 @@
+#ifndef HAND_GRID_H
+#define HAND_GRID_H
+
+#include <stdint.h>
+
+#include "tree.h"
+#include "indexer.h"
+
+/*
+ * 13x13 hand class grids built from bucket arrays in one pass.
+ *
+ * Cells are row * 13 + col, ace first, rangefinder layout: pairs on the
+ * diagonal, suited hands above it, offsuit below. Every bucket of an
+ * IsoMap is a suit permutation class, so all its combos share one cell,
+ * and a HandGrid only has to scatter buckets, not combos.
+ */
+#define GRID_CELLS 169
+
+typedef struct {
+	int num_buckets;                      //map->num_unique_buckets
+	uint8_t bucket_cell[MAX_BUCKETS];
+	float bucket_combos[MAX_BUCKETS];     //live combos in the bucket
+	float cell_combos[GRID_CELLS];        //live combos in the cell
+} HandGrid;
+
+int hand_grid_combo_cell(int combo);
+void hand_grid_init(HandGrid* grid, const IsoMap* map);
+
+void hand_grid_scatter(const HandGrid* grid, const float* weights, const float* rows, int num_rows, int stride, float* out);
+void hand_grid_strategy(const HandGrid* grid, const float* strategy_sum, int num_actions, int stride, const float* reach,
+	float* out_combos, float* out_freqs);
+void hand_grid_values(const HandGrid* grid, const float* values, const float* reach, float* out);
+
+int hand_grid_export(const char* path, PublicNode* root, GameState root_state, const IsoMap* map,
+	const float* p1_range, const float* p2_range);
+
+#endif //HAND_GRID_H
@@ -12,6 +12,14 @@ typedef struct {
     int padded_buckets;        
 } IsoMap;
 
+#ifdef __cplusplus
+extern "C" {
+#endif
+
 void build_isomorphism_map(uint64_t board_mask, IsoMap* out_map);
 
+#ifdef __cplusplus
+}
+#endif
+
 #endif // INDEXER_H
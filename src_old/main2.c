@@ -4,14 +4,14 @@
 #include "cfr.h"
 #include "ex.h"
 #include "parse.h"
+#include "range_loader.h"
+#include "strategy_export.h"
+#include "hand_grid.h"
 #include <time.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
-// --- DECLARE THE EXPLOITABILITY FUNCTION ---
-float calc_exploitability(PublicNode* root, GameState initial_state, IsoMap* map, int num_buckets, float* p1_starting_range, float* p2_starting_range);
-
 // Helper function to traverse the tree and count the total nodes
 size_t count_nodes(PublicNode* node) {
     if (node == NULL) return 0;
@@ -23,38 +23,7 @@ size_t count_nodes(PublicNode* node) {
     return total;
 }
 
-// Translates a raw PlayerRange (masks) into a bucketed reach probability array for the solver
-void convert_range_to_buckets(PlayerRange* range, IsoMap* map, float* out_reach_array) {
-    for (int i = 0; i < map->padded_buckets; i++) {
-        out_reach_array[i] = 0.0f;
-    }
-
-    for (int combo = 0; combo < 1326; combo++) {
-        int target_bucket = map->combo_to_bucket[combo];
-        if (target_bucket == -1) continue;
-
-        int c1 = 0, c2 = 0, counter = 0;
-        for (int i = 0; i < 51; i++) {
-            for (int j = i + 1; j < 52; j++) {
-                if (counter == combo) { c1 = i; c2 = j; break; }
-                counter++;
-            }
-            if (c1 || c2) break;
-        }
-        int r1 = c1 % 13; int s1 = c1 / 13;
-        int r2 = c2 % 13; int s2 = c2 / 13;
-        uint64_t combo_mask = (1ULL << (r1 + (s1 * 16))) | (1ULL << (r2 + (s2 * 16)));
-
-        for (int i = 0; i < range->num_combos; i++) {
-            if (range->combos[i].mask == combo_mask) {
-                out_reach_array[target_bucket] += range->combos[i].weight;
-                break;
-            }
-        }
-    }
-}
-
-// Aggregates strategy into a 13x13 grid, filtering out folded hands and dynamically coloring actions
+// Reach weighted strategy in a 13x13 grid (hand_grid.h), dominant action per hand class, colored by action
 void print_root_strategy(PublicNode* root, GameState state, IsoMap* map, int num_buckets, float* current_reach) {
     int legal_actions[8];
     int num_actions = generate_bet_sizes(&state, legal_actions);
@@ -82,48 +51,10 @@ void print_root_strategy(PublicNode* root, GameState state, IsoMap* map, int num
     }
     printf("\b\b  \n\n"); 
 
-    float grid_probs[13][13][8] = {0}; 
-    int grid_counts[13][13] = {0};
-
-    for (int combo = 0; combo < 1326; combo++) {
-        int bucket = map->combo_to_bucket[combo];
-        if (bucket == -1) continue; 
-        if (current_reach[bucket] < 0.0001f) continue; 
-
-        float sum = 0.0f;
-        for (int a = 0; a < num_actions; a++) {
-            sum += root->strategy_sum[(a * num_buckets) + bucket];
-        }
-        if (sum == 0.0f) continue; 
-
-        int c1 = 0, c2 = 0, counter = 0;
-        for (int i = 0; i < 51; i++) {
-            for (int j = i + 1; j < 52; j++) {
-                if (counter == combo) { c1 = i; c2 = j; break; }
-                counter++;
-            }
-            if (c1 || c2) break;
-        }
-
-        int r1 = (c1 % 13); int s1 = (c1 / 13);
-        int r2 = (c2 % 13); int s2 = (c2 / 13);
-        int rank_high = (r1 > r2) ? r1 : r2;
-        int rank_low  = (r1 < r2) ? r1 : r2;
-
-        int row = 12 - rank_high; 
-        int col = 12 - rank_low;
-
-        int grid_r, grid_c;
-        if (s1 == s2) { grid_r = row; grid_c = col; }        
-        else if (r1 == r2) { grid_r = row; grid_c = col; }   
-        else { grid_r = col; grid_c = row; }                 
-
-        grid_counts[grid_r][grid_c]++;
-        for (int a = 0; a < num_actions; a++) {
-            float prob = root->strategy_sum[(a * num_buckets) + bucket] / sum;
-            grid_probs[grid_r][grid_c][a] += prob;
-        }
-    }
+    HandGrid grid;
+    float cell_combos[GRID_CELLS], cell_freqs[8 * GRID_CELLS];
+    hand_grid_init(&grid, map);
+    hand_grid_strategy(&grid, root->strategy_sum, num_actions, num_buckets, current_reach, cell_combos, cell_freqs);
 
     const char rank_chars[] = "AKQJT98765432";
     printf("    ");
@@ -133,13 +64,14 @@ void print_root_strategy(PublicNode* root, GameState state, IsoMap* map, int num
     for (int r = 0; r < 13; r++) {
         printf("%c | ", rank_chars[r]);
         for (int c = 0; c < 13; c++) {
-            if (grid_counts[r][c] == 0) {
+            int cell = r * 13 + c;
+            if (cell_combos[cell] < 0.0001f) {
                 printf("  -  ");
             } else {
                 int dom_a = 0;
                 float max_p = -1.0f;
                 for (int a = 0; a < num_actions; a++) {
-                    float avg_p = grid_probs[r][c][a] / (float)grid_counts[r][c];
+                    float avg_p = cell_freqs[a * GRID_CELLS + cell];
                     if (avg_p > max_p) {
                         max_p = avg_p;
                         dom_a = a;
@@ -159,38 +91,10 @@ void print_root_strategy(PublicNode* root, GameState state, IsoMap* map, int num
 void print_live_reach_grid(float* reach, IsoMap* map) {
     printf("\n--- PLAYER RANGE GRID (Hand Frequencies) ---\n");
 
-    float grid_weights[13][13] = {0};
-    int grid_counts[13][13] = {0};
-
-    for (int combo = 0; combo < 1326; combo++) {
-        int bucket = map->combo_to_bucket[combo];
-        if (bucket == -1) continue; 
-
-        int c1 = 0, c2 = 0, counter = 0;
-        for (int i = 0; i < 51; i++) {
-            for (int j = i + 1; j < 52; j++) {
-                if (counter == combo) { c1 = i; c2 = j; break; }
-                counter++;
-            }
-            if (c1 || c2) break;
-        }
-
-        int r1 = (c1 % 13); int s1 = (c1 / 13);
-        int r2 = (c2 % 13); int s2 = (c2 / 13);
-        int rank_high = (r1 > r2) ? r1 : r2;
-        int rank_low  = (r1 < r2) ? r1 : r2;
-
-        int row = 12 - rank_high; 
-        int col = 12 - rank_low;
-
-        int grid_r, grid_c;
-        if (s1 == s2) { grid_r = row; grid_c = col; }        
-        else if (r1 == r2) { grid_r = row; grid_c = col; }   
-        else { grid_r = col; grid_c = row; }                 
-
-        grid_weights[grid_r][grid_c] += reach[bucket];
-        grid_counts[grid_r][grid_c]++;
-    }
+    HandGrid grid;
+    float grid_weights[GRID_CELLS] = {0};
+    hand_grid_init(&grid, map);
+    hand_grid_scatter(&grid, reach, NULL, 1, 0, grid_weights);
 
     const char rank_chars[] = "AKQJT98765432";
     printf("    ");
@@ -200,10 +104,11 @@ void print_live_reach_grid(float* reach, IsoMap* map) {
     for (int r = 0; r < 13; r++) {
         printf("%c | ", rank_chars[r]);
         for (int c = 0; c < 13; c++) {
-            if (grid_counts[r][c] == 0) {
+            int cell = r * 13 + c;
+            if (grid.cell_combos[cell] == 0.0f) {
                 printf("  -  ");
             } else {
-                float avg_weight = grid_weights[r][c] / (float)grid_counts[r][c];
+                float avg_weight = grid_weights[cell] / grid.cell_combos[cell];
                 if (avg_weight < 0.005f) {
                      printf("  -  ");
                 } else {
@@ -233,7 +138,10 @@ int main(int argc, char** argv) {
 
     if (argc < 5) {
         printf("ERROR: Missing arguments.\n");
-        printf("Usage:   ./turbofire \"<board>\" <pot> <p1_stack> <p2_stack>\n");
+        printf("Usage:   ./turbofire \"<board>\" <pot> <p1_stack> <p2_stack> [p1_range] [p2_range] [strategy_out] [8|16] [grid_out]\n");
+        printf("Ranges are rangefinder JSON files or pack.bin:name, '-' for the built-in SB/BTN ranges.\n");
+        printf("strategy_out gets the flop solution and node EVs for strategy_file.h, quantized to 8 (default) or 16 bits.\n");
+        printf("grid_out gets the 13x13 strategy, EV and equity grids of every node as JSON lines ('-' for no strategy_out).\n");
         printf("Example: ./turbofire \"As 8s 2s\" 200 300 300\n\n");
         return 1;
     }
@@ -296,17 +204,19 @@ int main(int argc, char** argv) {
 
     printf("Loading Preflop Ranges...\n");
     
-    PlayerRange p1_raw_range = {0};
-    parse_json_range(sb, &p1_raw_range); 
-
-    PlayerRange p2_raw_range = {0};
-    parse_json_range(btn, &p2_raw_range);   
+    float p1_weights[RANGE_COMBOS], p2_weights[RANGE_COMBOS];
+    int p1_ok = (argc > 5 && strcmp(argv[5], "-") != 0) ? range_load(argv[5], p1_weights) : range_parse_json(sb, p1_weights);
+    int p2_ok = (argc > 6 && strcmp(argv[6], "-") != 0) ? range_load(argv[6], p2_weights) : range_parse_json(btn, p2_weights);
+    if (p1_ok < 0 || p2_ok < 0) {
+        printf("ERROR: Couldn't load the %s range.\n", p1_ok < 0 ? "P1" : "P2");
+        return 1;
+    }
 
     float* p1_starting_reach = (float*)malloc(flop_map.padded_buckets * sizeof(float));
     float* p2_starting_reach = (float*)malloc(flop_map.padded_buckets * sizeof(float));
     
-    convert_range_to_buckets(&p1_raw_range, &flop_map, p1_starting_reach);
-    convert_range_to_buckets(&p2_raw_range, &flop_map, p2_starting_reach);
+    range_to_buckets(p1_weights, &flop_map, p1_starting_reach);
+    range_to_buckets(p2_weights, &flop_map, p2_starting_reach);
 
     // --- SOLVER EXECUTION (FLOP) ---
     printf("Starting DCFR Solver...\n");
@@ -341,6 +251,25 @@ int main(int argc, char** argv) {
     printf("Speed: %.4f seconds per iteration\n", total_time_spent / num_iterations);
     printf("========================================\n");
 
+    if (argc > 7) {
+        int quant_bits = (argc > 8) ? atoi(argv[8]) : 8;
+        calc_node_values(root, root_state, &flop_map, flop_map.padded_buckets, p1_starting_reach, p2_starting_reach);
+        if (strcmp(argv[7], "-") != 0) {
+            if (strategy_file_write(argv[7], root, root_state, &flop_map, quant_bits))
+                printf("Strategy and node values written to %s (%d bit).\n", argv[7], quant_bits);
+            else
+                printf("ERROR: Couldn't write the strategy to %s.\n", argv[7]);
+        }
+        if (argc > 9) {
+            clock_t grid_start = clock();
+            if (hand_grid_export(argv[9], root, root_state, &flop_map, p1_starting_reach, p2_starting_reach))
+                printf("Hand grids of every node written to %s [%.2f seconds].\n", argv[9], (double)(clock() - grid_start) / CLOCKS_PER_SEC);
+            else
+                printf("ERROR: Couldn't write the hand grids to %s.\n", argv[9]);
+        }
+        free_node_values(root);
+    }
+
     // --- INTERACTIVE EXPLORER ---
     PublicNode* current_node = root;
     GameState current_state = root_state;
@@ -509,7 +438,7 @@ int main(int argc, char** argv) {
     free(p2_starting_reach);
     free(live_p1_reach);
     free(live_p2_reach);
-    free(arena.memory);
+    arena_free(&arena);
 
     return 0;
 }
@@ -13,6 +13,7 @@
 #include <atomic>
 #include <unordered_map>
 #include <array>
+#include <functional>
 #include <cstdint>
 
 namespace omp {
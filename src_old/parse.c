@@ -28,6 +28,9 @@ uint64_t parse_board_string(const char* board_str) {
 			continue;
 		}
 
+		if (board_str[i+1] == '\0') //odd trailing character, don't step past the end
+			break;
+
 		int rank = char_to_rank(board_str[i]);
 		int suit = char_to_suit(board_str[i+1]);
 		if (rank != -1 && suit != -1)
@@ -39,6 +42,32 @@ uint64_t parse_board_string(const char* board_str) {
 	return board_mask;
 }
 
+//cards in the order given (card index suit * 13 + rank), -1 on a bad card or more than max
+int parse_card_list(const char* str, int* cards, int max) {
+	int n = 0;
+	while (str && *str) {
+		if (*str == ' ' || *str == ',') {
+			str++;
+			continue;
+		}
+		int rank = char_to_rank(str[0]);
+		int suit = str[1] ? char_to_suit(str[1]) : -1;
+		if (rank == -1 || suit == -1 || n == max)
+			return -1;
+		cards[n++] = suit * 13 + rank;
+		str += 2;
+	}
+	return n;
+}
+
+//mask of two distinct cards written as exactly 4 characters ("AhKd"), 0 otherwise
+uint64_t parse_hole_cards(const char* str) {
+	int cards[2];
+	if (!str || strlen(str) != 4 || parse_card_list(str, cards, 2) != 2 || cards[0] == cards[1])
+		return 0;
+	return (1ULL << (cards[0] % 13 + (cards[0] / 13) * 16)) | (1ULL << (cards[1] % 13 + (cards[1] / 13) * 16));
+}
+
 void add_combos_to_range(const char* hand_str, float weight, PlayerRange* range) {
     if (weight <= 0.0f) return;
 
@@ -20,5 +20,7 @@ void parse_json_range(const char* json_string, PlayerRange* out_range);
 void apply_card_removal(PlayerRange* range, uint64_t dead_cards);
 void print_range_grid(const PlayerRange* range);
 uint64_t parse_board_string(const char* board_str);
+int parse_card_list(const char* str, int* cards, int max);
+uint64_t parse_hole_cards(const char* str);
 
 #endif //PARSE_H
@@ -0,0 +1,84 @@
+#include "preflop_equity.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+int preflop_equity_load(const char* path, PreflopEquity* out) {
+	int fd = open(path, O_RDONLY);
+	if (fd < 0)
+		return 0;
+
+	struct stat st;
+	size_t expected = sizeof(PreflopEquityHeader) +
+		(PREFLOP_TRIANGLE + PREFLOP_CLASSES * PREFLOP_CLASSES) * sizeof(float);
+	if (fstat(fd, &st) != 0 || (size_t)st.st_size != expected) {
+		close(fd);
+		return 0;
+	}
+
+	void* map = mmap(NULL, expected, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (map == MAP_FAILED)
+		return 0;
+
+	const PreflopEquityHeader* header = (const PreflopEquityHeader*)map;
+	if (header->magic != PREFLOP_EQUITY_MAGIC || header->num_combos != PREFLOP_COMBOS ||
+	    header->num_classes != PREFLOP_CLASSES) {
+		munmap(map, expected);
+		return 0;
+	}
+
+	out->map = map;
+	out->map_size = expected;
+	out->combos = (const float*)(header + 1);
+	out->classes = out->combos + PREFLOP_TRIANGLE;
+	return 1;
+}
+
+void preflop_equity_free(PreflopEquity* pe) {
+	if (pe->map)
+		munmap(pe->map, pe->map_size);
+	pe->map = NULL;
+	pe->combos = NULL;
+	pe->classes = NULL;
+}
+
+//hand_mask uses the rank + suit * 16 bit layout, -1 unless it's exactly 2 cards
+int preflop_combo_index(uint64_t hand_mask) {
+	if (__builtin_popcountll(hand_mask) != 2)
+		return -1;
+
+	int cards[2];
+	for (int i = 0; i < 2; i++) {
+		int bit = __builtin_ctzll(hand_mask);
+		hand_mask &= hand_mask - 1;
+		cards[i] = (bit / 16) * 13 + (bit % 16);
+	}
+
+	//the 16 bit suit groups keep cards[0] < cards[1]
+	return cards[0] * (103 - cards[0]) / 2 + (cards[1] - cards[0] - 1);
+}
+
+/*
+ * 13x13 grid over ranks 0 (deuce) to 12 (ace), class = 13 * row + column:
+ * pairs on the diagonal, suited hands in the high rank's row, offsuit in
+ * the low rank's row
+ */
+int preflop_class(int combo) {
+	int c1 = 0;
+	while (combo >= 51 - c1) {
+		combo -= 51 - c1;
+		c1++;
+	}
+	int c2 = c1 + 1 + combo;
+
+	int r1 = c1 % 13, r2 = c2 % 13;
+	int hi = r1 > r2 ? r1 : r2;
+	int lo = r1 > r2 ? r2 : r1;
+
+	if (c1 / 13 == c2 / 13)
+		return hi * 13 + lo;
+	return lo * 13 + hi;
+}
@@ -0,0 +1,72 @@
+#ifndef PREFLOP_EQUITY_H
+#define PREFLOP_EQUITY_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+/*
+ * Exact heads-up preflop all-in equities, written by preflop_equity_gen and
+ * mapped read-only, so lookups never enumerate boards at runtime.
+ *
+ * Combos are in the indexer.c order (c1 < c2, card index suit * 13 + rank).
+ * Classes are the 169 starting hands, see preflop_class().
+ */
+#define PREFLOP_EQUITY_MAGIC 0x45504654    // "TFPE"
+#define PREFLOP_COMBOS       1326
+#define PREFLOP_CLASSES      169
+#define PREFLOP_TRIANGLE     (PREFLOP_COMBOS * (PREFLOP_COMBOS - 1) / 2)
+#define PREFLOP_BLOCKED      -1.0f         // combo pairs sharing a card
+
+/*
+ * file: header, then the upper combo triangle (row a holds b = a+1 ... 1325,
+ * equity of a), then the full class matrix (equity of the row class,
+ * averaged over the combo pairs that don't share a card)
+ */
+typedef struct {
+	uint32_t magic;
+	uint32_t num_combos;
+	uint32_t num_classes;
+	uint32_t reserved;
+} PreflopEquityHeader;
+
+typedef struct {
+	void* map;
+	size_t map_size;
+	const float* combos;    //PREFLOP_TRIANGLE
+	const float* classes;   //PREFLOP_CLASSES * PREFLOP_CLASSES
+} PreflopEquity;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+int preflop_equity_load(const char* path, PreflopEquity* out);
+void preflop_equity_free(PreflopEquity* pe);
+
+int preflop_combo_index(uint64_t hand_mask);
+int preflop_class(int combo);
+
+#ifdef __cplusplus
+}
+#endif
+
+static inline size_t preflop_triangle_index(int a, int b) {
+	return (size_t)a * (2 * PREFLOP_COMBOS - a - 1) / 2 + (b - a - 1);
+}
+
+//equity of combo a against combo b, PREFLOP_BLOCKED if they share a card
+static inline float preflop_equity(const PreflopEquity* pe, int a, int b) {
+	if (a == b)
+		return PREFLOP_BLOCKED;
+	if (a < b)
+		return pe->combos[preflop_triangle_index(a, b)];
+
+	float e = pe->combos[preflop_triangle_index(b, a)];
+	return e < 0.0f ? e : 1.0f - e;
+}
+
+static inline float preflop_class_equity(const PreflopEquity* pe, int class_a, int class_b) {
+	return pe->classes[class_a * PREFLOP_CLASSES + class_b];
+}
+
+#endif //PREFLOP_EQUITY_H
@@ -0,0 +1,141 @@
+/*
+ * ./preflop_equity_gen [out_file] [threads]
+ *
+ * Enumerates every heads-up preflop all-in exactly with omp's
+ * EquityCalculator and writes the table preflop_equity.h maps. Matchups
+ * that are the same up to a suit permutation are only enumerated once,
+ * which leaves ~85k of the 878k combo pairs.
+ */
+#include "preflop_equity.h"
+#include "omp/EquityCalculator.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+#include <array>
+#include <atomic>
+#include <thread>
+#include <algorithm>
+#include <unordered_map>
+
+//indexer.c card (suit * 13 + rank) to omp card (rank * 4 + suit)
+static uint8_t omp_card(int card) {
+	return (uint8_t)((card % 13) * 4 + card / 13);
+}
+
+static int combo_of(int c1, int c2) {
+	if (c1 > c2)
+		std::swap(c1, c2);
+	return c1 * (103 - c1) / 2 + (c2 - c1 - 1);
+}
+
+int main(int argc, char** argv) {
+	const char* path = (argc > 1) ? argv[1] : "preflop_equity.bin";
+	unsigned num_threads = (argc > 2) ? (unsigned)atoi(argv[2]) : std::thread::hardware_concurrency();
+	if (num_threads == 0)
+		num_threads = 1;
+
+	std::array<std::array<int, 2>, PREFLOP_COMBOS> cards;
+	for (int c1 = 0, combo = 0; c1 < 51; c1++)
+		for (int c2 = c1 + 1; c2 < 52; c2++)
+			cards[combo++] = {c1, c2};
+
+	std::array<std::array<int, 4>, 24> perms;
+	std::array<int, 4> perm = {0, 1, 2, 3};
+	for (int p = 0; p < 24; p++) {
+		perms[p] = perm;
+		std::next_permutation(perm.begin(), perm.end());
+	}
+
+	//canonical ordered matchup is the smallest a * 1326 + b over suit permutations
+	std::vector<float> triangle(PREFLOP_TRIANGLE, PREFLOP_BLOCKED);
+	std::vector<uint32_t> slot_of(PREFLOP_TRIANGLE, ~0u);
+	std::vector<uint32_t> canonical;
+	std::unordered_map<uint32_t, uint32_t> slots;
+
+	for (int a = 0; a < PREFLOP_COMBOS; a++) {
+		for (int b = a + 1; b < PREFLOP_COMBOS; b++) {
+			int h[4] = { cards[a][0], cards[a][1], cards[b][0], cards[b][1] };
+			if (h[0] == h[2] || h[0] == h[3] || h[1] == h[2] || h[1] == h[3])
+				continue;
+
+			uint32_t key = ~0u;
+			for (auto& p : perms) {
+				int m[4];
+				for (int i = 0; i < 4; i++)
+					m[i] = p[h[i] / 13] * 13 + h[i] % 13;
+				key = std::min(key, (uint32_t)(combo_of(m[0], m[1]) * PREFLOP_COMBOS + combo_of(m[2], m[3])));
+			}
+
+			auto it = slots.emplace(key, (uint32_t)canonical.size());
+			if (it.second)
+				canonical.push_back(key);
+			slot_of[preflop_triangle_index(a, b)] = it.first->second;
+		}
+	}
+	printf("%zu unique matchups, %u threads\n", canonical.size(), num_threads);
+
+	std::vector<float> equities(canonical.size());
+	std::atomic<size_t> next(0);
+	std::vector<std::thread> threads;
+
+	for (unsigned t = 0; t < num_threads; t++) {
+		threads.emplace_back([&] {
+			omp::EquityCalculator calc;
+			for (size_t i; (i = next++) < canonical.size();) {
+				int a = canonical[i] / PREFLOP_COMBOS;
+				int b = canonical[i] % PREFLOP_COMBOS;
+				std::vector<std::array<uint8_t, 2>> hand_a = {{ omp_card(cards[a][0]), omp_card(cards[a][1]) }};
+				std::vector<std::array<uint8_t, 2>> hand_b = {{ omp_card(cards[b][0]), omp_card(cards[b][1]) }};
+				std::vector<omp::CardRange> ranges = { omp::CardRange(hand_a), omp::CardRange(hand_b) };
+				calc.start(ranges, 0, 0, true, 0, nullptr, 1e9, 1);
+				calc.wait();
+				equities[i] = (float)calc.getResults().equity[0];
+
+				if (i % 5000 == 0)
+					printf("  %zu / %zu\n", i, canonical.size());
+			}
+		});
+	}
+	for (auto& t : threads)
+		t.join();
+
+	for (size_t i = 0; i < triangle.size(); i++)
+		if (slot_of[i] != ~0u)
+			triangle[i] = equities[slot_of[i]];
+
+	//classes average their non-blocked combo pairs
+	std::vector<double> class_sum(PREFLOP_CLASSES * PREFLOP_CLASSES, 0.0);
+	std::vector<int> class_count(PREFLOP_CLASSES * PREFLOP_CLASSES, 0);
+	for (int a = 0; a < PREFLOP_COMBOS; a++) {
+		for (int b = a + 1; b < PREFLOP_COMBOS; b++) {
+			float e = triangle[preflop_triangle_index(a, b)];
+			if (e < 0.0f)
+				continue;
+			int ca = preflop_class(a), cb = preflop_class(b);
+			class_sum[ca * PREFLOP_CLASSES + cb] += e;
+			class_count[ca * PREFLOP_CLASSES + cb]++;
+			class_sum[cb * PREFLOP_CLASSES + ca] += 1.0 - e;
+			class_count[cb * PREFLOP_CLASSES + ca]++;
+		}
+	}
+
+	std::vector<float> classes(PREFLOP_CLASSES * PREFLOP_CLASSES);
+	for (size_t i = 0; i < classes.size(); i++)
+		classes[i] = class_count[i] ? (float)(class_sum[i] / class_count[i]) : PREFLOP_BLOCKED;
+
+	FILE* f = fopen(path, "wb");
+	if (!f) {
+		printf("Couldn't open %s\n", path);
+		return 1;
+	}
+
+	PreflopEquityHeader header = { PREFLOP_EQUITY_MAGIC, PREFLOP_COMBOS, PREFLOP_CLASSES, 0 };
+	fwrite(&header, sizeof(header), 1, f);
+	fwrite(triangle.data(), sizeof(float), triangle.size(), f);
+	fwrite(classes.data(), sizeof(float), classes.size(), f);
+	fclose(f);
+
+	printf("Wrote %s\n", path);
+	return 0;
+}
@@ -0,0 +1,273 @@
+#include "range_loader.h"
+#include "omp/CardRange.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+//omp suits are s, h, c, d and ours s, h, d, c
+static const int OMP_SUIT[4] = { 0, 1, 3, 2 };
+
+static int combo_index(int c1, int c2) {
+	if (c1 > c2) {
+		int t = c1; c1 = c2; c2 = t;
+	}
+	return c1 * (103 - c1) / 2 + (c2 - c1 - 1);
+}
+
+//omp card (rank * 4 + suit) to indexer.c card (suit * 13 + rank)
+static int solver_card(int card) {
+	return OMP_SUIT[card & 3] * 13 + (card >> 2);
+}
+
+//sets every combo of expr to weight, returns how many there were
+int range_parse_expression(const char* expr, float weight, float* weights) {
+	omp::CardRange range(expr);
+	for (auto& c : range.combinations())
+		weights[combo_index(solver_card(c[0]), solver_card(c[1]))] = weight;
+	return (int)range.combinations().size();
+}
+
+/*
+ * Just enough JSON for range files: finds "hands" in the top level object
+ * and skips everything else, whatever it holds.
+ */
+struct JsonReader {
+	const char* p;
+
+	void skip_ws() {
+		while (*p == ' ' || *p == '\t' || *p == '\n' || *p == '\r')
+			p++;
+	}
+
+	bool consume(char c) {
+		skip_ws();
+		if (*p != c)
+			return false;
+		p++;
+		return true;
+	}
+
+	bool string(std::string& out) {
+		out.clear();
+		if (!consume('"'))
+			return false;
+		for (; *p && *p != '"'; p++) {
+			if (*p == '\\') {
+				if (!*++p)
+					return false;
+				//\uXXXX can't be part of a hand, keep it as is
+				out += *p == 'n' ? '\n' : *p == 't' ? '\t' : *p;
+			} else {
+				out += *p;
+			}
+		}
+		return *p++ == '"';
+	}
+
+	bool number(double& out) {
+		skip_ws();
+		char* end;
+		out = strtod(p, &end);
+		if (end == p)
+			return false;
+		p = end;
+		return true;
+	}
+
+	bool skip_value() {
+		skip_ws();
+		std::string s;
+		if (*p == '"')
+			return string(s);
+		if (*p == '{' || *p == '[') {
+			char close = *p == '{' ? '}' : ']';
+			p++;
+			if (consume(close))
+				return true;
+			do {
+				if (close == '}' && (!string(s) || !consume(':')))
+					return false;
+				if (!skip_value())
+					return false;
+			} while (consume(','));
+			return consume(close);
+		}
+		//numbers, true, false, null
+		const char* start = p;
+		while (*p && !strchr(",}] \t\r\n", *p))
+			p++;
+		return p != start;
+	}
+};
+
+//weights of combos not listed in "hands" are 0, returns the number of combos with a weight, -1 on a parse error
+int range_parse_json(const char* json, float* weights) {
+	for (int i = 0; i < RANGE_COMBOS; i++)
+		weights[i] = 0.0f;
+
+	JsonReader r = { json };
+	std::string key;
+	if (!r.consume('{'))
+		return -1;
+	if (r.consume('}'))
+		return 0;
+
+	do {
+		if (!r.string(key) || !r.consume(':'))
+			return -1;
+		if (key != "hands") {
+			if (!r.skip_value())
+				return -1;
+			continue;
+		}
+
+		if (!r.consume('{'))
+			return -1;
+		if (r.consume('}'))
+			continue;
+		do {
+			double weight;
+			if (!r.string(key) || !r.consume(':') || !r.number(weight))
+				return -1;
+			range_parse_expression(key.c_str(), (float)weight, weights);
+		} while (r.consume(','));
+		if (!r.consume('}'))
+			return -1;
+	} while (r.consume(','));
+
+	if (!r.consume('}'))
+		return -1;
+
+	int count = 0;
+	for (int i = 0; i < RANGE_COMBOS; i++)
+		count += weights[i] > 0.0f;
+	return count;
+}
+
+static bool read_file(const char* path, std::string& out) {
+	FILE* f = fopen(path, "rb");
+	if (!f)
+		return false;
+	char buf[65536];
+	size_t n;
+	out.clear();
+	while ((n = fread(buf, 1, sizeof(buf), f)) > 0)
+		out.append(buf, n);
+	fclose(f);
+	return true;
+}
+
+/*
+ * spec is a JSON file, or pack.bin:name for a range in a pack. Returns the
+ * number of combos with a weight, -1 if the range couldn't be loaded.
+ */
+int range_load(const char* spec, float* weights) {
+	std::string text;
+	if (read_file(spec, text))
+		return range_parse_json(text.c_str(), weights);
+
+	const char* colon = strrchr(spec, ':');
+	if (!colon)
+		return -1;
+
+	std::string path(spec, colon);
+	RangePack pack;
+	if (!range_pack_load(path.c_str(), &pack))
+		return -1;
+
+	const float* found = range_pack_find(&pack, colon + 1);
+	int count = -1;
+	if (found) {
+		count = 0;
+		for (int i = 0; i < RANGE_COMBOS; i++) {
+			weights[i] = found[i];
+			count += found[i] > 0.0f;
+		}
+	}
+	range_pack_free(&pack);
+	return count;
+}
+
+int range_pack_load(const char* path, RangePack* out) {
+	int fd = open(path, O_RDONLY);
+	if (fd < 0)
+		return 0;
+
+	struct stat st;
+	if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(RangePackHeader)) {
+		close(fd);
+		return 0;
+	}
+
+	size_t size = (size_t)st.st_size;
+	void* map = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (map == MAP_FAILED)
+		return 0;
+
+	const RangePackHeader* header = (const RangePackHeader*)map;
+	if (header->magic != RANGE_PACK_MAGIC || header->num_combos != RANGE_COMBOS ||
+	    size != sizeof(RangePackHeader) + header->num_ranges * sizeof(RangePackEntry)) {
+		munmap(map, size);
+		return 0;
+	}
+
+	out->map = map;
+	out->map_size = size;
+	out->num_ranges = header->num_ranges;
+	out->entries = (const RangePackEntry*)(header + 1);
+	return 1;
+}
+
+void range_pack_free(RangePack* pack) {
+	if (pack->map)
+		munmap(pack->map, pack->map_size);
+	pack->map = NULL;
+	pack->entries = NULL;
+}
+
+const float* range_pack_find(const RangePack* pack, const char* name) {
+	for (uint32_t i = 0; i < pack->num_ranges; i++)
+		if (strncmp(pack->entries[i].name, name, RANGE_PACK_NAME_LEN) == 0)
+			return pack->entries[i].weights;
+	return NULL;
+}
+
+//names longer than RANGE_PACK_NAME_LEN - 1 are cut
+int range_pack_write(const char* path, int num_ranges, const char* const* names, const float* const* weights) {
+	FILE* f = fopen(path, "wb");
+	if (!f)
+		return 0;
+
+	RangePackHeader header = { RANGE_PACK_MAGIC, (uint32_t)num_ranges, RANGE_COMBOS, 0 };
+	fwrite(&header, sizeof(header), 1, f);
+
+	std::vector<RangePackEntry> entries(num_ranges);
+	for (int i = 0; i < num_ranges; i++) {
+		memset(entries[i].name, 0, RANGE_PACK_NAME_LEN);
+		strncpy(entries[i].name, names[i], RANGE_PACK_NAME_LEN - 1);
+		memcpy(entries[i].weights, weights[i], sizeof(entries[i].weights));
+	}
+	size_t written = fwrite(entries.data(), sizeof(RangePackEntry), entries.size(), f);
+	return fclose(f) == 0 && written == entries.size();
+}
+
+//one pass over the combos, summing the weights of each bucket and skipping combos blocked by the board
+void range_to_buckets(const float* weights, const IsoMap* map, float* out_reach) {
+	for (int b = 0; b < map->padded_buckets; b++)
+		out_reach[b] = 0.0f;
+
+	for (int i = 0; i < RANGE_COMBOS; i++) {
+		int bucket = map->combo_to_bucket[i];
+		if (bucket >= 0)
+			out_reach[bucket] += weights[i];
+	}
+}
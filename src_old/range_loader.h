@@ -0,0 +1,61 @@
+#ifndef RANGE_LOADER_H
+#define RANGE_LOADER_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "indexer.h"
+
+/*
+ * Ranges as one weight per combo, in the indexer.c combo order (c1 < c2,
+ * card index suit * 13 + rank), so turning them into bucket reach is a
+ * single pass over the IsoMap.
+ *
+ * Sources are rangefinder JSON ("hands": {"AKs": 1.0, ...}, keys in
+ * omp::CardRange notation, so "QQ+" or "AsKs" work too, later keys win)
+ * and range packs: many named ranges compiled into one mmap-able file.
+ */
+#define RANGE_COMBOS        1326
+#define RANGE_PACK_MAGIC    0x50524654    // "TFRP"
+#define RANGE_PACK_NAME_LEN 64
+
+//file: header, then num_ranges entries
+typedef struct {
+	uint32_t magic;
+	uint32_t num_ranges;
+	uint32_t num_combos;
+	uint32_t reserved;
+} RangePackHeader;
+
+typedef struct {
+	char name[RANGE_PACK_NAME_LEN];
+	float weights[RANGE_COMBOS];
+} RangePackEntry;
+
+typedef struct {
+	void* map;
+	size_t map_size;
+	uint32_t num_ranges;
+	const RangePackEntry* entries;
+} RangePack;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+int range_parse_expression(const char* expr, float weight, float* weights);
+int range_parse_json(const char* json, float* weights);
+int range_load(const char* spec, float* weights);
+
+int range_pack_load(const char* path, RangePack* out);
+void range_pack_free(RangePack* pack);
+const float* range_pack_find(const RangePack* pack, const char* name);
+int range_pack_write(const char* path, int num_ranges, const char* const* names, const float* const* weights);
+
+void range_to_buckets(const float* weights, const IsoMap* map, float* out_reach);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //RANGE_LOADER_H
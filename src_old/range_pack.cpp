@@ -0,0 +1,53 @@
+/*
+ * ./range_pack <out_file> <range.json> [range.json ...]
+ *
+ * Compiles rangefinder JSON ranges into one range pack (range_loader.h),
+ * so batch runs map a single file instead of parsing JSON per spot. Each
+ * range is named after its file, without directories and ".json".
+ */
+#include "range_loader.h"
+
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+int main(int argc, char** argv) {
+	if (argc < 3) {
+		printf("Usage: ./range_pack <out_file> <range.json> [range.json ...]\n");
+		return 1;
+	}
+
+	int num_ranges = argc - 2;
+	std::vector<std::string> names(num_ranges);
+	std::vector<std::vector<float>> weights(num_ranges, std::vector<float>(RANGE_COMBOS));
+	std::vector<const char*> name_ptrs(num_ranges);
+	std::vector<const float*> weight_ptrs(num_ranges);
+
+	for (int i = 0; i < num_ranges; i++) {
+		const char* path = argv[i + 2];
+		int combos = range_load(path, weights[i].data());
+		if (combos < 0) {
+			printf("Couldn't load %s\n", path);
+			return 1;
+		}
+
+		const char* base = strrchr(path, '/');
+		names[i] = base ? base + 1 : path;
+		if (names[i].size() > 5 && names[i].compare(names[i].size() - 5, 5, ".json") == 0)
+			names[i].resize(names[i].size() - 5);
+		if (names[i].size() >= RANGE_PACK_NAME_LEN)
+			printf("warning: name %s is cut to %d characters\n", names[i].c_str(), RANGE_PACK_NAME_LEN - 1);
+
+		name_ptrs[i] = names[i].c_str();
+		weight_ptrs[i] = weights[i].data();
+		printf("  %s: %d combos\n", names[i].c_str(), combos);
+	}
+
+	if (!range_pack_write(argv[1], num_ranges, name_ptrs.data(), weight_ptrs.data())) {
+		printf("Couldn't write %s\n", argv[1]);
+		return 1;
+	}
+	printf("Wrote %d ranges to %s\n", num_ranges, argv[1]);
+	return 0;
+}
@@ -0,0 +1,152 @@
+/*
+ * Real-time re-solve of a postflop street on top of the MCCFR blueprint.
+ *
+ * The blueprint gives the ranges that reach the spot and the value of every
+ * hand at the end of the street, the vector solver then runs DCFR on the
+ * depth-limited street with those as starting reach and leaf values until
+ * the time budget is used up. Chips are the blueprint's cents.
+ */
+#include "resolve.h"
+#include "cfr.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <time.h>
+
+static double now_seconds() {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+//hands in a bucket are isomorphic, so reach adds up
+static void combos_to_buckets(IsoMap* map, const float* combos, float* out_buckets) {
+	for (int b = 0; b < map->padded_buckets; b++)
+		out_buckets[b] = 0.0f;
+
+	for (int combo = 0; combo < NUM_COMBOS; combo++) {
+		int bucket = map->combo_to_bucket[combo];
+		if (bucket != -1)
+			out_buckets[bucket] += combos[combo];
+	}
+}
+
+//values are the same for every hand in a bucket, average out the sampling noise
+static void combos_to_bucket_means(IsoMap* map, const float* combos, float* out_buckets) {
+	int counts[MAX_BUCKETS] = {0};
+
+	for (int b = 0; b < map->padded_buckets; b++)
+		out_buckets[b] = 0.0f;
+
+	for (int combo = 0; combo < NUM_COMBOS; combo++) {
+		int bucket = map->combo_to_bucket[combo];
+		if (bucket == -1)
+			continue;
+		out_buckets[bucket] += combos[combo];
+		counts[bucket]++;
+	}
+
+	for (int b = 0; b < map->num_unique_buckets; b++)
+		if (counts[b] > 0)
+			out_buckets[b] /= (float)counts[b];
+}
+
+//map one of our bet sizes onto the nearest blueprint action
+static void push_translated(GameState* state, int action_amount, BlueprintLine* line) {
+	int facing_bet = (state->active_player == 0) ?
+		state->p2_commit - state->p1_commit :
+		state->p1_commit - state->p2_commit;
+
+	if (action_amount == -1)
+		blueprint_line_push(line, BP_FOLD, 0.0f);
+	else if (action_amount <= facing_bet || action_amount == 0)
+		blueprint_line_push(line, BP_PASSIVE, 0.0f);
+	else
+		blueprint_line_push(line, BP_AGGRESSIVE, (float)(action_amount - facing_bet) / (float)state->pot);
+}
+
+static void fill_leaves(const Blueprint* bp, PublicNode* node, GameState state, IsoMap* map,
+		BlueprintLine line, int root_actions, int samples) {
+	if (node->type == NODE_LEAF) {
+		//the walk only uses P1's values, see evaluate_leaf
+		float p1_values[NUM_COMBOS];
+		blueprint_leaf_values(bp, &line, root_actions, samples, p1_values, NULL);
+		combos_to_bucket_means(map, p1_values, node->leaf_values);
+		return;
+	}
+
+	if (node->type != NODE_ACTION)
+		return;
+
+	int legal_actions[8];
+	generate_bet_sizes(&state, legal_actions);
+
+	for (int i = 0; i < node->num_children; i++) {
+		BlueprintLine next_line = line;
+		push_translated(&state, legal_actions[i], &next_line);
+		fill_leaves(bp, node->children[i], apply_bet(state, legal_actions[i]), map, next_line, root_actions, samples);
+	}
+}
+
+/*
+ * line has to end at the start of a postflop street, returns 0 otherwise.
+ * At least one iteration runs even if the leaves used up the budget
+ */
+int resolve_spot(const Blueprint* bp, const BlueprintLine* line, Arena* arena, double time_budget, int leaf_samples, ResolveResult* out) {
+	double start = now_seconds();
+
+	BlueprintSpot spot;
+	if (!blueprint_spot(line, &spot) || spot.terminal || spot.street < 1 || spot.street > 3 || spot.actions_st != 0)
+		return 0;
+
+	IsoMap* map = &out->map;
+	build_isomorphism_map(spot.board, map);
+	int num_buckets = map->padded_buckets;
+
+	//who gets here under the blueprint
+	float p1_combos[NUM_COMBOS], p2_combos[NUM_COMBOS];
+	blueprint_ranges(bp, line, p1_combos, p2_combos);
+
+	float* p1_reach = (float*)malloc(num_buckets * sizeof(float));
+	float* p2_reach = (float*)malloc(num_buckets * sizeof(float));
+	combos_to_buckets(map, p1_combos, p1_reach);
+	combos_to_buckets(map, p2_combos, p2_reach);
+
+	GameState root_state = {0};
+	root_state.board = spot.board;
+	root_state.pot = spot.pot;
+	root_state.p1_stack = spot.p1_stack;
+	root_state.p2_stack = spot.p2_stack;
+	root_state.active_player = 0;
+	root_state.street = spot.street - 1; //0 is the flop here
+
+	arena_reset(arena);
+	PublicNode* root = build_depth_limited_tree(arena, root_state, num_buckets);
+	fill_leaves(bp, root, root_state, map, *line, line->num_actions, leaf_samples);
+
+	//same discounting as main2.c
+	int iter = 0;
+	do {
+		do_cfr_iteration(root, root_state, map, num_buckets, p1_reach, p2_reach);
+		discount_tree(root, num_buckets, iter + 1, 1.5f, 0.5f, 2.0f);
+		iter++;
+	} while (now_seconds() - start < time_budget);
+
+	out->num_actions = generate_bet_sizes(&root_state, out->actions);
+	out->strategy = (float*)malloc(out->num_actions * num_buckets * sizeof(float));
+	calc_average_strategy(root->strategy_sum, out->strategy, root->num_children, num_buckets);
+	out->root_reach = p1_reach;
+	out->iterations = iter;
+	out->seconds = now_seconds() - start;
+
+	free(p2_reach);
+	return 1;
+}
+
+void free_resolve_result(ResolveResult* result) {
+	free(result->strategy);
+	free(result->root_reach);
+	result->strategy = NULL;
+	result->root_reach = NULL;
+}
@@ -0,0 +1,21 @@
+#ifndef RESOLVE_H
+#define RESOLVE_H
+
+#include "tree.h"
+#include "indexer.h"
+#include "../mccfr/blueprint.h"
+
+typedef struct {
+	IsoMap map;
+	int num_actions;
+	int actions[8];         //generate_bet_sizes amounts at the subgame root
+	float* strategy;        //average strategy, num_actions * map.padded_buckets
+	float* root_reach;      //P1 (first to act) bucket reach from the blueprint
+	int iterations;
+	double seconds;
+} ResolveResult;
+
+int resolve_spot(const Blueprint* bp, const BlueprintLine* line, Arena* arena, double time_budget, int leaf_samples, ResolveResult* out);
+void free_resolve_result(ResolveResult* result);
+
+#endif //RESOLVE_H
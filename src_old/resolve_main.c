@@ -0,0 +1,105 @@
+#include "resolve.h"
+#include "parse.h"
+#include "evaluator.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * ./resolve blueprint.bin "<line>" "<board>" [budget_ms] [leaf_samples]
+ *
+ * line is the blueprint action ids from the preflop root, one digit each,
+ * e.g. "2 1" = SB raises, BB calls. board is in deal order, leaf_samples
+ * is rollouts per hand at each depth limit.
+ */
+static int parse_line(const char* line_str, BlueprintLine* line) {
+	line->num_actions = 0;
+	for (int i = 0; line_str[i] != '\0'; i++) {
+		if (line_str[i] == ' ')
+			continue;
+		if (line_str[i] < '0' || line_str[i] > '7' || line->num_actions >= BLUEPRINT_MAX_LINE)
+			return 0;
+		line->actions[line->num_actions++] = (uint8_t)(line_str[i] - '0');
+	}
+	return 1;
+}
+
+static int parse_board_cards(const char* board_str, BlueprintLine* line) {
+	line->num_board = 0;
+	for (int i = 0; board_str[i] != '\0'; ) {
+		if (board_str[i] == ' ') {
+			i++;
+			continue;
+		}
+
+		char card[3] = { board_str[i], board_str[i + 1], '\0' };
+		uint64_t mask = parse_board_string(card);
+		if (mask == 0 || line->num_board >= 5)
+			return 0;
+		line->board[line->num_board++] = __builtin_ctzll(mask);
+		i += 2;
+	}
+	return 1;
+}
+
+int main(int argc, char** argv) {
+	if (argc < 4) {
+		printf("Usage:   ./resolve <blueprint> \"<line>\" \"<board>\" [budget_ms] [leaf_samples]\n");
+		printf("Example: ./resolve blueprint.bin \"2 1\" \"As 8s 2s\" 500 2\n");
+		return 1;
+	}
+
+	double budget = (argc > 4) ? atof(argv[4]) / 1000.0 : 0.5;
+	int samples = (argc > 5) ? atoi(argv[5]) : 2;
+
+	BlueprintLine line;
+	if (!parse_line(argv[2], &line) || !parse_board_cards(argv[3], &line)) {
+		printf("Couldn't parse line or board\n");
+		return 1;
+	}
+
+	Blueprint* bp = blueprint_load(argv[1]);
+	if (!bp) {
+		printf("Couldn't load blueprint %s\n", argv[1]);
+		return 1;
+	}
+
+	init_evaluator();
+
+	Arena arena;
+	arena_init(&arena, 2ULL * 1024 * 1024 * 1024);
+
+	ResolveResult result;
+	if (!resolve_spot(bp, &line, &arena, budget, samples, &result)) {
+		printf("Line has to end at the start of a postflop street\n");
+		blueprint_free(bp);
+		return 1;
+	}
+
+	printf("Re-solved in %.3fs, %d iterations, %d buckets\n",
+		result.seconds, result.iterations, result.map.num_unique_buckets);
+
+	//range-weighted frequency of each root action
+	float total_reach = 0.0f;
+	for (int b = 0; b < result.map.num_unique_buckets; b++)
+		total_reach += result.root_reach[b];
+
+	for (int a = 0; a < result.num_actions; a++) {
+		float freq = 0.0f;
+		for (int b = 0; b < result.map.num_unique_buckets; b++)
+			freq += result.root_reach[b] * result.strategy[(a * result.map.padded_buckets) + b];
+
+		if (result.actions[a] == -1)
+			printf("  Fold      ");
+		else if (result.actions[a] == 0)
+			printf("  Check     ");
+		else
+			printf("  Bet %-6d", result.actions[a]);
+		printf("%6.1f%%\n", total_reach > 0.0f ? 100.0f * freq / total_reach : 0.0f);
+	}
+
+	free_resolve_result(&result);
+	blueprint_free(bp);
+	return 0;
+}
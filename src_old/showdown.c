@@ -41,29 +41,73 @@ void evaluate_showdown(GameState state, IsoMap* map, int num_buckets, float* p1_
         bucket_scores[b] = evaluate_board(hand_mask, state.board);
     }
 
-    for (int p1_b = 0; p1_b < map->num_unique_buckets; p1_b++) {
-        if (p1_reach[p1_b] == 0.0f) continue;
-        float expected_value = 0.0f;
+    //range variants (cfr.h) share the board, so the scores are worked out once
+    for (int offset = 0; offset < num_buckets; offset += map->padded_buckets) {
+        float* p1_block = p1_reach + offset;
+        float* p2_block = p2_reach + offset;
+        float* util_block = out_util + offset;
 
-        for (int p2_b = 0; p2_b < map->num_unique_buckets; p2_b++) {
-            if (p2_reach[p2_b] == 0.0f) continue;
+        for (int p1_b = 0; p1_b < map->num_unique_buckets; p1_b++) {
+            if (p1_block[p1_b] == 0.0f) continue;
+            float expected_value = 0.0f;
 
-            int p1_score = bucket_scores[p1_b];
-            int p2_score = bucket_scores[p2_b];
+            for (int p2_b = 0; p2_b < map->num_unique_buckets; p2_b++) {
+                if (p2_block[p2_b] == 0.0f) continue;
 
-            if (p1_score > p2_score) {
-                expected_value += p2_reach[p2_b] * (float)state.p2_commit; 
-            } else if (p2_score > p1_score) {
-                expected_value -= p2_reach[p2_b] * (float)state.p1_commit;
+                int p1_score = bucket_scores[p1_b];
+                int p2_score = bucket_scores[p2_b];
+
+                if (p1_score > p2_score) {
+                    expected_value += p2_block[p2_b] * (float)state.p2_commit;
+                } else if (p2_score > p1_score) {
+                    expected_value -= p2_block[p2_b] * (float)state.p1_commit;
+                } else {
+                    expected_value += 0.0f;
+                }
+            }
+
+            if (state.active_player == 0) {
+                util_block[p1_b] = expected_value;
             } else {
-                expected_value += 0.0f; 
+                util_block[p1_b] = -expected_value;
             }
         }
-        
-        if (state.active_player == 0) {
-            out_util[p1_b] = expected_value;
-        } else {
-            out_util[p1_b] = -expected_value; 
-        }
+    }
+}
+
+static int compare_u64(const void* a, const void* b) {
+    uint64_t x = *(const uint64_t*)a, y = *(const uint64_t*)b;
+    return (x > y) - (x < y);
+}
+
+void showdown_order(uint64_t board, IsoMap* map, uint64_t* precomputed_masks, ShowdownOrder* out) {
+    uint64_t keys[MAX_BUCKETS];
+    for (int b = 0; b < map->num_unique_buckets; b++)
+        keys[b] = ((uint64_t)(uint32_t)evaluate_board(precomputed_masks[b], board) << 16) | (uint64_t)b;
+    qsort(keys, map->num_unique_buckets, sizeof(uint64_t), compare_u64);
+
+    out->board = board;
+    out->count = map->num_unique_buckets;
+    for (int i = 0; i < out->count; i++) {
+        out->scores[i] = (int)(keys[i] >> 16);
+        out->buckets[i] = (uint16_t)(keys[i] & 0xFFFF);
+    }
+}
+
+// Adds weight * (opp mass beaten + half the mass tied) to out_share per
+// bucket, the same comparisons evaluate_showdown makes in one sweep
+void showdown_shares(const ShowdownOrder* order, const float* opp_reach, float weight, float* out_share) {
+    float below = 0.0f;
+    for (int i = 0; i < order->count; ) {
+        int j = i;
+        float tied = 0.0f;
+        while (j < order->count && order->scores[j] == order->scores[i])
+            tied += opp_reach[order->buckets[j++]];
+
+        float share = weight * (below + 0.5f * tied);
+        for (int k = i; k < j; k++)
+            out_share[order->buckets[k]] += share;
+        below += tied;
+        i = j;
     }
 }
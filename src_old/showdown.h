@@ -1,3 +1,6 @@
+#ifndef SHOWDOWN_H
+#define SHOWDOWN_H
+
 #include "indexer.h"
 #include "tree.h"
 #include "evaluator.h"
@@ -6,3 +9,17 @@
 
 uint64_t get_mask_for_bucket(IsoMap* map, int target_bucket);
 void evaluate_showdown(GameState state, IsoMap* map, int num_buckets, float* p1_reach, float* p2_reach, float* out_util, uint64_t* precomputed_masks);
+
+// Buckets sorted by their showdown score on one board, for passes that
+// need every bucket's standing against a whole range at once
+typedef struct {
+    uint64_t board;
+    int count;                      // map->num_unique_buckets
+    int scores[MAX_BUCKETS];        // ascending
+    uint16_t buckets[MAX_BUCKETS];
+} ShowdownOrder;
+
+void showdown_order(uint64_t board, IsoMap* map, uint64_t* precomputed_masks, ShowdownOrder* out);
+void showdown_shares(const ShowdownOrder* order, const float* opp_reach, float weight, float* out_share);
+
+#endif //SHOWDOWN_H
@@ -0,0 +1,243 @@
+#include "spot_cache.h"
+#include "evaluator.h"
+
+#include <omp.h>
+#include <errno.h>
+#include <signal.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/un.h>
+
+/*
+ * ./solve_daemon [socket] [workers] [cache_mb] [arena_mb]
+ *
+ * Keeps the evaluator and recently solved trees (spot_cache.h) loaded and
+ * answers one request per line on a Unix domain socket, one reply line
+ * each, "OK ..." or "ERR <reason>":
+ *
+ *   SOLVE board=As8s2s pot=200 stacks=300,300 [p1=<range>] [p2=<range>] [target=0.5] [iters=1000]
+ *   QUERY spot=<id> board=As8s2s4d line=x,b66,c hand=AhKd
+ *   EXPORT spot=<id> path=<file> [bits=8]
+ *   STATS
+ *
+ * SOLVE takes spot_request_parse fields. target is the exploitability to
+ * reach in % of the pot, iters caps the tree's total iterations. SOLVE
+ * replies with the spot id QUERY and EXPORT take. arena_mb caps a single
+ * tree, larger spots get "ERR tree too large".
+ *
+ * Every connection has its own thread. A SOLVE that has to iterate takes
+ * one of workers slots while it runs, solving with omp_get_num_procs() /
+ * workers OpenMP threads. Cache hits, QUERY, EXPORT and STATS don't wait
+ * for a slot. A connection idle for IDLE_TIMEOUT seconds is closed.
+ */
+#define MAX_CLIENTS  64
+#define LINE_LEN     4096
+#define IDLE_TIMEOUT 300
+
+static SpotCache cache;
+
+static pthread_mutex_t slots_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t slot_free = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t client_gone = PTHREAD_COND_INITIALIZER;
+static int free_slots;
+static int num_clients;
+static int omp_threads_per_worker = 1;
+
+static const char* spot_error(int code) {
+	switch (code) {
+	case SPOT_ERR_UNKNOWN: return "ERR unknown spot";
+	case SPOT_ERR_BOARD: return "ERR bad board";
+	case SPOT_ERR_LINE: return "ERR bad line";
+	case SPOT_ERR_HAND: return "ERR bad hand";
+	case SPOT_ERR_TOO_LARGE: return "ERR tree too large";
+	}
+	return "ERR failed";
+}
+
+static void handle_solve(const SpotParams* params, char* reply) {
+	SpotRequest* req = (SpotRequest*)malloc(sizeof(SpotRequest));
+	const char* error = spot_request_parse(params, req);
+	SpotResult result;
+	int code;
+	if (error) {
+		snprintf(reply, LINE_LEN, "ERR %s", error);
+		free(req);
+		return;
+	}
+
+	//only iterating takes a worker slot
+	code = spot_cache_lookup(&cache, req, &result);
+	if (!code) {
+		pthread_mutex_lock(&slots_lock);
+		while (free_slots == 0)
+			pthread_cond_wait(&slot_free, &slots_lock);
+		free_slots--;
+		pthread_mutex_unlock(&slots_lock);
+
+		code = spot_cache_solve(&cache, req, &result);
+
+		pthread_mutex_lock(&slots_lock);
+		free_slots++;
+		pthread_cond_signal(&slot_free);
+		pthread_mutex_unlock(&slots_lock);
+	}
+
+	if (code <= 0)
+		snprintf(reply, LINE_LEN, "%s", spot_error(code));
+	else
+		snprintf(reply, LINE_LEN, "OK spot=%016llx iterations=%d exploitability=%.4f ms=%.1f cached=%d",
+			(unsigned long long)result.hash, result.iterations, result.exploitability, result.seconds * 1000.0, result.cached);
+	free(req);
+}
+
+static void handle_query(const SpotParams* params, char* reply) {
+	uint64_t hash = strtoull(spot_param(params, "spot", "0"), NULL, 16);
+	char labels[8][16];
+	float probs[8];
+	int n = spot_cache_query(&cache, hash, spot_param(params, "board", ""), spot_param(params, "line", ""),
+		spot_param(params, "hand", ""), labels, probs);
+	if (n <= 0) {
+		snprintf(reply, LINE_LEN, "%s", spot_error(n));
+		return;
+	}
+
+	int len = snprintf(reply, LINE_LEN, "OK");
+	for (int a = 0; a < n; a++)
+		len += snprintf(reply + len, LINE_LEN - len, " %s=%.4f", labels[a], probs[a]);
+}
+
+static void handle_export(const SpotParams* params, char* reply) {
+	uint64_t hash = strtoull(spot_param(params, "spot", "0"), NULL, 16);
+	const char* path = spot_param(params, "path", NULL);
+	int bits = atoi(spot_param(params, "bits", "8"));
+	int ok = path ? spot_cache_export(&cache, hash, path, bits) : 0;
+	if (ok < 0)
+		snprintf(reply, LINE_LEN, "%s", spot_error(ok));
+	else
+		snprintf(reply, LINE_LEN, ok ? "OK" : "ERR couldn't write the file");
+}
+
+static void handle_stats(char* reply) {
+	pthread_mutex_lock(&cache.lock);
+	snprintf(reply, LINE_LEN, "OK entries=%d bytes=%zu max_bytes=%zu hits=%llu misses=%llu",
+		cache.num_entries, cache.bytes, cache.max_bytes,
+		(unsigned long long)cache.hits, (unsigned long long)cache.misses);
+	pthread_mutex_unlock(&cache.lock);
+}
+
+static void handle_client(int fd) {
+	FILE* in = fdopen(fd, "r");
+	FILE* out = fdopen(dup(fd), "w");
+	if (!in || !out) {
+		if (in) fclose(in); else close(fd);
+		if (out) fclose(out);
+		return;
+	}
+
+	char line[LINE_LEN], reply[LINE_LEN];
+	while (fgets(line, sizeof(line), in)) {
+		char* cmd = line + strspn(line, " \t\r\n");
+		char* rest = cmd + strcspn(cmd, " \t\r\n");
+		if (!*cmd)
+			continue;
+		if (*rest)
+			*rest++ = 0;
+		SpotParams params;
+		spot_params_split(rest, &params);
+
+		if (strcmp(cmd, "SOLVE") == 0)
+			handle_solve(&params, reply);
+		else if (strcmp(cmd, "QUERY") == 0)
+			handle_query(&params, reply);
+		else if (strcmp(cmd, "EXPORT") == 0)
+			handle_export(&params, reply);
+		else if (strcmp(cmd, "STATS") == 0)
+			handle_stats(reply);
+		else
+			snprintf(reply, LINE_LEN, "ERR unknown command");
+
+		fprintf(out, "%s\n", reply);
+		fflush(out);
+	}
+	fclose(in);
+	fclose(out);
+}
+
+static void* client_thread(void* arg) {
+	int fd = (int)(intptr_t)arg;
+	struct timeval timeout = { IDLE_TIMEOUT, 0 };
+	setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+	omp_set_num_threads(omp_threads_per_worker);
+	handle_client(fd);
+
+	pthread_mutex_lock(&slots_lock);
+	num_clients--;
+	pthread_cond_signal(&client_gone);
+	pthread_mutex_unlock(&slots_lock);
+	return NULL;
+}
+
+int main(int argc, char** argv) {
+	const char* path = (argc > 1) ? argv[1] : "/tmp/turbofire.sock";
+	int workers = (argc > 2) ? atoi(argv[2]) : 2;
+	size_t cache_mb = (argc > 3) ? (size_t)atol(argv[3]) : 4096;
+	size_t arena_mb = (argc > 4) ? (size_t)atol(argv[4]) : 2048;
+	if (workers < 1)
+		workers = 1;
+
+	signal(SIGPIPE, SIG_IGN);
+	init_evaluator();
+	spot_cache_init(&cache, cache_mb << 20, arena_mb << 20);
+	omp_threads_per_worker = omp_get_num_procs() / workers;
+	if (omp_threads_per_worker < 1)
+		omp_threads_per_worker = 1;
+
+	int sock = socket(AF_UNIX, SOCK_STREAM, 0);
+	struct sockaddr_un addr;
+	memset(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	strncpy(addr.sun_path, path, sizeof(addr.sun_path) - 1);
+	unlink(path);
+	if (sock < 0 || bind(sock, (struct sockaddr*)&addr, sizeof(addr)) != 0 || listen(sock, MAX_CLIENTS) != 0) {
+		printf("Couldn't listen on %s: %s\n", path, strerror(errno));
+		return 1;
+	}
+
+	free_slots = workers;
+	printf("Listening on %s, %d workers x %d threads, %zu MB cache\n", path, workers, omp_threads_per_worker, cache_mb);
+	fflush(stdout);
+
+	while (1) {
+		int fd = accept(sock, NULL, NULL);
+		if (fd < 0) {
+			if (errno == EINTR)
+				continue;
+			break;
+		}
+
+		pthread_mutex_lock(&slots_lock);
+		while (num_clients == MAX_CLIENTS)
+			pthread_cond_wait(&client_gone, &slots_lock);
+		num_clients++;
+		pthread_mutex_unlock(&slots_lock);
+
+		pthread_t thread;
+		if (pthread_create(&thread, NULL, client_thread, (void*)(intptr_t)fd) != 0) {
+			close(fd);
+			pthread_mutex_lock(&slots_lock);
+			num_clients--;
+			pthread_mutex_unlock(&slots_lock);
+			continue;
+		}
+		pthread_detach(thread);
+	}
+
+	close(sock);
+	spot_cache_destroy(&cache);
+	return 0;
+}
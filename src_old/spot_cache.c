@@ -0,0 +1,544 @@
+#include "spot_cache.h"
+#include "cfr.h"
+#include "parse.h"
+#include "hand_features.h"
+#include "preflop_equity.h"
+#include "strategy_export.h"
+#include "ex.h"
+
+#include <float.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+static double now_seconds() {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+static uint64_t fnv1a(uint64_t h, const void* data, size_t size) {
+	const unsigned char* p = (const unsigned char*)data;
+	for (size_t i = 0; i < size; i++) {
+		h ^= p[i];
+		h *= 0x100000001b3ull;
+	}
+	return h;
+}
+
+static uint64_t permute_mask(uint64_t mask, const int perm[4]) {
+	uint64_t out = 0;
+	for (int s = 0; s < 4; s++)
+		out |= ((mask >> (s * 16)) & 0x1FFF) << (perm[s] * 16);
+	return out;
+}
+
+//splits "k=v k=v" in place, tokens without '=' are skipped
+void spot_params_split(char* text, SpotParams* params) {
+	params->count = 0;
+	char* save;
+	char* tok = strtok_r(text, " \t\r\n", &save);
+	for (; tok && params->count < SPOT_MAX_PARAMS; tok = strtok_r(NULL, " \t\r\n", &save)) {
+		char* eq = strchr(tok, '=');
+		if (!eq)
+			continue;
+		*eq = 0;
+		params->keys[params->count] = tok;
+		params->values[params->count++] = eq + 1;
+	}
+}
+
+const char* spot_param(const SpotParams* params, const char* key, const char* fallback) {
+	for (int i = 0; i < params->count; i++)
+		if (strcmp(params->keys[i], key) == 0)
+			return params->values[i];
+	return fallback;
+}
+
+static int load_range(const char* spec, const char* fallback_json, float* weights) {
+	if (!spec)
+		return range_parse_json(fallback_json, weights);
+	if (range_load(spec, weights) > 0)
+		return 1;
+	for (int i = 0; i < RANGE_COMBOS; i++)
+		weights[i] = 0.0f;
+	return range_parse_expression(spec, 1.0f, weights) > 0 ? 1 : -1;
+}
+
+/*
+ * board=As8s2s pot=200 stacks=300,300 [p1=<range>] [p2=<range>] [target=0.5] [iters=1000]
+ *
+ * Ranges are range_load specs (JSON file, pack.bin:name) or omp::CardRange
+ * expressions, the built-in SB/BTN ranges by default. Returns NULL or what
+ * was wrong with the request.
+ */
+const char* spot_request_parse(const SpotParams* params, SpotRequest* req) {
+	memset(req, 0, sizeof(*req));
+	int cards[5];
+	int num_cards = parse_card_list(spot_param(params, "board", ""), cards, 5);
+	for (int i = 0; i < num_cards; i++)
+		req->board |= 1ULL << (cards[i] % 13 + (cards[i] / 13) * 16);
+
+	const char* stacks = spot_param(params, "stacks", "0");
+	req->pot = atoi(spot_param(params, "pot", "0"));
+	req->p1_stack = atoi(stacks);
+	req->p2_stack = strchr(stacks, ',') ? atoi(strchr(stacks, ',') + 1) : req->p1_stack;
+	req->target = (float)atof(spot_param(params, "target", "0.5"));
+	req->max_iterations = atoi(spot_param(params, "iters", "1000"));
+
+	if (num_cards < 3 || __builtin_popcountll(req->board) != num_cards)
+		return "bad board";
+	if (req->pot <= 0 || req->p1_stack < 0 || req->p2_stack < 0 || req->max_iterations <= 0)
+		return "bad pot, stacks or iters";
+	if (load_range(spot_param(params, "p1", NULL), sb, req->weights[0]) <= 0 ||
+	    load_range(spot_param(params, "p2", NULL), btn, req->weights[1]) <= 0)
+		return "bad range";
+	return NULL;
+}
+
+//carries the request onto its canonical board and hashes that
+uint64_t spot_hash(const SpotRequest* req, SpotRequest* out_canonical) {
+	int perm[4];
+	*out_canonical = *req;
+	out_canonical->board = canonical_board(req->board, perm);
+
+	int combo = 0;
+	for (int c1 = 0; c1 < 51; c1++) {
+		for (int c2 = c1 + 1; c2 < 52; c2++, combo++) {
+			int p1 = perm[c1 / 13] * 13 + c1 % 13;
+			int p2 = perm[c2 / 13] * 13 + c2 % 13;
+			if (p1 > p2) {
+				int t = p1; p1 = p2; p2 = t;
+			}
+			int image = p1 * (103 - p1) / 2 + (p2 - p1 - 1);
+			for (int k = 0; k < 2; k++)
+				out_canonical->weights[k][image] = req->weights[k][combo];
+		}
+	}
+
+	uint64_t h = 0xcbf29ce484222325ull;
+	h = fnv1a(h, &out_canonical->board, sizeof(uint64_t));
+	h = fnv1a(h, &req->pot, sizeof(int));
+	h = fnv1a(h, &req->p1_stack, sizeof(int));
+	h = fnv1a(h, &req->p2_stack, sizeof(int));
+	return fnv1a(h, out_canonical->weights, sizeof(out_canonical->weights));
+}
+
+void spot_cache_init(SpotCache* cache, size_t max_bytes, size_t arena_size) {
+	memset(cache, 0, sizeof(*cache));
+	pthread_mutex_init(&cache->lock, NULL);
+	cache->max_bytes = max_bytes;
+	cache->arena_size = arena_size;
+}
+
+//drops the tree, leaving the entry as spot_entry_build found it
+void spot_entry_clear(SpotEntry* e) {
+	if (e->arena.memory)
+		arena_free(&e->arena);
+	free(e->reach[0]);
+	free(e->reach[1]);
+	e->reach[0] = e->reach[1] = NULL;
+	e->root = NULL;
+	e->ready = 0;
+}
+
+static void free_entry(SpotEntry* e) {
+	spot_entry_clear(e);
+	pthread_mutex_destroy(&e->lock);
+	free(e);
+}
+
+static void unlink_entry(SpotCache* cache, SpotEntry* e) {
+	if (e->prev)
+		e->prev->next = e->next;
+	else
+		cache->head = e->next;
+	if (e->next)
+		e->next->prev = e->prev;
+	else
+		cache->tail = e->prev;
+	e->prev = e->next = NULL;
+}
+
+static void push_front(SpotCache* cache, SpotEntry* e) {
+	e->prev = NULL;
+	e->next = cache->head;
+	if (cache->head)
+		cache->head->prev = e;
+	cache->head = e;
+	if (!cache->tail)
+		cache->tail = e;
+}
+
+void spot_cache_destroy(SpotCache* cache) {
+	while (cache->head) {
+		SpotEntry* e = cache->head;
+		unlink_entry(cache, e);
+		free_entry(e);
+	}
+	pthread_mutex_destroy(&cache->lock);
+}
+
+//takes a reference, creating the entry if create is set and it isn't cached
+static SpotEntry* acquire(SpotCache* cache, uint64_t hash, int create) {
+	pthread_mutex_lock(&cache->lock);
+	SpotEntry* e = cache->head;
+	while (e && e->hash != hash)
+		e = e->next;
+
+	if (e) {
+		unlink_entry(cache, e);
+		push_front(cache, e);
+		e->refs++;
+		cache->hits += create;
+	} else if (create) {
+		e = (SpotEntry*)calloc(1, sizeof(SpotEntry));
+		e->hash = hash;
+		e->refs = 1;
+		pthread_mutex_init(&e->lock, NULL);
+		push_front(cache, e);
+		cache->num_entries++;
+		cache->misses++;
+	}
+	pthread_mutex_unlock(&cache->lock);
+	return e;
+}
+
+/*
+ * Drops the reference and evicts from the cold end until the trees fit
+ * again. An entry that never got its tree goes as soon as nobody holds it.
+ */
+static void release(SpotCache* cache, SpotEntry* e, size_t bytes) {
+	pthread_mutex_lock(&cache->lock);
+	cache->bytes += bytes - e->bytes;
+	e->bytes = bytes;
+	e->refs--;
+	if (!e->ready && e->refs == 0) {
+		unlink_entry(cache, e);
+		cache->bytes -= e->bytes;
+		cache->num_entries--;
+		free_entry(e);
+	}
+
+	SpotEntry* victim = cache->tail;
+	while (victim && cache->bytes > cache->max_bytes) {
+		SpotEntry* prev = victim->prev;
+		if (victim->refs == 0) {
+			unlink_entry(cache, victim);
+			cache->bytes -= victim->bytes;
+			cache->num_entries--;
+			free_entry(victim);
+		}
+		victim = prev;
+	}
+	pthread_mutex_unlock(&cache->lock);
+}
+
+static size_t entry_bytes(const SpotEntry* e) {
+	return e->ready ? e->arena.offset + 2 * e->num_variants * e->map.padded_buckets * sizeof(float) : 0;
+}
+
+static GameState spot_state(const SpotRequest* req) {
+	GameState state = {0};
+	state.board = req->board;
+	state.pot = req->pot;
+	state.p1_stack = req->p1_stack;
+	state.p2_stack = req->p2_stack;
+	state.street = __builtin_popcountll(req->board) - 3;
+	return state;
+}
+
+//the arena spot_entry_build needs for the spot's tree, see estimate_public_tree
+size_t spot_tree_bytes(const SpotRequest* req, int num_variants) {
+	IsoMap map;
+	TreeStats stats;
+	build_isomorphism_map(req->board, &map);
+	estimate_public_tree(spot_state(req), map.padded_buckets * num_variants, &stats);
+	return stats.bytes;
+}
+
+/*
+ * Builds the tree of canon[0] with room for num_variants range variants
+ * (cfr.h), one per request. The others only bring their weights, they're
+ * meant to share the board, pot and stacks. arena_size has to be at least
+ * spot_tree_bytes, arena_alloc exits on overflow.
+ */
+void spot_entry_build(SpotEntry* e, const SpotRequest* const* canon, int num_variants, size_t arena_size) {
+	build_isomorphism_map(canon[0]->board, &e->map);
+	int stride = e->map.padded_buckets;
+	int num_buckets = stride * num_variants;
+
+	GameState state = spot_state(canon[0]);
+	e->state = state;
+
+	arena_init(&e->arena, arena_size);
+	e->root = build_public_tree(&e->arena, state, num_buckets);
+	for (int k = 0; k < 2; k++) {
+		e->reach[k] = (float*)malloc(num_buckets * sizeof(float));
+		for (int v = 0; v < num_variants; v++)
+			range_to_buckets(canon[v]->weights[k], &e->map, e->reach[k] + v * stride);
+	}
+	e->num_variants = num_variants;
+	e->iterations = 0;
+	e->exploitability = FLT_MAX;
+	for (int v = 0; v < num_variants; v++)
+		e->variant_exploitability[v] = FLT_MAX;
+	e->ready = 1;
+}
+
+/*
+ * Iterates a built entry until the exploitability of every variant is
+ * within target % of the pot or the tree has had max_iterations. Checked
+ * every 10 iterations, with the same discounting as main2.c. The estimate
+ * is calc_exploitability per hand pair. A best response gap is never
+ * negative, so a negative estimate is float error around 0 and counts as 0.
+ */
+void spot_entry_solve(SpotEntry* e, float target, int max_iterations) {
+	int stride = e->map.padded_buckets;
+	int num_buckets = stride * e->num_variants;
+
+	//calc_exploitability sums over both reach vectors, per hand pair is chips
+	float mass[SPOT_MAX_VARIANTS];
+	for (int v = 0; v < e->num_variants; v++) {
+		float mass1 = 0.0f, mass2 = 0.0f;
+		for (int b = v * stride; b < (v + 1) * stride; b++) {
+			mass1 += e->reach[0][b];
+			mass2 += e->reach[1][b];
+		}
+		mass[v] = (mass1 > 0.0f && mass2 > 0.0f) ? mass1 * mass2 : 1.0f;
+	}
+
+	while (e->iterations < max_iterations && e->exploitability > target) {
+		int chunk = max_iterations - e->iterations;
+		if (chunk > 10)
+			chunk = 10;
+		for (int i = 0; i < chunk; i++) {
+			do_cfr_iteration(e->root, e->state, &e->map, num_buckets, e->reach[0], e->reach[1]);
+			discount_tree(e->root, num_buckets, ++e->iterations, 1.5f, 0.5f, 2.0f);
+		}
+
+		float chips[SPOT_MAX_VARIANTS];
+		calc_exploitability_variants(e->root, e->state, &e->map, num_buckets, e->reach[0], e->reach[1], chips);
+		e->exploitability = 0.0f;
+		for (int v = 0; v < e->num_variants; v++) {
+			e->variant_exploitability[v] = fmaxf(chips[v] / mass[v], 0.0f) / (float)e->state.pot * 100.0f;
+			e->exploitability = fmaxf(e->exploitability, e->variant_exploitability[v]);
+		}
+	}
+}
+
+/*
+ * Solves the spot, or picks up its cached tree, see spot_entry_solve.
+ * Returns 1, or SPOT_ERR_TOO_LARGE without building anything if the tree
+ * needs more than the cache's arena_size.
+ */
+int spot_cache_solve(SpotCache* cache, const SpotRequest* req, SpotResult* out) {
+	SpotRequest* canon = (SpotRequest*)malloc(sizeof(SpotRequest));
+	uint64_t hash = spot_hash(req, canon);
+	double start = now_seconds();
+
+	SpotEntry* e = acquire(cache, hash, 1);
+	pthread_mutex_lock(&e->lock);
+
+	out->cached = e->ready;
+	if (!e->ready) {
+		size_t arena_size = spot_tree_bytes(canon, 1);
+		if (arena_size > cache->arena_size) {
+			pthread_mutex_unlock(&e->lock);
+			release(cache, e, 0);
+			free(canon);
+			return SPOT_ERR_TOO_LARGE;
+		}
+		const SpotRequest* variants[1] = { canon };
+		spot_entry_build(e, variants, 1, arena_size);
+	}
+	spot_entry_solve(e, req->target, req->max_iterations);
+
+	out->hash = hash;
+	out->iterations = e->iterations;
+	out->exploitability = e->exploitability;
+	out->seconds = now_seconds() - start;
+	size_t bytes = entry_bytes(e);
+	pthread_mutex_unlock(&e->lock);
+
+	release(cache, e, bytes);
+	free(canon);
+	return 1;
+}
+
+/*
+ * Answers a solve from the cache alone: 1 with out filled if the spot's
+ * tree is there and already has req's target or iteration cap, 0 if it
+ * needs spot_cache_solve. Never iterates, but waits for a solve of the
+ * same spot that's running.
+ */
+int spot_cache_lookup(SpotCache* cache, const SpotRequest* req, SpotResult* out) {
+	SpotRequest* canon = (SpotRequest*)malloc(sizeof(SpotRequest));
+	uint64_t hash = spot_hash(req, canon);
+	free(canon);
+	double start = now_seconds();
+
+	SpotEntry* e = acquire(cache, hash, 0);
+	if (!e)
+		return 0;
+	pthread_mutex_lock(&e->lock);
+	int done = e->ready && (e->iterations >= req->max_iterations || e->exploitability <= req->target);
+	if (done) {
+		out->cached = 1;
+		out->hash = hash;
+		out->iterations = e->iterations;
+		out->exploitability = e->exploitability;
+		out->seconds = now_seconds() - start;
+	}
+	size_t bytes = entry_bytes(e);
+	pthread_mutex_unlock(&e->lock);
+
+	if (done) {
+		pthread_mutex_lock(&cache->lock);
+		cache->hits++;
+		pthread_mutex_unlock(&cache->lock);
+	}
+	release(cache, e, bytes);
+	return done;
+}
+
+static void action_token(GameState* state, int amount, char* buf) {
+	int facing_bet = (state->active_player == 0) ?
+		state->p2_commit - state->p1_commit :
+		state->p1_commit - state->p2_commit;
+
+	if (amount == -1)
+		snprintf(buf, 16, "f");
+	else if (amount == 0)
+		snprintf(buf, 16, facing_bet > 0 ? "c" : "x");
+	else
+		snprintf(buf, 16, "%c%d", facing_bet > 0 ? 'r' : 'b', amount);
+}
+
+//deals a real card at a chance node, NULL if the tree has no such deal
+static PublicNode* deal(PublicNode* node, GameState* state, StrategyCursor* c, int card) {
+	uint64_t before = c->board;
+	if (node->type != NODE_CHANCE || !strategy_cursor_deal(c, card))
+		return NULL;
+
+	int bit = __builtin_ctzll(c->board & ~before);
+	int canonical = (bit / 16) * 13 + bit % 16;
+	for (int i = 0; i < node->num_children; i++) {
+		if (node->dealt_cards[i] == canonical) {
+			*state = apply_deal(*state, canonical);
+			return node->children[i];
+		}
+	}
+	return NULL;
+}
+
+/*
+ * Follows line (strategy_file.h tokens, cards optional, see tfq_find_node)
+ * from the root of a cached spot and gives the average strategy of hand at
+ * the node it ends at, with the action tokens as labels. board is the real
+ * board, any suit permutation of the solved one plus the later cards.
+ * Returns the number of actions or a SPOT_ERR code.
+ */
+int spot_cache_query(SpotCache* cache, uint64_t hash, const char* board, const char* line, const char* hand,
+		char labels[][16], float* out_probs) {
+	SpotEntry* e = acquire(cache, hash, 0);
+	if (!e)
+		return SPOT_ERR_UNKNOWN;
+	pthread_mutex_lock(&e->lock);
+
+	int result = SPOT_ERR_BOARD;
+	int cards[5];
+	int num_cards = parse_card_list(board, cards, 5);
+	int root_cards = __builtin_popcountll(e->state.board);
+	uint64_t real_board = 0;
+	for (int i = 0; i < num_cards && i < root_cards; i++)
+		real_board |= 1ULL << (cards[i] % 13 + (cards[i] / 13) * 16);
+
+	StrategyCursor c;
+	c.board = e->state.board;
+	if (e->ready && num_cards >= root_cards && canonical_board(real_board, c.perm) == e->state.board) {
+		PublicNode* node = e->root;
+		GameState state = e->state;
+		int next = root_cards, type = 0, value;
+
+		result = SPOT_ERR_LINE;
+		while (node && (type = strategy_line_token(&line, &value)) > 0) {
+			if (type == STRATEGY_TOKEN_CARD || node->type == NODE_CHANCE) {
+				int card = (type == STRATEGY_TOKEN_CARD) ? value : (next < num_cards ? cards[next] : -1);
+				if (card < 0 || (next < num_cards && cards[next] != card)) {
+					node = NULL;
+					break;
+				}
+				next++;
+				real_board |= 1ULL << (card % 13 + (card / 13) * 16);
+				node = deal(node, &state, &c, card);
+			}
+			if (node && type == STRATEGY_TOKEN_ACTION) {
+				int actions[8];
+				int num_actions = (node->type == NODE_ACTION) ? generate_bet_sizes(&state, actions) : 0;
+				int a = 0;
+				while (a < num_actions && actions[a] != value)
+					a++;
+				if (a == num_actions) {
+					node = NULL;
+					break;
+				}
+				state = apply_bet(state, value);
+				node = node->children[a];
+			}
+		}
+		while (node && node->type == NODE_CHANCE && next < num_cards) {
+			int card = cards[next++];
+			real_board |= 1ULL << (card % 13 + (card / 13) * 16);
+			node = deal(node, &state, &c, card);
+		}
+
+		uint64_t hand_mask = parse_hole_cards(hand);
+		if (node && node->type == NODE_ACTION && type == 0) {
+			result = SPOT_ERR_HAND;
+			int combo = (!hand_mask || (hand_mask & real_board)) ? -1 : preflop_combo_index(permute_mask(hand_mask, c.perm));
+			int bucket = (combo >= 0) ? e->map.combo_to_bucket[combo] : -1;
+			if (bucket >= 0) {
+				int num_buckets = e->map.padded_buckets;
+				int actions[8];
+				int num_actions = generate_bet_sizes(&state, actions);
+				float sum = 0.0f;
+				for (int a = 0; a < num_actions; a++)
+					sum += node->strategy_sum[a * num_buckets + bucket];
+				for (int a = 0; a < num_actions; a++) {
+					out_probs[a] = (sum > 0.0f) ? node->strategy_sum[a * num_buckets + bucket] / sum : 1.0f / num_actions;
+					action_token(&state, actions[a], labels[a]);
+				}
+				result = num_actions;
+			}
+		}
+	}
+
+	size_t bytes = entry_bytes(e);
+	pthread_mutex_unlock(&e->lock);
+	release(cache, e, bytes);
+	return result;
+}
+
+//writes the cached tree as a strategy file (strategy_file.h) with node values, on the canonical board
+int spot_cache_export(SpotCache* cache, uint64_t hash, const char* path, int quant_bits) {
+	SpotEntry* e = acquire(cache, hash, 0);
+	if (!e)
+		return SPOT_ERR_UNKNOWN;
+
+	pthread_mutex_lock(&e->lock);
+	int ok = 0;
+	if (e->ready) {
+		//values go stale as soon as the tree iterates again, so they're only kept for the write
+		calc_node_values(e->root, e->state, &e->map, e->map.padded_buckets, e->reach[0], e->reach[1]);
+		ok = strategy_file_write(path, e->root, e->state, &e->map, quant_bits);
+		free_node_values(e->root);
+	}
+	size_t bytes = entry_bytes(e);
+	pthread_mutex_unlock(&e->lock);
+
+	release(cache, e, bytes);
+	return ok;
+}
@@ -0,0 +1,111 @@
+#ifndef SPOT_CACHE_H
+#define SPOT_CACHE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <pthread.h>
+
+#include "tree.h"
+#include "indexer.h"
+#include "range_loader.h"
+
+/*
+ * Solved trees kept in memory by solve_daemon, least recently used first
+ * out once their arenas add up to more than max_bytes.
+ *
+ * Spots are solved on the canonical board (canonical_board() in
+ * hand_features.h) with both ranges carried through the same suit
+ * permutation, and keyed by the hash of that canonical spot, so a spot and
+ * any suit permutation of it share one tree. Asking for a tighter target
+ * than a cached tree reached keeps iterating that tree.
+ */
+enum {
+	SPOT_ERR_UNKNOWN = -1,    //no cached tree with that hash
+	SPOT_ERR_BOARD = -2,      //not a suit permutation of the solved board
+	SPOT_ERR_LINE = -3,
+	SPOT_ERR_HAND = -4,
+	SPOT_ERR_TOO_LARGE = -5   //the tree needs more than arena_size
+};
+
+typedef struct {
+	uint64_t board;
+	int pot;
+	int p1_stack;
+	int p2_stack;
+	float weights[2][RANGE_COMBOS];   //P1 (OOP), P2
+	float target;                     //exploitability to reach, % of the pot (see spot_cache_solve)
+	int max_iterations;
+} SpotRequest;
+
+typedef struct {
+	uint64_t hash;
+	int iterations;
+	float exploitability;             //% of the pot
+	double seconds;                   //spent on this request
+	int cached;                       //1 if the tree was already there
+} SpotResult;
+
+//range variants one entry can solve together (cfr.h)
+#define SPOT_MAX_VARIANTS 16
+
+//"key=value" fields of a request line, see spot_request_parse
+#define SPOT_MAX_PARAMS 16
+typedef struct {
+	const char* keys[SPOT_MAX_PARAMS];
+	const char* values[SPOT_MAX_PARAMS];
+	int count;
+} SpotParams;
+
+typedef struct SpotEntry {
+	uint64_t hash;
+	int refs;                         //requests using it, never evicted while > 0
+	int ready;
+	pthread_mutex_t lock;             //held while solving or reading the tree
+
+	Arena arena;
+	PublicNode* root;
+	GameState state;
+	IsoMap map;
+	int num_variants;                 //1 in the cache
+	float* reach[2];                  //num_variants * map.padded_buckets
+	int iterations;
+	float exploitability;             //the worst variant's
+	float variant_exploitability[SPOT_MAX_VARIANTS];
+	size_t bytes;
+
+	struct SpotEntry* prev;
+	struct SpotEntry* next;
+} SpotEntry;
+
+typedef struct {
+	pthread_mutex_t lock;
+	SpotEntry* head;                  //most recently used
+	SpotEntry* tail;
+	int num_entries;
+	size_t bytes;
+	size_t max_bytes;
+	size_t arena_size;                //largest arena a tree may have
+	uint64_t hits;
+	uint64_t misses;
+} SpotCache;
+
+void spot_params_split(char* text, SpotParams* params);
+const char* spot_param(const SpotParams* params, const char* key, const char* fallback);
+const char* spot_request_parse(const SpotParams* params, SpotRequest* req);
+
+uint64_t spot_hash(const SpotRequest* req, SpotRequest* out_canonical);
+size_t spot_tree_bytes(const SpotRequest* req, int num_variants);
+void spot_entry_build(SpotEntry* e, const SpotRequest* const* canon, int num_variants, size_t arena_size);
+void spot_entry_solve(SpotEntry* e, float target, int max_iterations);
+void spot_entry_clear(SpotEntry* e);
+
+void spot_cache_init(SpotCache* cache, size_t max_bytes, size_t arena_size);
+void spot_cache_destroy(SpotCache* cache);
+
+int spot_cache_solve(SpotCache* cache, const SpotRequest* req, SpotResult* out);
+int spot_cache_lookup(SpotCache* cache, const SpotRequest* req, SpotResult* out);
+int spot_cache_query(SpotCache* cache, uint64_t hash, const char* board, const char* line, const char* hand,
+	char labels[][16], float* out_probs);
+int spot_cache_export(SpotCache* cache, uint64_t hash, const char* path, int quant_bits);
+
+#endif //SPOT_CACHE_H
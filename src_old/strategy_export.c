@@ -0,0 +1,268 @@
+#include "strategy_export.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define LINE_MAX_LEN 512
+
+typedef struct {
+	StrategyNode* nodes;
+	PublicNode** sources;
+	size_t count;
+	size_t capacity;
+
+	char* lines;
+	size_t lines_len;
+	size_t lines_capacity;
+
+	uint64_t data_size;
+	int row_bytes;    //per action, 1 or 2
+	int num_buckets;
+	int failed;
+} Export;
+
+static void append_token(char* line, int* len, const char* token) {
+	int n = snprintf(line + *len, LINE_MAX_LEN - *len, *len ? " %s" : "%s", token);
+	if (n > 0 && *len + n < LINE_MAX_LEN)
+		*len += n;
+}
+
+static uint32_t add_node(Export* ex, PublicNode* node, GameState* state, uint64_t key, uint32_t parent, const char* line) {
+	if (ex->count == ex->capacity) {
+		ex->capacity = ex->capacity ? ex->capacity * 2 : 1024;
+		ex->nodes = (StrategyNode*)realloc(ex->nodes, ex->capacity * sizeof(StrategyNode));
+		ex->sources = (PublicNode**)realloc(ex->sources, ex->capacity * sizeof(PublicNode*));
+	}
+
+	size_t line_len = strlen(line) + 1;
+	while (ex->lines_len + line_len > ex->lines_capacity) {
+		ex->lines_capacity = ex->lines_capacity ? ex->lines_capacity * 2 : 65536;
+		ex->lines = (char*)realloc(ex->lines, ex->lines_capacity);
+	}
+
+	StrategyNode* out = &ex->nodes[ex->count];
+	memset(out, 0, sizeof(*out));
+	out->key = key;
+	out->board = state->board;
+	out->data_offset = ex->data_size;
+	out->parent = parent;
+	out->line_offset = (uint32_t)ex->lines_len;
+	out->pot = state->pot;
+	out->p1_stack = state->p1_stack;
+	out->p2_stack = state->p2_stack;
+	out->to_call = (state->active_player == 0) ? state->p2_commit - state->p1_commit : state->p1_commit - state->p2_commit;
+	out->player = node->active_player;
+	out->street = state->street;
+	out->num_actions = node->num_children;
+	generate_bet_sizes(state, out->actions);
+
+	memcpy(ex->lines + ex->lines_len, line, line_len);
+	ex->lines_len += line_len;
+	ex->sources[ex->count] = node;
+	ex->data_size += (uint64_t)ex->num_buckets * node->num_children * ex->row_bytes;
+	return (uint32_t)ex->count++;
+}
+
+static void collect(Export* ex, PublicNode* node, GameState state, uint64_t key, uint32_t parent, char* line, int len) {
+	static const char ranks[] = "23456789TJQKA";
+	static const char suits[] = "shdc";
+
+	if (node->type == NODE_TERMINAL || node->type == NODE_LEAF)
+		return;
+
+	if (node->type == NODE_CHANCE) {
+		for (int i = 0; i < node->num_children; i++) {
+			int card = node->dealt_cards[i];
+			char token[3] = { ranks[card % 13], suits[card / 13], 0 };
+			int child_len = len;
+			append_token(line, &child_len, token);
+			collect(ex, node->children[i], apply_deal(state, card), strategy_key_deal(key, card), parent, line, child_len);
+			line[len] = 0;
+		}
+		return;
+	}
+
+	uint32_t id = add_node(ex, node, &state, key, parent, line);
+	int to_call = ex->nodes[id].to_call;
+	int actions[STRATEGY_MAX_ACTIONS];
+	memcpy(actions, ex->nodes[id].actions, sizeof(actions));
+
+	for (int a = 0; a < node->num_children; a++) {
+		char token[16];
+		if (actions[a] == -1)
+			snprintf(token, sizeof(token), "f");
+		else if (actions[a] == 0)
+			snprintf(token, sizeof(token), to_call > 0 ? "c" : "x");
+		else
+			snprintf(token, sizeof(token), "%c%d", to_call > 0 ? 'r' : 'b', actions[a]);
+
+		int child_len = len;
+		append_token(line, &child_len, token);
+		collect(ex, node->children[a], apply_bet(state, actions[a]), strategy_key_action(key, actions[a]), id, line, child_len);
+		line[len] = 0;
+	}
+}
+
+/*
+ * Average strategy rows of a node, bucket major. Each row is rounded so
+ * it sums to exactly max: floors first, then the leftover units go to the
+ * largest remainders.
+ */
+static void quantize_node(const PublicNode* node, int row_width, int offset, int num_buckets, uint32_t max, void* out, int row_bytes) {
+	int num_actions = node->num_children;
+	const float* strategy_sum = node->strategy_sum + offset;
+	for (int b = 0; b < num_buckets; b++) {
+		float sum = 0.0f;
+		for (int a = 0; a < num_actions; a++)
+			sum += strategy_sum[a * row_width + b];
+
+		uint32_t q[STRATEGY_MAX_ACTIONS];
+		float frac[STRATEGY_MAX_ACTIONS];
+		uint32_t total = 0;
+		for (int a = 0; a < num_actions; a++) {
+			float p = (sum > 0.0f) ? strategy_sum[a * row_width + b] / sum : 1.0f / num_actions;
+			float scaled = p * (float)max;
+			q[a] = (uint32_t)scaled;
+			if (q[a] > max)
+				q[a] = max;
+			frac[a] = scaled - (float)q[a];
+			total += q[a];
+		}
+		while (total < max) {
+			int best = 0;
+			for (int a = 1; a < num_actions; a++)
+				if (frac[a] > frac[best])
+					best = a;
+			q[best]++;
+			frac[best] = -1.0f;
+			total++;
+		}
+
+		for (int a = 0; a < num_actions; a++) {
+			size_t i = (size_t)b * num_actions + a;
+			if (row_bytes == 2)
+				((uint16_t*)out)[i] = (uint16_t)q[a];
+			else
+				((uint8_t*)out)[i] = (uint8_t)q[a];
+		}
+	}
+}
+
+static int write_at(FILE* f, uint64_t offset, const void* data, size_t size) {
+	return fseek(f, (long)offset, SEEK_SET) == 0 && fwrite(data, 1, size, f) == size;
+}
+
+//heap strategy_file_write_variant needs at most for a tree of num_nodes action nodes (TreeStats::action_nodes)
+size_t strategy_file_write_bytes(size_t num_nodes, const IsoMap* map, int quant_bits) {
+	size_t table_size = 16;
+	while (table_size < num_nodes * 2)
+		table_size *= 2;
+	//node, source and line arrays grow by doubling
+	return 2 * num_nodes * (sizeof(StrategyNode) + sizeof(PublicNode*) + LINE_MAX_LEN) + table_size * sizeof(uint32_t) +
+		sizeof(StrategyFileHeader) + (size_t)map->num_unique_buckets * (STRATEGY_MAX_ACTIONS * quant_bits / 8 + 4 * sizeof(float));
+}
+
+/*
+ * Exports every action node of the tree rooted at root_state. Nodes keep
+ * their depth first order, the root being node 0, and rows follow the
+ * buckets of map (the IsoMap the tree was solved with). Node values go in
+ * too if calc_node_values has filled them.
+ */
+int strategy_file_write(const char* path, PublicNode* root, GameState root_state, const IsoMap* map, int quant_bits) {
+	return strategy_file_write_variant(path, root, root_state, map, quant_bits, 0, 1);
+}
+
+//the same for one of num_variants range variants solved in one tree (cfr.h)
+int strategy_file_write_variant(const char* path, PublicNode* root, GameState root_state, const IsoMap* map, int quant_bits,
+		int variant, int num_variants) {
+	if ((quant_bits != 8 && quant_bits != 16) || variant < 0 || variant >= num_variants)
+		return 0;
+
+	Export ex = {0};
+	ex.row_bytes = quant_bits / 8;
+	ex.num_buckets = map->num_unique_buckets;
+
+	char line[LINE_MAX_LEN] = {0};
+	collect(&ex, root, root_state, STRATEGY_ROOT_KEY, STRATEGY_NO_PARENT, line, 0);
+
+	uint32_t table_size = 16;
+	while (table_size < ex.count * 2)
+		table_size *= 2;
+	uint32_t* table = (uint32_t*)calloc(table_size, sizeof(uint32_t));
+	int ok = 1;
+	for (size_t i = 0; i < ex.count && ok; i++) {
+		uint32_t slot = (uint32_t)ex.nodes[i].key & (table_size - 1);
+		for (; table[slot]; slot = (slot + 1) & (table_size - 1))
+			if (ex.nodes[table[slot] - 1].key == ex.nodes[i].key)
+				ok = 0;    //two lines with the same 64 bit key
+		table[slot] = (uint32_t)i + 1;
+	}
+
+	StrategyFileHeader* header = (StrategyFileHeader*)calloc(1, sizeof(StrategyFileHeader));
+	header->magic = STRATEGY_FILE_MAGIC;
+	header->version = STRATEGY_FILE_VERSION;
+	header->quant_bits = (uint8_t)quant_bits;
+	header->num_nodes = (uint32_t)ex.count;
+	header->num_buckets = (uint32_t)ex.num_buckets;
+	header->table_size = table_size;
+	header->root_board = root_state.board;
+	header->pot = root_state.pot;
+	header->p1_stack = root_state.p1_stack;
+	header->p2_stack = root_state.p2_stack;
+	for (int i = 0; i < 1326; i++)
+		header->combo_to_bucket[i] = (int16_t)map->combo_to_bucket[i];
+
+	header->nodes_offset = sizeof(StrategyFileHeader);
+	header->table_offset = header->nodes_offset + ex.count * sizeof(StrategyNode);
+	header->lines_offset = header->table_offset + (uint64_t)table_size * sizeof(uint32_t);
+	header->data_offset = (header->lines_offset + ex.lines_len + 63) & ~63ull;
+	header->file_size = header->data_offset + ex.data_size;
+	size_t values_size = (size_t)4 * ex.num_buckets * sizeof(float);
+	if (root->values) {
+		header->values_offset = (header->file_size + 63) & ~63ull;
+		header->file_size = header->values_offset + ex.count * values_size;
+	}
+
+	for (size_t i = 0; i < ex.count; i++)
+		ex.nodes[i].data_offset += header->data_offset;
+
+	FILE* f = ok ? fopen(path, "wb") : NULL;
+	ok = f != NULL;
+	if (ok) {
+		ok = write_at(f, 0, header, sizeof(*header)) &&
+		     write_at(f, header->nodes_offset, ex.nodes, ex.count * sizeof(StrategyNode)) &&
+		     write_at(f, header->table_offset, table, (size_t)table_size * sizeof(uint32_t)) &&
+		     write_at(f, header->lines_offset, ex.lines, ex.lines_len);
+
+		void* rows = malloc((size_t)ex.num_buckets * STRATEGY_MAX_ACTIONS * ex.row_bytes);
+		uint32_t max = (1u << quant_bits) - 1;
+		for (size_t i = 0; i < ex.count && ok; i++) {
+			size_t size = (size_t)ex.num_buckets * ex.nodes[i].num_actions * ex.row_bytes;
+			quantize_node(ex.sources[i], map->padded_buckets * num_variants, map->padded_buckets * variant, ex.num_buckets,
+				max, rows, ex.row_bytes);
+			ok = write_at(f, ex.nodes[i].data_offset, rows, size);
+		}
+		free(rows);
+
+		float* values = (float*)malloc(values_size);
+		for (size_t i = 0; i < ex.count && ok && header->values_offset; i++) {
+			const float* src = ex.sources[i]->values;
+			int row_width = map->padded_buckets * num_variants;
+			for (int r = 0; r < 4; r++)
+				for (int b = 0; b < ex.num_buckets; b++)
+					values[r * ex.num_buckets + b] = src ? src[r * row_width + map->padded_buckets * variant + b] : NAN;
+			ok = write_at(f, header->values_offset + i * values_size, values, values_size);
+		}
+		free(values);
+		ok = (fclose(f) == 0) && ok;
+	}
+
+	free(header);
+	free(table);
+	free(ex.nodes);
+	free(ex.sources);
+	free(ex.lines);
+	return ok;
+}
@@ -0,0 +1,14 @@
+#ifndef STRATEGY_EXPORT_H
+#define STRATEGY_EXPORT_H
+
+#include "tree.h"
+#include "indexer.h"
+#include "strategy_file.h"
+
+//quant_bits is 8 or 16, returns 0 if the file couldn't be written
+int strategy_file_write(const char* path, PublicNode* root, GameState root_state, const IsoMap* map, int quant_bits);
+int strategy_file_write_variant(const char* path, PublicNode* root, GameState root_state, const IsoMap* map, int quant_bits,
+	int variant, int num_variants);
+size_t strategy_file_write_bytes(size_t num_nodes, const IsoMap* map, int quant_bits);
+
+#endif //STRATEGY_EXPORT_H
@@ -0,0 +1,293 @@
+#include "strategy_file.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+//offset + length inside a file of size bytes, without overflowing
+static int section_fits(uint64_t offset, uint64_t length, uint64_t size) {
+	return offset <= size && length <= size - offset;
+}
+
+/*
+ * Everything the lookups read has to lie inside the file: the sections,
+ * each node's rows and line, the table slots and the root buckets. A file
+ * failing any of it is rejected rather than trusted.
+ */
+static int strategy_file_valid(const StrategyFileHeader* header, size_t size) {
+	const uint8_t* base = (const uint8_t*)header;
+	uint64_t num_nodes = header->num_nodes, num_buckets = header->num_buckets;
+	if (header->magic != STRATEGY_FILE_MAGIC || header->version != STRATEGY_FILE_VERSION ||
+	    (header->quant_bits != 8 && header->quant_bits != 16) || header->file_size != size ||
+	    header->table_size == 0 || (header->table_size & (header->table_size - 1)) != 0 ||
+	    num_buckets == 0 || num_buckets > 1326)
+		return 0;
+
+	if (header->nodes_offset % 8 || header->table_offset % 4 || header->values_offset % 4 ||
+	    !section_fits(header->nodes_offset, num_nodes * sizeof(StrategyNode), size) ||
+	    !section_fits(header->table_offset, (uint64_t)header->table_size * sizeof(uint32_t), size) ||
+	    header->lines_offset > header->data_offset || header->data_offset > size ||
+	    (header->values_offset && !section_fits(header->values_offset, num_nodes * 4 * num_buckets * sizeof(float), size)))
+		return 0;
+
+	for (int i = 0; i < 1326; i++)
+		if (header->combo_to_bucket[i] < -1 || header->combo_to_bucket[i] >= (int64_t)num_buckets)
+			return 0;
+
+	const uint32_t* table = (const uint32_t*)(base + header->table_offset);
+	for (uint32_t slot = 0; slot < header->table_size; slot++)
+		if (table[slot] > num_nodes)
+			return 0;
+
+	const StrategyNode* nodes = (const StrategyNode*)(base + header->nodes_offset);
+	const char* lines = (const char*)base + header->lines_offset;
+	uint64_t lines_len = header->data_offset - header->lines_offset;
+	uint64_t row_bytes = header->quant_bits / 8;
+	for (uint64_t i = 0; i < num_nodes; i++) {
+		const StrategyNode* node = &nodes[i];
+		if (node->num_actions == 0 || node->num_actions > STRATEGY_MAX_ACTIONS ||
+		    (node->parent != STRATEGY_NO_PARENT && node->parent >= num_nodes) ||
+		    !section_fits(node->data_offset, num_buckets * node->num_actions * row_bytes, size) ||
+		    node->line_offset >= lines_len || !memchr(lines + node->line_offset, 0, lines_len - node->line_offset))
+			return 0;
+	}
+	return 1;
+}
+
+int strategy_file_load(const char* path, StrategyFile* out) {
+	int fd = open(path, O_RDONLY);
+	if (fd < 0)
+		return 0;
+
+	struct stat st;
+	if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(StrategyFileHeader)) {
+		close(fd);
+		return 0;
+	}
+
+	size_t size = (size_t)st.st_size;
+	void* map = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (map == MAP_FAILED)
+		return 0;
+
+	const StrategyFileHeader* header = (const StrategyFileHeader*)map;
+	if (!strategy_file_valid(header, size)) {
+		munmap(map, size);
+		return 0;
+	}
+
+	out->map = map;
+	out->map_size = size;
+	out->header = header;
+	out->nodes = (const StrategyNode*)((const uint8_t*)map + header->nodes_offset);
+	out->table = (const uint32_t*)((const uint8_t*)map + header->table_offset);
+	out->lines = (const char*)map + header->lines_offset;
+	out->scale = 1.0f / (float)((1u << header->quant_bits) - 1);
+	return 1;
+}
+
+void strategy_file_free(StrategyFile* sf) {
+	if (sf->map)
+		munmap(sf->map, sf->map_size);
+	sf->map = NULL;
+	sf->header = NULL;
+	sf->nodes = NULL;
+	sf->table = NULL;
+	sf->lines = NULL;
+}
+
+static int rank_of(char c) {
+	const char* ranks = "23456789TJQKA";
+	const char* p = (c >= 'a' && c <= 'z') ? strchr(ranks, c - 'a' + 'A') : strchr(ranks, c);
+	return (c && p) ? (int)(p - ranks) : -1;
+}
+
+static int suit_of(char c) {
+	switch (c) {
+	case 's': case 'S': return 0;
+	case 'h': case 'H': return 1;
+	case 'd': case 'D': return 2;
+	case 'c': case 'C': return 3;
+	}
+	return -1;
+}
+
+/*
+ * Reads the next token of a line: STRATEGY_TOKEN_ACTION with the amount
+ * (-1 fold, 0 check/call) or STRATEGY_TOKEN_CARD with the card, suit * 13
+ * + rank. Returns 0 at the end of the line, -1 on anything else.
+ */
+int strategy_line_token(const char** line, int* value) {
+	const char* p = *line;
+	while (*p == ' ' || *p == ',' || *p == '/' || *p == '\t')
+		p++;
+	if (!*p)
+		return 0;
+
+	const char* start = p;
+	while (*p && *p != ' ' && *p != ',' && *p != '/' && *p != '\t')
+		p++;
+	int len = (int)(p - start);
+	*line = p;
+
+	if (len == 2 && rank_of(start[0]) >= 0 && suit_of(start[1]) >= 0) {
+		*value = suit_of(start[1]) * 13 + rank_of(start[0]);
+		return STRATEGY_TOKEN_CARD;
+	}
+	if (len == 1 && (*start == 'x' || *start == 'k' || *start == 'c')) {
+		*value = 0;
+		return STRATEGY_TOKEN_ACTION;
+	}
+	if (len == 1 && *start == 'f') {
+		*value = -1;
+		return STRATEGY_TOKEN_ACTION;
+	}
+	if (len > 1 && (*start == 'b' || *start == 'r')) {
+		int amount = 0;
+		for (const char* d = start + 1; d < p; d++) {
+			if (*d < '0' || *d > '9')
+				return -1;
+			amount = amount * 10 + (*d - '0');
+		}
+		*value = amount;
+		return STRATEGY_TOKEN_ACTION;
+	}
+	return -1;
+}
+
+void strategy_cursor_init(const StrategyFile* sf, StrategyCursor* c) {
+	c->key = STRATEGY_ROOT_KEY;
+	c->board = sf->header->root_board;
+	for (int s = 0; s < 4; s++)
+		c->perm[s] = s;
+}
+
+void strategy_cursor_action(StrategyCursor* c, int amount) {
+	c->key = strategy_key_action(c->key, amount);
+}
+
+/*
+ * The tree deals one card per class of suits missing from the board
+ * (get_isomorphic_runouts gives them all the first missing suit), so
+ * dealt cards are carried through the suit permutation that makes every
+ * earlier deal canonical. These permutations only swap suits missing from
+ * the root board, so combo buckets stay the same. Returns 0 if the card is
+ * already on the board.
+ */
+int strategy_cursor_deal(StrategyCursor* c, int card) {
+	int rank = card % 13;
+	int suit = c->perm[card / 13];
+	if (((c->board >> (suit * 16)) & 0x1FFF) == 0) {
+		int first_absent = 0;
+		while ((c->board >> (first_absent * 16)) & 0x1FFF)
+			first_absent++;
+		for (int s = 0; s < 4; s++) {
+			if (c->perm[s] == first_absent)
+				c->perm[s] = suit;
+			else if (c->perm[s] == suit)
+				c->perm[s] = first_absent;
+		}
+		suit = first_absent;
+	}
+
+	uint64_t bit = 1ULL << (rank + suit * 16);
+	if (c->board & bit)
+		return 0;
+	c->board |= bit;
+	c->key = strategy_key_deal(c->key, suit * 13 + rank);
+	return 1;
+}
+
+int strategy_line_key(const StrategyFile* sf, const char* line, uint64_t* out_key) {
+	StrategyCursor c;
+	strategy_cursor_init(sf, &c);
+
+	int type, value;
+	while ((type = strategy_line_token(&line, &value)) > 0) {
+		if (type == STRATEGY_TOKEN_ACTION)
+			strategy_cursor_action(&c, value);
+		else if (!strategy_cursor_deal(&c, value))
+			return 0;
+	}
+	if (type < 0)
+		return 0;
+
+	*out_key = c.key;
+	return 1;
+}
+
+//probes at most every slot once, so a full table can't loop forever
+const StrategyNode* strategy_file_find(const StrategyFile* sf, uint64_t key) {
+	uint32_t mask = sf->header->table_size - 1;
+	uint32_t slot = (uint32_t)key & mask;
+	for (uint32_t probes = 0; probes <= mask && sf->table[slot]; probes++, slot = (slot + 1) & mask) {
+		const StrategyNode* node = &sf->nodes[sf->table[slot] - 1];
+		if (node->key == key)
+			return node;
+	}
+	return NULL;
+}
+
+//NULL if the line doesn't parse or doesn't end at an action node
+const StrategyNode* strategy_file_node(const StrategyFile* sf, const char* line) {
+	uint64_t key;
+	if (!strategy_line_key(sf, line, &key))
+		return NULL;
+	return strategy_file_find(sf, key);
+}
+
+/*
+ * Action probabilities of a combo (indexer.c order) into out, returns the
+ * number of actions, 0 if the combo is blocked by the root board. Combos
+ * blocked by a later card still have the row of their bucket.
+ */
+int strategy_file_combo(const StrategyFile* sf, const StrategyNode* node, int combo, float* out) {
+	if (combo < 0 || combo >= 1326)
+		return 0;
+	int bucket = sf->header->combo_to_bucket[combo];
+	if (bucket < 0)
+		return 0;
+
+	for (int a = 0; a < node->num_actions; a++)
+		out[a] = strategy_prob(sf, node, bucket, a);
+	return node->num_actions;
+}
+
+/*
+ * EV and equity of a combo for P1 and P2 (out_ev[2], out_equity[2], see
+ * calc_node_values), returns 0 if the file has no node values or the combo
+ * is blocked by the root board.
+ */
+int strategy_file_combo_values(const StrategyFile* sf, const StrategyNode* node, int combo, float* out_ev, float* out_equity) {
+	if (!sf->header->values_offset || combo < 0 || combo >= 1326)
+		return 0;
+	int bucket = sf->header->combo_to_bucket[combo];
+	if (bucket < 0)
+		return 0;
+
+	size_t num_buckets = sf->header->num_buckets;
+	const float* values = (const float*)((const uint8_t*)sf->map + sf->header->values_offset) +
+		(size_t)(node - sf->nodes) * 4 * num_buckets;
+	for (int p = 0; p < 2; p++) {
+		out_ev[p] = values[p * num_buckets + bucket];
+		out_equity[p] = values[(2 + p) * num_buckets + bucket];
+	}
+	return 1;
+}
+
+void strategy_action_label(const StrategyNode* node, int action, char* buf, size_t size) {
+	int amount = node->actions[action];
+	if (amount == -1)
+		snprintf(buf, size, "Fold");
+	else if (amount == 0 && node->to_call > 0)
+		snprintf(buf, size, "Call %d", node->to_call);
+	else if (amount == 0)
+		snprintf(buf, size, "Check");
+	else
+		snprintf(buf, size, "%s %d", node->to_call > 0 ? "Raise" : "Bet", amount);
+}
@@ -0,0 +1,153 @@
+#ifndef STRATEGY_FILE_H
+#define STRATEGY_FILE_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+/*
+ * Average strategy of every action node of a solved tree, written by
+ * strategy_file_write (strategy_export.h) and mapped read-only.
+ *
+ * Nodes are addressed by the hash of their line: the actions and dealt
+ * cards from the root, see strategy_line_key(). An open addressing table
+ * turns a line into its node in O(1), and each node holds one row per
+ * bucket of the root board's IsoMap with the probability of every action,
+ * quantized to 8 or 16 bits so each row sums to exactly the scale.
+ *
+ * Lines are tokens separated by spaces, commas or slashes: "x" check,
+ * "c" call, "f" fold, "b<chips>" / "r<chips>" bet or raise (chips put in
+ * by the action, as generate_bet_sizes gives them) and cards like "4h" for
+ * the turn and river. "b66 c 4h x" is the turn after a flop bet and call.
+ *
+ * Files written after a calc_node_values pass (cfr.h) also carry the EV
+ * and equity of every bucket for both players at each node, as floats.
+ */
+#define STRATEGY_FILE_MAGIC   0x53534654    // "TFSS"
+#define STRATEGY_FILE_VERSION 2
+#define STRATEGY_MAX_ACTIONS  8
+#define STRATEGY_NO_PARENT    0xFFFFFFFFu
+#define STRATEGY_ROOT_KEY     0xcbf29ce484222325ull
+
+/*
+ * file: header, then num_nodes StrategyNode records, table_size uint32
+ * slots (node index + 1, 0 for empty), the line strings, the rows and the
+ * node values if any: per node in node order, num_buckets floats each of
+ * P1 EV, P2 EV, P1 equity and P2 equity
+ */
+typedef struct {
+	uint32_t magic;
+	uint16_t version;
+	uint8_t quant_bits;
+	uint8_t reserved;
+	uint32_t num_nodes;
+	uint32_t num_buckets;   //rows per node, the root board's unique buckets
+	uint32_t table_size;    //power of two
+	uint32_t reserved2;
+
+	uint64_t root_board;
+	int32_t pot;
+	int32_t p1_stack;
+	int32_t p2_stack;
+	int32_t reserved3;
+
+	uint64_t nodes_offset;
+	uint64_t table_offset;
+	uint64_t lines_offset;
+	uint64_t data_offset;
+	uint64_t values_offset;   //0 without node values
+	uint64_t file_size;
+
+	int16_t combo_to_bucket[1326];
+} StrategyFileHeader;
+
+typedef struct {
+	uint64_t key;
+	uint64_t board;         //canonical board at the node
+	uint64_t data_offset;   //from the start of the file
+	uint32_t parent;        //previous action node, STRATEGY_NO_PARENT at the root
+	uint32_t line_offset;   //from lines_offset, NUL terminated
+	int32_t pot;
+	int32_t p1_stack;
+	int32_t p2_stack;
+	int32_t to_call;        //0 unless the player faces a bet
+	int32_t actions[STRATEGY_MAX_ACTIONS];   //-1 fold, 0 check/call, chips otherwise
+	uint8_t player;
+	uint8_t street;
+	uint8_t num_actions;
+	uint8_t reserved[5];
+} StrategyNode;
+
+typedef struct {
+	void* map;
+	size_t map_size;
+	const StrategyFileHeader* header;
+	const StrategyNode* nodes;
+	const uint32_t* table;
+	const char* lines;
+	float scale;            //1 / (2^quant_bits - 1)
+} StrategyFile;
+
+//a line being followed from the root, perm maps real suits to the file's
+typedef struct {
+	uint64_t key;
+	uint64_t board;
+	int perm[4];
+} StrategyCursor;
+
+enum {
+	STRATEGY_TOKEN_ACTION = 1,
+	STRATEGY_TOKEN_CARD
+};
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+int strategy_file_load(const char* path, StrategyFile* out);
+void strategy_file_free(StrategyFile* sf);
+
+int strategy_line_token(const char** line, int* value);
+void strategy_cursor_init(const StrategyFile* sf, StrategyCursor* c);
+void strategy_cursor_action(StrategyCursor* c, int amount);
+int strategy_cursor_deal(StrategyCursor* c, int card);
+int strategy_line_key(const StrategyFile* sf, const char* line, uint64_t* out_key);
+const StrategyNode* strategy_file_find(const StrategyFile* sf, uint64_t key);
+const StrategyNode* strategy_file_node(const StrategyFile* sf, const char* line);
+
+int strategy_file_combo(const StrategyFile* sf, const StrategyNode* node, int combo, float* out);
+int strategy_file_combo_values(const StrategyFile* sf, const StrategyNode* node, int combo, float* out_ev, float* out_equity);
+void strategy_action_label(const StrategyNode* node, int action, char* buf, size_t size);
+
+#ifdef __cplusplus
+}
+#endif
+
+//edges of a line, shared by the writer and the lookups
+static inline uint64_t strategy_key_step(uint64_t key, uint32_t edge) {
+	key = (key ^ edge) * 0x9e3779b97f4a7c15ull;
+	return key ^ (key >> 31);
+}
+
+static inline uint64_t strategy_key_action(uint64_t key, int amount) {
+	return strategy_key_step(key, (uint32_t)(amount + 2));
+}
+
+//card is suit * 13 + rank, already mapped to the tree's canonical suits
+static inline uint64_t strategy_key_deal(uint64_t key, int card) {
+	return strategy_key_step(key, 0x80000000u | (uint32_t)card);
+}
+
+static inline const StrategyNode* strategy_file_root(const StrategyFile* sf) {
+	return sf->header->num_nodes ? &sf->nodes[0] : NULL;
+}
+
+//probability of action a for a bucket of the root board
+static inline float strategy_prob(const StrategyFile* sf, const StrategyNode* node, int bucket, int a) {
+	const uint8_t* data = (const uint8_t*)sf->map + node->data_offset;
+	size_t i = (size_t)bucket * node->num_actions + a;
+	if (sf->header->quant_bits == 16)
+		return ((const uint16_t*)data)[i] * sf->scale;
+	return data[i] * sf->scale;
+}
+
+#endif //STRATEGY_FILE_H
@@ -1,6 +1,7 @@
 #include "tree.h"
 #include <stdbool.h>
 #include <stdio.h>
+#include <string.h>
 #include <sys/mman.h>
 
 void arena_init(Arena* a, size_t size) {
@@ -14,8 +15,12 @@ void arena_init(Arena* a, size_t size) {
 	a->offset = 0;
 }
 
+static size_t arena_aligned(size_t size) {
+	return (size + 31) & ~31; //force 32b align for simd
+}
+
 void* arena_alloc(Arena* a, size_t size) {
-	size_t aligned_size = (size + 31) & ~31; //force 32b align for simd
+	size_t aligned_size = arena_aligned(size);
 
 	if (a->offset + aligned_size > a->capacity) {
 		printf("Arena out of memory! Tree too large\n");
@@ -31,6 +36,14 @@ void arena_reset(Arena* a) {
 	a->offset = 0;
 }
 
+void arena_free(Arena* a) {
+	if (a->memory)
+		munmap(a->memory, a->capacity);
+	a->memory = NULL;
+	a->capacity = 0;
+	a->offset = 0;
+}
+
 bool is_street_complete(GameState* state) {
 	if (state->last_action_was_fold == 1)
 		return true;
@@ -241,8 +254,9 @@ int get_isomorphic_runouts(GameState* state, int* unique_cards, float* weights)
 	return num_unique;
 }
 
-PublicNode* build_public_tree(Arena* arena, GameState state, int num_buckets) {
+static PublicNode* build_tree(Arena* arena, GameState state, int num_buckets, bool depth_limited) {
 	PublicNode* node = (PublicNode*) arena_alloc(arena, sizeof(PublicNode));
+	node->values = NULL;
 	
 	//terminal state (showdown or fold)
 	if (is_hand_over(&state)) {
@@ -251,6 +265,16 @@ PublicNode* build_public_tree(Arena* arena, GameState state, int num_buckets) {
 		return node;
 	}
 
+	//end of the street in a depth limited subgame, values get filled in later
+	if (depth_limited && is_street_complete(&state)) {
+		node->type = NODE_LEAF;
+		node->num_children = 0;
+		node->leaf_values = (float*)arena_alloc(arena, num_buckets * sizeof(float));
+		for (int i = 0; i < num_buckets; i++)
+			node->leaf_values[i] = 0.0f;
+		return node;
+	}
+
 	//chance state (dealing turn or river)
 	if (is_street_complete(&state)) {
 		node->type = NODE_CHANCE;
@@ -270,7 +294,7 @@ PublicNode* build_public_tree(Arena* arena, GameState state, int num_buckets) {
 			GameState next_state = apply_deal(state, unique_cards[i]);
 			node->dealt_cards[i] = unique_cards[i];
 			node->chance_weights[i] = weights[i];
-			node->children[i] = build_public_tree(arena, next_state, num_buckets);
+			node->children[i] = build_tree(arena, next_state, num_buckets, depth_limited);
 		}
 		return node;
 	}
@@ -299,8 +323,59 @@ PublicNode* build_public_tree(Arena* arena, GameState state, int num_buckets) {
 	//reucrse down betting tree
 	for (int i = 0; i < num_actions; i++) {
 		GameState next_state = apply_bet(state, legal_actions[i]);
-		node->children[i] = build_public_tree(arena, next_state, num_buckets);
+		node->children[i] = build_tree(arena, next_state, num_buckets, depth_limited);
 	}
 
 	return node;
 }
+
+PublicNode* build_public_tree(Arena* arena, GameState state, int num_buckets) {
+	return build_tree(arena, state, num_buckets, false);
+}
+
+//stops at the end of the current street, see NODE_LEAF
+PublicNode* build_depth_limited_tree(Arena* arena, GameState state, int num_buckets) {
+	return build_tree(arena, state, num_buckets, true);
+}
+
+//mirrors build_tree without allocating, so the two have to change together
+static void estimate_tree(GameState state, int num_buckets, TreeStats* stats) {
+	stats->bytes += arena_aligned(sizeof(PublicNode));
+
+	if (is_hand_over(&state)) {
+		stats->terminal_nodes++;
+		if (!state.last_action_was_fold)
+			stats->showdown_nodes++;
+		return;
+	}
+
+	if (is_street_complete(&state)) {
+		int unique_cards[52];
+		float weights[52];
+		int num_deals = get_isomorphic_runouts(&state, unique_cards, weights);
+
+		stats->chance_nodes++;
+		stats->bytes += arena_aligned(num_deals * sizeof(PublicNode*));
+		stats->bytes += arena_aligned(num_deals * sizeof(int));
+		stats->bytes += arena_aligned(num_deals * sizeof(float));
+		for (int i = 0; i < num_deals; i++)
+			estimate_tree(apply_deal(state, unique_cards[i]), num_buckets, stats);
+		return;
+	}
+
+	int legal_actions[8];
+	int num_actions = generate_bet_sizes(&state, legal_actions);
+
+	stats->action_nodes++;
+	stats->action_cells += (double)num_actions * num_buckets;
+	stats->bytes += arena_aligned(num_actions * sizeof(PublicNode*));
+	stats->bytes += 2 * arena_aligned(num_actions * num_buckets * sizeof(float));
+	for (int i = 0; i < num_actions; i++)
+		estimate_tree(apply_bet(state, legal_actions[i]), num_buckets, stats);
+}
+
+//dry run of build_public_tree: the arena it would take and what's in it
+void estimate_public_tree(GameState state, int num_buckets, TreeStats* out) {
+	memset(out, 0, sizeof(*out));
+	estimate_tree(state, num_buckets, out);
+}
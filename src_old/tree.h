@@ -8,7 +8,8 @@
 typedef enum {
 	NODE_ACTION,
 	NODE_CHANCE,
-	NODE_TERMINAL
+	NODE_TERMINAL,
+	NODE_LEAF       //depth limit, valued by the blueprint
 } NodeType;
 
 typedef struct PublicNode {
@@ -25,6 +26,12 @@ typedef struct PublicNode {
 	//for chance nodes
 	int* dealt_cards;
 	float* chance_weights;
+
+	//for leaf nodes, P1 value per bucket
+	float* leaf_values;
+
+	//for action nodes after calc_node_values (cfr.h), NULL otherwise
+	float* values;
 } PublicNode;
 
 typedef struct {
@@ -51,13 +58,27 @@ typedef struct {
 	size_t offset;
 } Arena;
 
+//what build_public_tree would allocate, see estimate_public_tree
+typedef struct {
+	size_t bytes;            //arena bytes
+	int action_nodes;
+	int chance_nodes;
+	int terminal_nodes;
+	int showdown_nodes;      //terminal nodes that aren't folds
+	double action_cells;     //actions * buckets summed over action nodes
+} TreeStats;
+
 void arena_init(Arena* a, size_t size);
 void arena_reset(Arena* a);
+void arena_free(Arena* a);
 void* arena_alloc(Arena* a, size_t size);
 
 PublicNode* build_public_tree(Arena* arena, GameState state, int num_buckets);
+PublicNode* build_depth_limited_tree(Arena* arena, GameState state, int num_buckets);
+void estimate_public_tree(GameState state, int num_buckets, TreeStats* out);
 
 int generate_bet_sizes(GameState* state, int* out_actions);
+int get_isomorphic_runouts(GameState* state, int* unique_cards, float* weights);
 GameState apply_deal(GameState current_state, int card_idx);
 GameState apply_bet(GameState current_state, int action_amount);
 
@@ -0,0 +1,170 @@
+#include "turbofire_query.h"
+#include "strategy_file.h"
+#include "preflop_equity.h"
+#include "parse.h"
+
+#include <math.h>
+
+struct TfqFile {
+	StrategyFile sf;
+};
+
+TfqFile* tfq_open(const char* path) {
+	TfqFile* f = (TfqFile*)malloc(sizeof(TfqFile));
+	if (f && !strategy_file_load(path, &f->sf)) {
+		free(f);
+		return NULL;
+	}
+	return f;
+}
+
+void tfq_close(TfqFile* f) {
+	if (!f)
+		return;
+	strategy_file_free(&f->sf);
+	free(f);
+}
+
+static uint64_t permute_mask(uint64_t mask, const int perm[4]) {
+	uint64_t out = 0;
+	for (int s = 0; s < 4; s++)
+		out |= ((mask >> (s * 16)) & 0x1FFF) << (perm[s] * 16);
+	return out;
+}
+
+//suit permutation taking flop onto the solved one, 0 if there's none
+static int match_flop(uint64_t flop, uint64_t root, int perm[4]) {
+	for (int i = 0; i < 256; i++) {
+		int p[4] = { i & 3, (i >> 2) & 3, (i >> 4) & 3, (i >> 6) & 3 };
+		if ((1 << p[0] | 1 << p[1] | 1 << p[2] | 1 << p[3]) != 0xF)
+			continue;
+		if (permute_mask(flop, p) == root) {
+			for (int s = 0; s < 4; s++)
+				perm[s] = p[s];
+			return 1;
+		}
+	}
+	return 0;
+}
+
+/*
+ * actions is a line without cards ("b33 c x") or with them ("b33 c 4d x"),
+ * strategy_file.h has the tokens. Turn and river cards missing from the
+ * line are taken from board whenever the line moves past the end of a
+ * street. board may be NULL for the solved flop as is. Returns 0 unless the
+ * line ends at an action node.
+ */
+int tfq_find_node(const TfqFile* f, const char* actions, const char* board, TfqNode* out) {
+	const StrategyFile* sf = &f->sf;
+	StrategyCursor c;
+	strategy_cursor_init(sf, &c);
+
+	int cards[5];
+	int num_cards = parse_card_list(board, cards, 5);
+	uint64_t real_board = sf->header->root_board;
+	if (num_cards < 0 || (num_cards > 0 && num_cards < 3))
+		return 0;
+	if (num_cards >= 3) {
+		real_board = 0;
+		for (int i = 0; i < 3; i++)
+			real_board |= 1ULL << (cards[i] % 13 + (cards[i] / 13) * 16);
+		if (!match_flop(real_board, sf->header->root_board, c.perm))
+			return 0;
+	}
+
+	int next = 3, type, value;
+	while ((type = strategy_line_token(&actions, &value)) > 0) {
+		int card = -1;
+		if (type == STRATEGY_TOKEN_CARD) {
+			if (next < num_cards && cards[next++] != value)
+				return 0;
+			card = value;
+		} else if (next < num_cards && !strategy_file_find(sf, c.key)) {
+			card = cards[next++];
+		}
+
+		if (card >= 0) {
+			if (!strategy_cursor_deal(&c, card))
+				return 0;
+			real_board |= 1ULL << (card % 13 + (card / 13) * 16);
+		}
+		if (type == STRATEGY_TOKEN_ACTION)
+			strategy_cursor_action(&c, value);
+	}
+	if (type < 0)
+		return 0;
+
+	const StrategyNode* node;
+	while (!(node = strategy_file_find(sf, c.key)) && next < num_cards) {
+		int card = cards[next++];
+		if (!strategy_cursor_deal(&c, card))
+			return 0;
+		real_board |= 1ULL << (card % 13 + (card / 13) * 16);
+	}
+	if (!node)
+		return 0;
+
+	out->node = node;
+	for (int s = 0; s < 4; s++)
+		out->perm[s] = c.perm[s];
+	out->board = real_board;
+	return 1;
+}
+
+//combo of hole cards in the file's suits, -1 if they aren't 2 live cards
+static int file_combo(const TfqNode* node, const char* hole_cards) {
+	uint64_t mask = parse_hole_cards(hole_cards);
+	if (!mask || (mask & node->board))
+		return -1;
+	return preflop_combo_index(permute_mask(mask, node->perm));
+}
+
+//fills out_probs (TFQ_MAX_ACTIONS floats), returns the number of actions, 0 on bad hole cards
+int tfq_strategy(const TfqFile* f, const TfqNode* node, const char* hole_cards, float* out_probs) {
+	int combo = file_combo(node, hole_cards);
+	if (combo < 0)
+		return 0;
+	return strategy_file_combo(&f->sf, (const StrategyNode*)node->node, combo, out_probs);
+}
+
+/*
+ * out_ev gets EV, equity and EQR of the hole cards for player (0 P1, 1 P2)
+ * at the node, see calc_node_values. Returns 0 on bad hole cards or if
+ * the file was written without node values. EQR is NAN below 0.1% equity.
+ */
+int tfq_ev_player(const TfqFile* f, const TfqNode* node, int player, const char* hole_cards, float* out_ev) {
+	const StrategyNode* n = (const StrategyNode*)node->node;
+	float ev[2], equity[2];
+	int combo = file_combo(node, hole_cards);
+	if (combo < 0 || player < 0 || player > 1 || !strategy_file_combo_values(&f->sf, n, combo, ev, equity))
+		return 0;
+
+	out_ev[0] = ev[player];
+	out_ev[1] = equity[player];
+	out_ev[2] = (equity[player] > 0.001f) ? ev[player] / (equity[player] * (float)n->pot) : NAN;
+	return 1;
+}
+
+//the same for the player to act
+int tfq_ev(const TfqFile* f, const TfqNode* node, const char* hole_cards, float* out_ev) {
+	return tfq_ev_player(f, node, tfq_player(node), hole_cards, out_ev);
+}
+
+int tfq_num_actions(const TfqNode* node) {
+	return ((const StrategyNode*)node->node)->num_actions;
+}
+
+//0 is P1 (OOP), 1 P2 (IP)
+int tfq_player(const TfqNode* node) {
+	return ((const StrategyNode*)node->node)->player;
+}
+
+void tfq_action_label(const TfqNode* node, int action, char* buf, int size) {
+	const StrategyNode* n = (const StrategyNode*)node->node;
+	if (action < 0 || action >= n->num_actions || size <= 0) {
+		if (size > 0)
+			buf[0] = 0;
+		return;
+	}
+	strategy_action_label(n, action, buf, (size_t)size);
+}
@@ -0,0 +1,49 @@
+#ifndef TURBOFIRE_QUERY_H
+#define TURBOFIRE_QUERY_H
+
+/*
+ * libturbofire_query: read-only queries against strategy files written by
+ * turbofire (strategy_file.h), for bots that link it as a shared library.
+ *
+ * The file is mapped read-only and shared, so every process on a box
+ * serving the same solution shares its page cache. A TfqFile is never
+ * written after tfq_open, so any number of threads can query it at once,
+ * and queries don't allocate: nodes live in caller storage.
+ *
+ * Cards are strings like "As 8s 2s 4d" (parse_board_string), hole cards
+ * like "AhKd". The board may be any suit permutation of the solved flop.
+ * tfq_ev gives 3 floats: EV in chips, equity and EQR.
+ */
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define TFQ_API __attribute__((visibility("default")))
+#define TFQ_MAX_ACTIONS 8
+
+typedef struct TfqFile TfqFile;
+
+//a node found by tfq_find_node, perm maps the real suits to the file's
+typedef struct {
+	const void* node;
+	int perm[4];
+	unsigned long long board;
+} TfqNode;
+
+TFQ_API TfqFile* tfq_open(const char* path);
+TFQ_API void tfq_close(TfqFile* f);
+
+TFQ_API int tfq_find_node(const TfqFile* f, const char* actions, const char* board, TfqNode* out);
+TFQ_API int tfq_strategy(const TfqFile* f, const TfqNode* node, const char* hole_cards, float* out_probs);
+TFQ_API int tfq_ev(const TfqFile* f, const TfqNode* node, const char* hole_cards, float* out_ev);
+TFQ_API int tfq_ev_player(const TfqFile* f, const TfqNode* node, int player, const char* hole_cards, float* out_ev);
+
+TFQ_API int tfq_num_actions(const TfqNode* node);
+TFQ_API int tfq_player(const TfqNode* node);
+TFQ_API void tfq_action_label(const TfqNode* node, int action, char* buf, int size);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //TURBOFIRE_QUERY_H